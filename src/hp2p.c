@@ -22,6 +22,165 @@
 
 #include "hp2p.h"
 
+/**
+ * \fn       double hp2p_iteration_sync(MPI_Comm comm, int mode, int rank,
+ *                                     int other)
+ * \brief    Synchronize workers around the timed window
+ *
+ * \param    comm  communicator
+ * \param    mode  HP2P_SYNC_BARRIER or HP2P_SYNC_PAIR
+ * \param    rank  current rank
+ * \param    other other rank of couple
+ * \return   time spent in the synchronization
+ **/
+double hp2p_iteration_sync(MPI_Comm comm, int mode, int rank, int other)
+{
+  double t0 = 0.0;
+  double t_trace = 0.0;
+
+  t_trace = hp2p_trace_begin();
+  t0 = MPI_Wtime();
+  if (mode == HP2P_SYNC_PAIR)
+  {
+    if (rank != other)
+      MPI_Sendrecv(NULL, 0, MPI_BYTE, other, HP2P_TAG_SYNC, NULL, 0, MPI_BYTE,
+		   other, HP2P_TAG_SYNC, comm, MPI_STATUS_IGNORE);
+  }
+  else
+    MPI_Barrier(comm);
+  hp2p_trace_end(HP2P_TRACE_SYNC, t_trace, -1);
+  return MPI_Wtime() - t0;
+}
+
+/**
+ * \fn       long long hp2p_iteration_verify(int *buf, int *d_buf, size_t n,
+ *                                          uint32_t key,
+ *                                          double *verify_time)
+ * \brief    Check a received message against its pattern
+ *
+ * \param    buf   received message (host)
+ * \param    d_buf received message (device, GPU builds only)
+ * \param    n     number of words
+ * \param    key   key of the pattern of the sender
+ * \param    verify_time time spent to check (accumulated)
+ * \return   number of corrupted words
+ **/
+#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
+long long hp2p_iteration_verify(int *buf, int *d_buf, size_t n, uint32_t key,
+				double *verify_time)
+#else
+long long hp2p_iteration_verify(int *buf, size_t n, uint32_t key,
+				double *verify_time)
+#endif
+{
+  double t0 = MPI_Wtime();
+  long long bad = 0;
+
+#ifdef _ENABLE_CUDA_
+  cudaMemcpy(buf, d_buf, n * sizeof(int), cudaMemcpyDeviceToHost);
+#endif
+#ifdef _ENABLE_ROCM_
+  hipMemcpy(buf, d_buf, n * sizeof(int), hipMemcpyDeviceToHost);
+#endif
+  bad = hp2p_verify_check(buf, n, key);
+  *verify_time += MPI_Wtime() - t0;
+  return bad;
+}
+
+/**
+ * \fn       int hp2p_iteration_post(int *send, int *recv, long long n,
+ *                                   int other, MPI_Comm comm,
+ *                                   MPI_Request *req)
+ * \brief    Post the receive and the send of a message of n ints
+ *
+ * With MPI-4, the message is posted at once with the large-count
+ * functions. Otherwise it is split in hp2p_buffer_chunks(n) chunks:
+ * req[0..nchunks-1] are the receives, followed by the sends. Chunks are
+ * matched in order since they share the tag.
+ *
+ * \param    send  message sent
+ * \param    recv  message received
+ * \param    n     number of ints
+ * \param    other other rank of couple
+ * \param    comm  communicator
+ * \param    req   requests (output, 2 * nchunks)
+ * \return   number of requests
+ **/
+int hp2p_iteration_post(int *send, int *recv, long long n, int other,
+			MPI_Comm comm, MPI_Request *req)
+{
+#ifdef HP2P_LARGE_COUNT
+  MPI_Irecv_c(recv, (MPI_Count)n, MPI_INT, other, HP2P_TAG_DATA, comm,
+	      &req[0]);
+  MPI_Isend_c(send, (MPI_Count)n, MPI_INT, other, HP2P_TAG_DATA, comm,
+	      &req[1]);
+  return 2;
+#else
+  int nchunks = hp2p_buffer_chunks(n);
+  long long offset = 0;
+  int count = 0;
+  int c = 0;
+
+  for (c = 0; c < nchunks; c++)
+  {
+    offset = c * HP2P_CHUNK_WORDS;
+    count = (int)((n - offset < HP2P_CHUNK_WORDS) ? n - offset
+						  : HP2P_CHUNK_WORDS);
+    MPI_Irecv(recv + offset, count, MPI_INT, other, HP2P_TAG_DATA, comm,
+	      &req[c]);
+  }
+  for (c = 0; c < nchunks; c++)
+  {
+    offset = c * HP2P_CHUNK_WORDS;
+    count = (int)((n - offset < HP2P_CHUNK_WORDS) ? n - offset
+						  : HP2P_CHUNK_WORDS);
+    MPI_Isend(send + offset, count, MPI_INT, other, HP2P_TAG_DATA, comm,
+	      &req[nchunks + c]);
+  }
+  return 2 * nchunks;
+#endif
+}
+
+/**
+ * \fn       double hp2p_iteration_type(hp2p_config *conf, MPI_Comm comm,
+ *                                     int rank, int other, void *send,
+ *                                     void *recv, MPI_Datatype type,
+ *                                     double *sync_time)
+ * \brief    Timed window of one message of the derived datatype
+ *
+ * \param    conf  benchmark configuration
+ * \param    comm  communicator
+ * \param    rank  current rank
+ * \param    other other rank of couple
+ * \param    send  buffer sent
+ * \param    recv  buffer received
+ * \param    type  derived datatype (see hp2p_datatype_create)
+ * \param    sync_time time spent in synchronizations (accumulated)
+ * \return   time of a message of the datatype
+ **/
+double hp2p_iteration_type(hp2p_config *conf, MPI_Comm comm, int rank,
+			   int other, void *send, void *recv, MPI_Datatype type,
+			   double *sync_time)
+{
+  MPI_Request req[2];
+  double t0 = 0.0;
+  double t1 = 0.0;
+  int i = 0;
+
+  *sync_time += hp2p_iteration_sync(comm, conf->sync_mode, rank, other);
+  t0 = hp2p_util_get_time();
+  for (i = 0; i < conf->nb_msg; i++)
+  {
+    MPI_Irecv(recv, 1, type, other, HP2P_TAG_DATA, comm, &req[0]);
+    MPI_Isend(send, 1, type, other, HP2P_TAG_DATA, comm, &req[1]);
+    MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+  }
+  t1 = hp2p_util_get_time();
+  if (conf->sync_mode == HP2P_SYNC_BARRIER)
+    *sync_time += hp2p_iteration_sync(comm, conf->sync_mode, rank, other);
+  return (t1 - t0) / conf->nb_msg;
+}
+
 /**
  * \fn       heavy_p2p_iteration(mpi_config mpi_conf, config conf, int other)
  * \brief    HP2P iteration: test a pair of workers several times
@@ -30,17 +189,28 @@
  * \param    other other rank of couple
  * \param    nproc
  * \msg_size size of a message
+ * \param    iteration current iteration (used for fences)
+ * \param    sync_time time spent in synchronizations (output)
+ * \param    wait_time time waited before the timed window (output)
+ * \param    start_time local start time of the timed window (output)
+ * \param    corrupt corrupted words received, with conf.verify (output)
+ * \param    verify_time time spent to fill and check the buffers (output)
+ * \param    type_time time of a message of the derived datatype (output)
+ * \param    buffer buffers of the run
  **/
-double hp2p_iteration(hp2p_mpi_config mpi_conf, hp2p_config conf, int other)
+double hp2p_iteration(hp2p_mpi_config mpi_conf, hp2p_config conf, int other,
+		      int iteration, double *sync_time, double *wait_time,
+		      double *start_time, long long *corrupt,
+		      double *verify_time, double *type_time,
+		      hp2p_buffer *buffer)
 {
   double time_hp2p = 0.0;
   int rank = 0;
   MPI_Comm comm;
   int nproc = 0;
-  int msg_size = 0;
+  long long msg_size = 0;
   int nb_msg = 0;
-  int align_size = 0;
-  int n = 0;
+  long long n = 0;
   int i = 0;
   int *buf1 = NULL;
   int *buf2 = NULL;
@@ -50,95 +220,173 @@ double hp2p_iteration(hp2p_mpi_config mpi_conf, hp2p_config conf, int other)
 #endif
   double t0 = 0.0;
   double t1 = 0.0;
+  double t_trace = 0.0;
+  int k = 0;
+  int idx = 0;
+  // Requests of an exchange and chunks left to complete of each side
+  MPI_Request *req = buffer->req;
+  int nb_req = 0;
+  int left[2];
+  // Optional fence in pairwise mode
+  int fence = 0;
+  MPI_Request fence_req = MPI_REQUEST_NULL;
+  // Patterns of the sent and received messages
+  uint32_t send_key = 0;
+  uint32_t recv_key = 0;
+  // Offset of the buffers in the sweep
+  int sweep = -1;
+  int shift = 0;
 
   rank = mpi_conf.rank;
   comm = mpi_conf.comm;
   nproc = mpi_conf.nproc;
   msg_size = conf.msg_size;
   nb_msg = conf.nb_msg;
-  align_size = conf.align_size;
+  *sync_time = 0.0;
+  *wait_time = 0.0;
+  *start_time = 0.0;
+  *corrupt = 0;
+  *verify_time = 0.0;
+  *type_time = 0.0;
+  fence = (conf.sync_mode == HP2P_SYNC_PAIR && conf.fence_freq > 0 &&
+	   (iteration % conf.fence_freq) == 0);
+  if (fence)
+  {
+    t0 = MPI_Wtime();
+    MPI_Ibarrier(comm, &fence_req);
+    *sync_time += MPI_Wtime() - t0;
+  }
   if (rank == other)
   {
     time_hp2p = 0.0;
-    MPI_Barrier(comm);
-    MPI_Barrier(comm);
+    if (conf.sync_mode == HP2P_SYNC_BARRIER)
+    {
+      *sync_time += hp2p_iteration_sync(comm, conf.sync_mode, rank, other);
+      *sync_time += hp2p_iteration_sync(comm, conf.sync_mode, rank, other);
+      // Window of the derived datatype
+      if (conf.datatype != HP2P_TYPE_CONTIGUOUS)
+      {
+	*sync_time += hp2p_iteration_sync(comm, conf.sync_mode, rank, other);
+	*sync_time += hp2p_iteration_sync(comm, conf.sync_mode, rank, other);
+      }
+    }
+    *wait_time = -1.0; // idle rank does not take part in the skew
   }
   else
   {
     n = msg_size / sizeof(int);
 
-    // Align MPI buffers
+    // Buffers of the run (see hp2p_buffer), shifted in an offset sweep
+    sweep = hp2p_buffer_offset(&conf, iteration);
+    shift = (sweep < 0) ? 0 : conf.offsets[sweep];
+    buf1 = (int *)((char *)buffer->send + shift);
+    buf2 = (int *)((char *)buffer->recv + shift);
+#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
+    d_buf1 = (int *)((char *)buffer->d_send + shift);
+    d_buf2 = (int *)((char *)buffer->d_recv + shift);
+#endif
 
-    if (posix_memalign((void **)&buf1, align_size, msg_size))
-    {
-      fprintf(stderr, "Cannot allocate memory...Exit\n");
-    }
-    if (posix_memalign((void **)&buf2, align_size, msg_size))
+    if (conf.verify)
     {
-      fprintf(stderr, "Cannot allocate memory...Exit\n");
-    }
-
-    for (i = 0; i < n; i++)
-      buf1[i] = i;
-
+      t0 = MPI_Wtime();
+      send_key = hp2p_verify_key(conf.seed, iteration, rank);
+      recv_key = hp2p_verify_key(conf.seed, iteration, other);
+      hp2p_verify_fill(buf1, n, send_key);
 #ifdef _ENABLE_CUDA_
-    cudaMalloc(&d_buf1, n * sizeof(int));
-    cudaMalloc(&d_buf2, n * sizeof(int));
-
-    cudaMemcpy(d_buf1, buf1, n * sizeof(int), cudaMemcpyHostToDevice);
+      cudaMemcpy(d_buf1, buf1, n * sizeof(int), cudaMemcpyHostToDevice);
 #endif
 #ifdef _ENABLE_ROCM_
-    hipMalloc(&d_buf1, n * sizeof(int));
-    hipMalloc(&d_buf2, n * sizeof(int));
-
-    hipMemcpy(d_buf1, buf1, n * sizeof(int), hipMemcpyHostToDevice);
+      hipMemcpy(d_buf1, buf1, n * sizeof(int), hipMemcpyHostToDevice);
 #endif
+      *verify_time += MPI_Wtime() - t0;
+    }
 
-    MPI_Request req[2];
-    MPI_Status status[2];
-
-    // First comm
+    // Untimed warm-up comms
+    t_trace = hp2p_trace_begin();
+    for (i = 0; i < conf.warmup; i++)
+    {
+#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
+      nb_req = hp2p_iteration_post(d_buf1, d_buf2, n, other, comm, req);
+#else
+      nb_req = hp2p_iteration_post(buf1, buf2, n, other, comm, req);
+#endif
+      MPI_Waitall(nb_req, req, MPI_STATUSES_IGNORE);
+    }
+    hp2p_trace_end(HP2P_TRACE_WARMUP, t_trace, -1);
+    if (conf.verify && conf.warmup > 0)
 #if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
-    MPI_Irecv(d_buf2, n, MPI_INT, other, 0, comm, &req[0]);
-    MPI_Isend(d_buf1, n, MPI_INT, other, 0, comm, &req[1]);
+      *corrupt +=
+	  hp2p_iteration_verify(buf2, d_buf2, n, recv_key, verify_time);
 #else
-    MPI_Irecv(buf2, n, MPI_INT, other, 0, comm, &req[0]);
-    MPI_Isend(buf1, n, MPI_INT, other, 0, comm, &req[1]);
+      *corrupt += hp2p_iteration_verify(buf2, n, recv_key, verify_time);
 #endif
-    MPI_Waitall(2, req, status);
 
-    MPI_Barrier(comm);
+    *wait_time = hp2p_iteration_sync(comm, conf.sync_mode, rank, other);
+    *sync_time += *wait_time;
     // send/recv nloops * msg_size MB of data
     t1 = 0;
     t0 = hp2p_util_get_time();
+    *start_time = t0;
     for (i = 0; i < nb_msg; i++)
     {
+      t_trace = hp2p_trace_begin();
 #if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
-      MPI_Irecv(d_buf2, n, MPI_INT, other, 0, comm, &req[0]);
-      MPI_Isend(d_buf1, n, MPI_INT, other, 0, comm, &req[1]);
+      nb_req = hp2p_iteration_post(d_buf1, d_buf2, n, other, comm, req);
 #else
-      MPI_Irecv(buf2, n, MPI_INT, other, 0, comm, &req[0]);
-      MPI_Isend(buf1, n, MPI_INT, other, 0, comm, &req[1]);
+      nb_req = hp2p_iteration_post(buf1, buf2, n, other, comm, req);
 #endif
-      MPI_Waitall(2, req, status);
+      if (hp2p_trace_enabled())
+      {
+	hp2p_trace_end(HP2P_TRACE_POST, t_trace, i);
+	t_trace = hp2p_trace_begin();
+	// Completion of each message (its last chunk) is recorded
+	left[0] = left[1] = nb_req / 2;
+	for (k = 0; k < nb_req; k++)
+	{
+	  MPI_Waitany(nb_req, req, &idx, MPI_STATUS_IGNORE);
+	  idx = (idx < nb_req / 2) ? 0 : 1;
+	  if (--left[idx] == 0)
+	    hp2p_trace_instant(idx == 0 ? HP2P_TRACE_RECV_DONE
+					: HP2P_TRACE_SEND_DONE,
+			       i);
+	}
+	hp2p_trace_end(HP2P_TRACE_WAIT, t_trace, i);
+      }
+      else
+	MPI_Waitall(nb_req, req, MPI_STATUSES_IGNORE);
     }
 
     t1 = hp2p_util_get_time();
 
-    MPI_Barrier(comm);
-    free((void *)buf1);
-    free((void *)buf2);
-
-#ifdef _ENABLE_CUDA_
-    cudaFree(d_buf1);
-    cudaFree(d_buf2);
-#endif
-#ifdef _ENABLE_ROCM__
-    hipFree(d_buf1);
-    hipFree(d_buf2);
+    if (conf.sync_mode == HP2P_SYNC_BARRIER)
+      *sync_time += hp2p_iteration_sync(comm, conf.sync_mode, rank, other);
+    // Last message of the timed window
+    if (conf.verify)
+#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
+      *corrupt +=
+	  hp2p_iteration_verify(buf2, d_buf2, n, recv_key, verify_time);
+#else
+      *corrupt += hp2p_iteration_verify(buf2, n, recv_key, verify_time);
 #endif
-
     time_hp2p = (t1 - t0) / nb_msg;
+
+    // Same exchange described by the derived datatype
+    if (conf.datatype != HP2P_TYPE_CONTIGUOUS)
+#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
+      *type_time = hp2p_iteration_type(&conf, comm, rank, other, d_buf1,
+				       d_buf2, buffer->type, sync_time);
+#else
+      *type_time = hp2p_iteration_type(&conf, comm, rank, other, buf1, buf2,
+				       buffer->type, sync_time);
+#endif
+  }
+  if (fence)
+  {
+    t_trace = hp2p_trace_begin();
+    t0 = MPI_Wtime();
+    MPI_Wait(&fence_req, MPI_STATUS_IGNORE);
+    *sync_time += MPI_Wtime() - t0;
+    hp2p_trace_end(HP2P_TRACE_SYNC, t_trace, -1);
   }
   return time_hp2p;
 }
@@ -149,6 +397,7 @@ double hp2p_iteration(hp2p_mpi_config mpi_conf, hp2p_config conf, int other)
  *
  * \param conf      Benchmark configuration
  * \param mpi_conf  MPI configuration
+ * \param scenario  Scenario of a campaign or NULL
  *
  * => Initialization
  * => loop on:
@@ -158,7 +407,8 @@ double hp2p_iteration(hp2p_mpi_config mpi_conf, hp2p_config conf, int other)
  *    - output timings of the current iteration (+ periodic flush)
  * => final output/snapshot + finalization
  **/
-void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
+void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf,
+	       hp2p_scenario *scenario)
 {
   // MPI Configuration
   int nproc = 0;
@@ -167,7 +417,7 @@ void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
   MPI_Comm comm;
   // Benchmark parameters
   int nloops = 0;
-  int msg_size = 0;
+  long long msg_size = 0;
   // Couples array
   int *couples = NULL;
 
@@ -177,11 +427,20 @@ void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
   double start = 0.0;
   double local_time = 0.;
   double max_time = 0.;
+  double start_time = 0.;
+  double verify_time = 0.;
+  double type_time = 0.;
+  long long corrupt = 0;
+  double t_trace = 0.;
 
   hp2p_result result;
+  hp2p_buffer buffer;
 
   int i = 0;
+  int first = 1;
+  int pending = 0;
   int other = -1;
+  int kinds = 0;
 
   // MPI Configuration
   nproc = mpi_conf.nproc;
@@ -190,9 +449,23 @@ void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
   comm = mpi_conf.comm;
   // Benchmark parameters
   nloops = conf.nb_shuffle;
+  if (hp2p_buffer_alloc(&buffer, &conf, &mpi_conf))
+    return;
+  // Payload of the derived datatype (see hp2p_datatype_create)
   msg_size = conf.msg_size;
   hp2p_result_alloc(&result, &mpi_conf, &conf);
   hp2p_util_init_tremain(&conf);
+  // Restore the results of a previous allocation (and its seed)
+  if (strlen(conf.restart) > 0)
+  {
+    first = hp2p_checkpoint_read(&result, conf.restart) + 1;
+    if (first < 1)
+    {
+      hp2p_result_free(&result);
+      hp2p_buffer_free(&buffer, &mpi_conf);
+      return;
+    }
+  }
   // Initialize random generator
   if (conf.seed < 0)
   {
@@ -206,15 +479,25 @@ void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
 #ifdef _HP2P_SIGNAL
   init_signal_writer(conf);
 #endif
+  // Global time base (also used to align the trace of all ranks)
+  if (conf.clock_freq > 0 || conf.trace)
+    hp2p_clock_sync(&mpi_conf);
+  hp2p_trace_init(&conf, &mpi_conf);
   if (rank == root)
   {
     couples = (int *)malloc(nproc * sizeof(int));
+    // Same draws as the allocation which wrote the checkpoint
+    hp2p_algo_reset();
+    for (i = 1; i < first; i++)
+      hp2p_algo_build_couples(couples, nproc, conf.build);
   }
 
   // Main loop
-  for (i = 1; i <= nloops && tremain >= 0; i++)
+  for (i = first; i <= nloops && tremain >= 0 && !result.converge_stop; i++)
   {
     result.current_iteration = i;
+    pending = hp2p_result_pending(&result);
+    hp2p_trace_set_iteration(i);
     other = -1;
     // Check time left before job ends
     tremain = hp2p_util_tremain(conf);
@@ -222,51 +505,100 @@ void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
     start = MPI_Wtime();
     if (rank == root)
     {
+      t_trace = hp2p_trace_begin();
       hp2p_algo_build_couples(couples, nproc, conf.build);
+      hp2p_trace_end(HP2P_TRACE_BUILD, t_trace, -1);
     }
+    t_trace = hp2p_trace_begin();
     MPI_Scatter(couples, 1, MPI_INT, &other, 1, MPI_INT, root, comm);
-    result.monitor_build_couples[i - 1] = MPI_Wtime() - start;
+    hp2p_trace_end(HP2P_TRACE_SCATTER, t_trace, -1);
+    hp2p_series_push(&result.monitor_build_couples, MPI_Wtime() - start);
 
     // HP2P iteration
     start = MPI_Wtime();
-    local_time = hp2p_iteration(mpi_conf, conf, other);
-    result.l_bsbw[i - 1] = msg_size / local_time;
+    local_time =
+	hp2p_iteration(mpi_conf, conf, other, i, &result.l_sync[pending],
+		       &result.l_wait[pending], &start_time, &corrupt,
+		       &verify_time, &type_time, &buffer);
+    result.l_verify_time += verify_time;
+    if (corrupt > 0)
+    {
+      result.l_corrupt[other]++;
+      result.l_corrupt_words += corrupt;
+      fprintf(stderr,
+	      "warning: %lld corrupted words received by %d from %d at "
+	      "iteration %d\n",
+	      corrupt, rank, other, i);
+    }
+    if (result.l_start != NULL)
+    {
+      result.l_start[pending] =
+	  hp2p_clock_global(&mpi_conf.clock, start_time);
+      result.l_sample[pending] = local_time;
+      result.l_other[pending] = other;
+    }
+    // Idle rank of an odd-size run does not contribute
+    if (other != rank)
+      result.l_bsbw[pending] = msg_size / local_time;
     result.l_time[other] += local_time;
-    if (((conf.time_mult < 1.) && (conf.local_max_time > 0.0) &&
-	 (conf.local_max_time < local_time)) ||
-	((conf.time_mult >= 1.) && (result.avg_time > 0.0) &&
-	 (conf.time_mult * result.avg_time < local_time)))
+    if (other != rank)
     {
-      if (rank < other)
+      result.l_count[other]++;
+      if (result.l_type_time != NULL)
+	result.l_type_time[other] += type_time;
+      hp2p_robust_add(&result, other, local_time);
+      hp2p_sweep_add(&result, hp2p_buffer_offset(&conf, i), local_time);
+      kinds = hp2p_anomaly_check(&result, other, local_time,
+				 hp2p_clock_global(&mpi_conf.clock, start_time));
+      if ((kinds & (HP2P_ANOMALY_THRESHOLD | HP2P_ANOMALY_MULT)) &&
+	  rank < other)
 	fprintf(stderr,
 		"warning: the communication between %d and %d was slow.\nTime "
 		"of communication : %lf\nMean Time of communication : %lf\n",
 		rank, other, local_time, result.avg_time);
     }
-    if (other != rank)
-      result.l_count[other]++;
-    result.monitor_heavyp2p[i - 1] = MPI_Wtime() - start;
+    hp2p_series_push(&result.monitor_heavyp2p, MPI_Wtime() - start);
 
-    // Periodic snapshot
+    // Stop once enough confidence intervals are narrow enough. Also run
+    // before the snapshots and the final result, which report them.
     start = MPI_Wtime();
+    if (conf.converge_width > 0.0 &&
+	((conf.converge_freq > 0 && (i % conf.converge_freq) == 0) ||
+	 (i % conf.snap_freq) == 0 || i == nloops))
+      hp2p_converge_update(&result);
+    if (result.converge_stop && rank == root)
+      printf(" Confidence target reached at iteration %d\n", i);
+
+    // Periodic snapshot
     if (i && ((i % conf.snap_freq) == 0))
     {
+      t_trace = hp2p_trace_begin();
       hp2p_result_update(&result);
       if (rank == root)
       {
 	hp2p_result_display(&result);
 	hp2p_result_write(result);
       }
+      hp2p_export_write(&result);
+      if (conf.checkpoint)
+	hp2p_checkpoint_write(&result);
       MPI_Barrier(comm);
+      hp2p_trace_end(HP2P_TRACE_SNAPSHOT, t_trace, -1);
+    }
+    if (conf.clock_freq > 0 && (i % conf.clock_freq) == 0)
+    {
+      t_trace = hp2p_trace_begin();
+      hp2p_clock_sync(&mpi_conf);
+      hp2p_trace_end(HP2P_TRACE_CLOCK, t_trace, -1);
     }
-    result.monitor_snapshot[i - 1] = MPI_Wtime() - start;
+    hp2p_series_push(&result.monitor_snapshot, MPI_Wtime() - start);
     // Follow the run
     if (nloops >= 100 && rank == root && ((i % (nloops / 100)) == 0))
     {
       printf(" %d %% done\n", (int)(100 * ((double)i) / ((double)nloops)));
     }
 #ifdef _HP2P_SIGNAL
-    check_signal(result);
+    check_signal(&result);
 #endif
     // output time of each iteration
   }
@@ -282,9 +614,18 @@ void hp2p_main(hp2p_config conf, hp2p_mpi_config mpi_conf)
     printf(" Writing final result... Done\n");
     fflush(stdout);
   }
+  hp2p_export_write(&result);
+  if (conf.checkpoint)
+    hp2p_checkpoint_write(&result);
+  if (scenario != NULL)
+    hp2p_campaign_record(scenario, &result);
+
+  hp2p_trace_write(&conf, &mpi_conf);
+  hp2p_trace_free();
 
   MPI_Barrier(comm);
   hp2p_result_free(&result);
+  hp2p_buffer_free(&buffer, &mpi_conf);
   // Release memory and files
   if (rank == root)
   {
@@ -296,14 +637,50 @@ int main(int argc, char *argv[])
 {
   hp2p_config conf;
   hp2p_mpi_config mpi_conf;
+  hp2p_campaign campaign;
+  hp2p_scenario *scenario = NULL;
+  double start = 0.0;
+  int k = 0;
 
   hp2p_mpi_init(&argc, &argv, &mpi_conf);
   hp2p_util_set_default_config(&conf);
   hp2p_util_read_commandline(argc, argv, &conf);
-  if (mpi_conf.rank == mpi_conf.root)
+  hp2p_campaign_read(&campaign, &conf);
+  if (mpi_conf.rank == mpi_conf.root && campaign.nb_scenarios == 0)
     hp2p_util_display_config(conf);
   hp2p_mpi_get_hostname(&mpi_conf, conf.anonymize);
-  hp2p_main(conf, mpi_conf);
+  if (campaign.nb_scenarios == 0)
+    hp2p_main(conf, mpi_conf, NULL);
+  // Scenarios share the communicators, the hostnames and max_time
+  hp2p_util_init_tremain(&conf);
+  for (k = 0; k < campaign.nb_scenarios; k++)
+  {
+    scenario = &campaign.scenarios[k];
+    scenario->conf.__start_time = conf.__start_time;
+    scenario->conf.max_time = (int)hp2p_util_tremain(scenario->conf);
+    MPI_Bcast(&scenario->conf.max_time, 1, MPI_INT, mpi_conf.root,
+	      mpi_conf.comm);
+    if (scenario->conf.max_time <= 0)
+    {
+      scenario->status = HP2P_SCENARIO_SKIPPED;
+      continue;
+    }
+    if (mpi_conf.rank == mpi_conf.root)
+    {
+      printf("\n === Scenario %d/%d: %s ===\n\n", k + 1,
+	     campaign.nb_scenarios, scenario->name);
+      hp2p_util_display_config(scenario->conf);
+    }
+    scenario->status = HP2P_SCENARIO_FAILED;
+    start = MPI_Wtime();
+    hp2p_main(scenario->conf, mpi_conf, scenario);
+    scenario->duration = MPI_Wtime() - start;
+  }
+  if (campaign.nb_scenarios > 0)
+  {
+    hp2p_campaign_write(&campaign, &conf, &mpi_conf);
+    hp2p_campaign_free(&campaign);
+  }
   hp2p_util_free_config(&conf);
   hp2p_mpi_finalize(&mpi_conf);
   return EXIT_SUCCESS;
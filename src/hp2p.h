@@ -26,12 +26,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
 
 #include <unistd.h>
 #include <sys/time.h>
 #include <time.h>
 
 #include "mpi.h"
+#include "hp2p_binary.h"
 #ifdef _ENABLE_CUDA_
 #include <cuda.h>
 #include <cuda_runtime.h>
@@ -44,6 +48,110 @@
 #define MAXCHARFILE 4096
 #define PLOTLY_VERSION "2.24.1"
 
+// Synchronization modes around the timed window
+#define HP2P_SYNC_BARRIER 0 // global MPI_Barrier (default)
+#define HP2P_SYNC_PAIR 1    // zero-byte handshake between couples only
+
+// MPI tags
+#define HP2P_TAG_DATA 0
+#define HP2P_TAG_SYNC 1
+#define HP2P_TAG_CLOCK 2
+#define HP2P_TAG_TRACE 3
+#define HP2P_TAG_ANOMALY 4
+#define HP2P_TAG_EXPORT 5
+#define HP2P_TAG_CHECKPOINT 6
+
+// Checkpoint file
+#define HP2P_CHECKPOINT_MAGIC "HP2PCKP"
+#define HP2P_CHECKPOINT_VERSION 3
+#define HP2P_CHECKPOINT_SERIES 6 // series of iterations (see hp2p_checkpoint)
+#define HP2P_CHECKPOINT_ROW 5	 // per-pair values (see hp2p_checkpoint)
+
+// Number of ping-pong exchanges for each clock offset estimation
+#define HP2P_CLOCK_NB_PINGPONG 10
+
+// Phases of the trace (see hp2p_trace_name)
+#define HP2P_TRACE_BUILD 0
+#define HP2P_TRACE_SCATTER 1
+#define HP2P_TRACE_SYNC 2
+#define HP2P_TRACE_WARMUP 3
+#define HP2P_TRACE_POST 4
+#define HP2P_TRACE_WAIT 5
+#define HP2P_TRACE_SNAPSHOT 6
+#define HP2P_TRACE_CLOCK 7
+#define HP2P_TRACE_RECV_DONE 8
+#define HP2P_TRACE_SEND_DONE 9
+
+// Kinds of anomalies (flags, see hp2p_anomaly_kind)
+#define HP2P_ANOMALY_THRESHOLD 1 // slower than max_communication_time
+#define HP2P_ANOMALY_MULT 2	 // slower than time_mult * pair mean
+#define HP2P_ANOMALY_ZSCORE 4	 // z-score above anomaly_zscore
+#define HP2P_ANOMALY_EWMA 8	 // above (1 + anomaly_ewma) * pair EWMA
+#define HP2P_ANOMALY_NB_KINDS 4
+// Number of events buffered on each rank between two snapshots
+#define HP2P_ANOMALY_BUFFER 65536
+
+// Level of the confidence-driven stop
+#define HP2P_CONVERGE_PAIR 0 // intervals of the pairs of ranks
+#define HP2P_CONVERGE_NODE 1 // intervals of the pairs of nodes
+// Histogram of relative half-widths (log scale from 1e-4 to 1e2)
+#define HP2P_CONVERGE_BINS 120
+
+// Payload verification
+#define HP2P_CORRUPT_LIST 10 // pairs with corrupted data listed in HTML
+
+// NUMA placement of the buffers (or a node number)
+#define HP2P_NUMA_NONE -1 // first touch
+#define HP2P_NUMA_NIC -2  // node of the network interface
+#define HP2P_BINDING_CPUS 64
+// Sources of the buffers (see hp2p_buffer_source_name)
+#define HP2P_SOURCE_MEMALIGN 0	// posix_memalign
+#define HP2P_SOURCE_ALLOC_MEM 1 // MPI_Alloc_mem
+#define HP2P_SOURCE_WINDOW 2	// MPI_Win_allocate
+#define HP2P_SOURCE_SHARED 3	// MPI_Win_allocate_shared on the node
+#define HP2P_SOURCE_MMAP 4	// mmap, optionally on huge pages
+#define HP2P_SOURCE_NB 5
+// Offsets of the buffers in a sweep
+#define HP2P_MAX_OFFSETS 16
+#define HP2P_SWEEP_COUNT 0 // samples of an offset
+#define HP2P_SWEEP_TIME 1  // average time
+#define HP2P_SWEEP_BW 2	   // average bandwidth
+#define HP2P_SWEEP_BEST 3  // best time
+
+// Derived datatype mode
+#define HP2P_TYPE_CONTIGUOUS 0 // contiguous messages only
+#define HP2P_TYPE_VECTOR 1     // MPI_Type_vector
+#define HP2P_TYPE_SUBARRAY 2   // MPI_Type_create_subarray
+
+// Messages of more than INT_MAX elements
+#if MPI_VERSION >= 4
+#define HP2P_LARGE_COUNT // MPI_Isend_c and MPI_Irecv_c
+#endif
+#ifndef HP2P_CHUNK_WORDS
+#define HP2P_CHUNK_WORDS (1LL << 30) // ints of a chunk without large counts
+#endif
+
+// Hostnames formatted at once by hp2p_mpi_get_host
+#define HP2P_HOST_SLOTS 4
+#define HP2P_HOST_NAME (MPI_MAX_PROCESSOR_NAME + 32) // with the local rank
+
+// Scenarios of a campaign (sections of a configuration file)
+#define HP2P_SCENARIO_NAME 64 // max length of the name of a section
+#define HP2P_SCENARIO_PENDING 0
+#define HP2P_SCENARIO_DONE 1
+#define HP2P_SCENARIO_FAILED 2	// buffers or restart could not be set up
+#define HP2P_SCENARIO_SKIPPED 3 // max_time of the campaign reached
+
+// Columns of the pair exports
+#define HP2P_EXPORT_COLUMNS 16
+
+// Encoding of the arrays embedded in the HTML outputs
+#define HP2P_HTML_TEXT 0   // JavaScript array literals
+#define HP2P_HTML_BASE64 1 // base64 little-endian typed arrays (default)
+// Types of the base64 arrays (size of one element in bytes)
+#define HP2P_HTML_FLOAT32 4
+#define HP2P_HTML_FLOAT64 8
+
 extern const char *hp2p_algo[];
 
 /**
@@ -56,7 +164,7 @@ typedef struct
 {
   int nb_shuffle;	      // number of iterations
   int snap_freq;	      // number of iterations between snapshots
-  int msg_size;		      // message size
+  long long msg_size;	      // message size in bytes
   int nb_msg;		      // number of messages per communication
   char inname[MAXCHARFILE];   // configuration filename
   char outname[MAXCHARFILE];  // output filename
@@ -68,12 +176,81 @@ typedef struct
   char plotlyjs[MAXCHARFILE]; // Path to a plotly.min.js
   double __start_time;
   int align_size;
-  char output_mode[32];
+  char output_mode[64]; // comma-separated list of output formats
   int alarm;
   double local_max_time;
   double time_mult;
+  int sync_mode;  // Synchronization mode around the timed window
+  int fence_freq; // Iterations between two MPI_Ibarrier fences (pair mode)
+  int clock_freq; // Iterations between two clock estimations (0 = disabled)
+  double timeline_mult; // Slow event threshold (multiple of pair mean)
+  int timeline_max_events; // Slowest events kept in the timeline (root)
+  int trace;		// Write a Chrome trace of the run
+  int trace_max_events; // Size of the trace buffer of each rank
+  double anomaly_zscore; // z-score threshold of the detector (0 = disabled)
+  double anomaly_ewma;	 // relative deviation from the EWMA (0 = disabled)
+  double anomaly_alpha;	 // EWMA smoothing factor
+  int anomaly_warmup;	 // samples of a pair before detection starts
+  int html_encoding;	 // HP2P_HTML_TEXT or HP2P_HTML_BASE64
+  int binary_precision;	 // bits of the floats of binary matrices (32 or 64)
+  int heatmap_tile;	 // size of the tiles of the HTML heatmap (0 = none)
+  int series_size;	 // max number of points of the series of iterations
+  int checkpoint;	 // write <outname>.ckpt at each snapshot
+  double converge_width;      // relative CI half-width to stop (0 = disabled)
+  double converge_fraction;   // fraction of pairs within converge_width
+  double converge_confidence; // confidence level of the intervals
+  int converge_level;	      // HP2P_CONVERGE_PAIR or HP2P_CONVERGE_NODE
+  int converge_freq;	      // iterations between two convergence checks
+  int converge_min;	      // samples of a pair before its interval is used
+  int warmup;		      // untimed exchanges before the timed window
+  int robust_samples;	      // samples kept per pair (0 = no estimators)
+  double robust_trim;	      // fraction trimmed at each end of the samples
+  int robust_groups;	      // groups of the median of means
+  double robust_noise;	      // relative gap of a noisy or slow pair
+  int verify;		      // check the payload of the messages
+  int numa_node;	      // NUMA node of the buffers or HP2P_NUMA_*
+  int hugepages;	      // huge page size of the buffers in MB (0 = none)
+  int buffer_source;	      // HP2P_SOURCE_*
+  int offsets[HP2P_MAX_OFFSETS]; // offsets of the buffers from a page
+  int nb_offsets;		 // offsets of the sweep (0 = no sweep)
+  int datatype;		 // HP2P_TYPE_*
+  int type_block;	 // vector: ints of a block
+  int type_stride;	 // vector: ints between the starts of two blocks
+  int type_ndims;	 // subarray: number of dimensions (1 to 3)
+  int type_sizes[3];	 // subarray: sizes of the array
+  int type_subsizes[3];	 // subarray: sizes of the subarray
+  char restart[MAXCHARFILE]; // checkpoint to restart from
 } hp2p_config;
 
+/**
+ * \struct clock
+ * \brief  Clock model of a rank
+ *
+ * Estimation of the offset and drift of the local clock relatively to the
+ * clock of the root, used to stamp samples in a global time base:
+ * global = local + offset + drift * (local - ref)
+ */
+typedef struct
+{
+  double offset; // offset with the root clock at ref
+  double drift;	 // drift relatively to the root clock
+  double ref;	 // local time of the last estimation
+  double rtt;	 // best round-trip time of the last estimation
+  int nb_sync;	 // number of estimations
+} hp2p_clock;
+
+/**
+ * \struct hp2p_binding
+ * \brief  Placement of a rank
+ */
+typedef struct
+{
+  int cpu_node;			 // NUMA node of the CPU (-1 = unknown)
+  int buffer_node;		 // NUMA node of the buffers (-1 = unknown)
+  int page_kb;			 // page size of the buffers in kB
+  char cpus[HP2P_BINDING_CPUS]; // CPU affinity ("0-3,8")
+} hp2p_binding;
+
 /**
  * \struct mpi_config
  * \brief  Configuration object for MPI
@@ -90,15 +267,171 @@ typedef struct
   MPI_Comm comm;
   MPI_Comm local_comm;
   char localhost[MPI_MAX_PROCESSOR_NAME];
-  char *hostlist;
+  // Host table (root, see hp2p_mpi_host_table)
+  char *host_names; // string table of the names of the nodes
+  int *host_offset; // offset of the name of each node
+  int *host_size;   // ranks of each node
+  int *host_node;   // node of each rank
+  int *host_rank;   // local rank of each rank on its node
+  int nb_hosts;
+  int anonymize; // hostnames replaced by rank_<rank>
+  hp2p_binding *bindings; // placement of each rank (root)
+  hp2p_clock clock;
 } hp2p_mpi_config;
 
+/**
+ * \struct hp2p_buffer
+ * \brief  Communication buffers of a rank
+ */
+typedef struct
+{
+  int *send;
+  int *recv;
+  size_t send_length; // mapped length (0 = not mapped)
+  size_t recv_length;
+  int source;	      // HP2P_SOURCE_*
+  void *base[2];      // MPI allocations of send and recv (unaligned)
+  MPI_Win win[2];     // windows of send and recv
+  int page_kb;	      // page size of the buffers in kB
+  MPI_Datatype type;  // derived datatype or MPI_DATATYPE_NULL
+  size_t extent;      // bytes spanned by the derived datatype
+  MPI_Request *req;   // requests of an exchange (see hp2p_buffer_chunks)
+  int nb_req;
+  int node;	      // NUMA node requested (-1 = first touch)
+#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
+  int *d_send;
+  int *d_recv;
+#endif
+} hp2p_buffer;
+
+/**
+ * \struct event
+ * \brief  Slow communication stamped in the global time base
+ */
+typedef struct
+{
+  double start; // global start time of the timed window
+  double time;	// time of communication
+  double mean;	// mean time of communication for this pair
+  int iteration;
+  int rank;
+  int other;
+} hp2p_event;
+
+/**
+ * \struct series
+ * \brief  Series of one value per iteration in bounded memory
+ *
+ * Bucket k holds the min, mean and max of the iterations k * width + 1 to
+ * (k + 1) * width. When capacity buckets are used, adjacent buckets are
+ * merged and the width doubles. Statistics of all the values are exact.
+ */
+typedef struct
+{
+  int capacity; // max number of buckets (even)
+  int size;	// number of buckets allocated
+  int count;	// number of buckets used
+  int width;	// iterations per bucket (power of 2)
+  int n;	// number of values
+  double *min;
+  double *mean;
+  double *max;
+  double avg; // mean of all the values
+  double m2;  // sum of squared deviations of all the values
+  double lo;  // min of all the values
+  double hi;  // max of all the values
+} hp2p_series;
+
+/**
+ * \struct checkpoint_header
+ * \brief  Header of a checkpoint file
+ *
+ * Followed by the hostname of each rank (MPI_MAX_PROCESSOR_NAME chars), the
+ * HP2P_CHECKPOINT_SERIES series of iterations (see hp2p_series_pack) and
+ * the row of each rank (HP2P_CHECKPOINT_ROW * nproc doubles).
+ */
+typedef struct
+{
+  char magic[8]; // HP2P_CHECKPOINT_MAGIC
+  int32_t version;
+  int32_t nproc;
+  int32_t iterations; // iterations done
+  int32_t nb_msg;
+  int64_t msg_size;
+  int32_t build;
+  int32_t seed; // the draws are replayed from the seed on restart
+  int32_t hostname_size;
+} hp2p_checkpoint_header;
+
+/**
+ * \struct trace_event
+ * \brief  Span (duration >= 0) or instant (duration < 0) of the trace
+ */
+typedef struct
+{
+  double start;	   // global start time
+  double duration; // duration in seconds
+  int phase;	   // HP2P_TRACE_*
+  int iteration;
+  int arg; // message index or -1
+} hp2p_trace_event;
+
+/**
+ * \struct anomaly
+ * \brief  Anomalous sample of a pair with its baseline
+ */
+typedef struct
+{
+  double time;	 // global start time of the timed window
+  double sample; // time of communication
+  double mean;	 // running mean of the pair before the sample
+  double stdd;	 // running standard deviation of the pair
+  double ewma;	 // EWMA of the pair before the sample
+  double zscore;
+  int iteration;
+  int rank;
+  int other;
+  int kinds; // HP2P_ANOMALY_* flags
+} hp2p_anomaly;
+
+/**
+ * \struct stats
+ * \brief  Partial statistics of a set of pairs
+ *
+ * Moments (Welford) and min/max with their locations, reduced across
+ * ranks with a user-defined MPI_Op.
+ */
+typedef struct
+{
+  double count;
+  double mean_time;
+  double m2_time;
+  double mean_bw;
+  double m2_bw;
+  double min_time;
+  double max_time;
+  double min_bw;
+  double max_bw;
+  int i_min_time;
+  int j_min_time;
+  int i_max_time;
+  int j_max_time;
+  int i_min_bw;
+  int j_min_bw;
+  int i_max_bw;
+  int j_max_bw;
+} hp2p_stats;
+
 typedef struct
 {
   int *l_count;
-  double *l_time;
-  int *g_count;
-  double *g_time;
+  double *l_time;     // accumulated times per other rank
+  double *l_avg_time; // average time per other rank
+  double *l_bw;	      // bandwidth per other rank
+  int gather;	      // matrices are needed by an output format
+  int *g_count;	      // matrices (root only)
+  double *g_time;     // accumulated times
+  double *g_avg_time; // average times
   double *g_bw;
   double msg_size;
   int nb_msg;
@@ -124,8 +457,14 @@ typedef struct
   int i_min_bw;
   int j_min_bw;
 
+  // Values of the iterations since the last reduction (pending)
   double *l_bsbw;
-  double *g_bsbw;
+  double *l_sync; // time spent in synchronization per iteration
+  double *l_wait; // wait before the timed window per iteration
+  int pending_size;
+  int reduced; // iterations already reduced in the global series
+
+  hp2p_series g_bsbw;
   double avg_bsbw;
   double sum_bsbw;
   double min_bsbw;
@@ -134,18 +473,135 @@ typedef struct
 
   int current_iteration;
 
-  double *monitor_build_couples;
-  double *monitor_heavyp2p;
-  double *monitor_snapshot;
+  hp2p_series monitor_build_couples;
+  hp2p_series monitor_heavyp2p;
+  hp2p_series monitor_snapshot;
+
+  hp2p_series g_sync; // average synchronization time over ranks
+  hp2p_series g_skew; // spread of the waits over ranks (start skew)
+  double avg_sync;
+  double max_sync;
+  double avg_skew;
+  double max_skew;
+
+  // Pending iterations stamped in the global time base (see l_bsbw)
+  double *l_start;  // global start time of the timed window per iteration
+  double *l_sample; // time of communication per iteration
+  int *l_other;	    // other rank of couple per iteration
+  hp2p_event *timeline; // slow events of all ranks (root only)
+  int nb_timeline;
+  int timeline_dropped; // slow events beyond timeline_max_events
+  int max_cluster; // largest number of simultaneous slow events
+
+  double *l_mean; // running mean of the time per other rank
+  double *l_m2;	  // running sum of squared deviations per other rank
+  double *l_ewma; // EWMA of the time per other rank
+  hp2p_anomaly *anomalies; // events buffered since the last snapshot
+  int nb_anomalies;
+  int max_anomalies;
+  int dropped_anomalies;  // events not logged by this rank (full buffer)
+  int nb_dropped_anomaly; // events not logged by all ranks
+  int l_nb_anomaly; // anomalies reported by this rank
+  int nb_anomaly;   // anomalies reported by all ranks
+  int l_kind_anomaly[HP2P_ANOMALY_NB_KINDS]; // per kind, by this rank
+  int kind_anomaly[HP2P_ANOMALY_NB_KINDS];   // per kind, by all ranks
+
+  // Confidence intervals of the time of the pairs (see hp2p_converge)
+  int *node_id;		   // node of each rank
+  int nb_nodes;
+  MPI_Datatype welford_type; // count, mean, m2
+  MPI_Op welford_op;
+  double converge_z;	   // quantile of the confidence level
+  long long converged;	   // pairs within converge_width
+  long long converge_total;   // pairs (of ranks or of nodes)
+  double converge_achieved;   // half-width reached by converge_fraction
+  int converge_stop;	   // target reached
+
+  // Robust estimators of the time of the pairs (see hp2p_robust)
+  double *l_samples;	 // robust_samples samples kept per other rank
+  int *l_seen;		 // samples seen per other rank
+  double *l_min;	 // best time per other rank
+  double *l_trim;	 // trimmed mean time per other rank
+  double *l_mom;	 // median of means time per other rank
+  unsigned int robust_state; // generator of the sampling of the samples
+  double avg_bw_trim;	 // average bandwidth of the pairs (trimmed mean)
+  double avg_bw_mom;	 // average bandwidth of the pairs (median of means)
+  double avg_bw_best;	 // average of the best bandwidth of the pairs
+  int noisy_pairs;	 // raw mean above (1 + robust_noise) * trimmed mean
+  int slow_pairs;	 // trimmed mean above (1 + robust_noise) * average
+
+  // Payload verification (see hp2p_verify)
+  int *l_corrupt;	     // corrupted exchanges per other rank
+  int *g_corrupt;	     // corrupted exchanges of all pairs (root)
+  long long l_corrupt_words; // corrupted words received
+  double l_verify_time;	     // time spent to fill and check the buffers
+  long long nb_corrupt;	     // corrupted exchanges of all ranks
+  int corrupt_pairs;	     // pairs with at least one corrupted exchange
+  long long corrupt_words;   // corrupted words of all ranks
+  double avg_verify_time;    // average verification time of a rank
+  double max_verify_time;    // maximum verification time of a rank
+  double verify_overhead;    // verification time / communication time
+
+  // Offset sweep (see hp2p_sweep): count, sum of times, sum of bandwidths
+  // and best time of the samples of each offset
+  double *l_offset; // local samples, 4 rows of nb_offsets
+  double *g_offset; // samples of all ranks
+
+  // Derived datatype mode (see hp2p_datatype)
+  double *l_type_time;	 // sum of the times per other rank
+  double *l_type_avg;	 // mean time per other rank
+  double *l_type_bw;	 // bandwidth per other rank
+  double avg_type_bw;	 // average bandwidth of the pairs
+  double avg_type_ratio; // average of datatype / contiguous bandwidth
+  double min_type_ratio; // lowest datatype / contiguous bandwidth
+  int i_min_type;
+  int j_min_type;
+
+  // Metrics file (see hp2p_metrics)
+  int metrics_nodes;  // number of nodes
+  double *metrics_bw; // sum of the bandwidths and pairs of each node (root)
+
+  MPI_Datatype stats_type;
+  MPI_Op stats_op;
 
   hp2p_mpi_config *mpi_conf;
   hp2p_config *conf;
 } hp2p_result;
 
+/**
+ * \struct hp2p_scenario
+ * \brief  Scenario of a campaign: its configuration and the statistics
+ *         of its run for the combined summary (root)
+ */
+typedef struct
+{
+  char name[HP2P_SCENARIO_NAME];
+  hp2p_config conf;
+  int status; // HP2P_SCENARIO_*
+  int iterations;
+  double duration;
+  double bw[3];	  // min, avg and max bandwidth of the pairs
+  double bsbw[3]; // min, avg and max bisection bandwidth
+  int nb_anomaly;
+  long long nb_corrupt;
+} hp2p_scenario;
+
+/**
+ * \struct hp2p_campaign
+ * \brief  Scenarios run one after the other in the same MPI job
+ */
+typedef struct
+{
+  int nb_scenarios;
+  hp2p_scenario *scenarios;
+} hp2p_campaign;
+
 // hp2p_algo
+extern char *hp2p_algo_name[];
 int hp2p_algo_get_num();
 char *hp2p_algo_get_name(int algo);
 void hp2p_algo_build_couples(int *v, int size, int algo);
+void hp2p_algo_reset();
 void hp2p_algo_mirroring_shift(int *v, int size);
 void hp2p_algo_bisection(int *v, int size);
 void hp2p_algo_random(int *v, int size);
@@ -155,26 +611,177 @@ void hp2p_util_set_default_config(hp2p_config *conf);
 void hp2p_util_free_config(hp2p_config *conf);
 void hp2p_util_display_config(hp2p_config conf);
 void hp2p_util_display_help(char command[]);
+void hp2p_util_set_key(hp2p_config *conf, const char *key, char *value);
+int hp2p_util_is_section(const char *line, char *name);
 void hp2p_util_read_configfile(hp2p_config *conf);
 void hp2p_util_read_commandline(int argc, char *argv[], hp2p_config *conf);
 double hp2p_util_get_time();
 void hp2p_util_init_tremain(hp2p_config *conf);
+int hp2p_util_has_format(hp2p_config *conf, const char *format);
 double hp2p_util_tremain(hp2p_config conf);
 
+// hp2p_clock
+void hp2p_clock_init(hp2p_clock *clock);
+void hp2p_clock_sync(hp2p_mpi_config *mpi_conf);
+double hp2p_clock_global(hp2p_clock *clock, double t);
+
+// hp2p_trace
+void hp2p_trace_init(hp2p_config *conf, hp2p_mpi_config *mpi_conf);
+void hp2p_trace_set_iteration(int iteration);
+int hp2p_trace_enabled();
+double hp2p_trace_begin();
+void hp2p_trace_end(int phase, double start, int arg);
+void hp2p_trace_instant(int phase, int arg);
+void hp2p_trace_write(hp2p_config *conf, hp2p_mpi_config *mpi_conf);
+void hp2p_trace_free();
+
+// hp2p_anomaly
+extern const char *hp2p_anomaly_kind[];
+int hp2p_anomaly_logged(hp2p_config *conf);
+void hp2p_anomaly_alloc(hp2p_result *result);
+void hp2p_anomaly_free(hp2p_result *result);
+int hp2p_anomaly_check(hp2p_result *result, int other, double sample,
+		       double start);
+void hp2p_anomaly_gather(hp2p_result *result);
+
 // hp2p_mpi
 int hp2p_mpi_init(int *argc, char ***argv, hp2p_mpi_config *mpi_conf);
 int hp2p_mpi_get_hostname(hp2p_mpi_config *mpi_conf, int anonymize);
+void hp2p_mpi_host_table(hp2p_mpi_config *mpi_conf, const char *nodename);
+char *hp2p_mpi_get_host(hp2p_mpi_config *mpi_conf, int rank);
+char **hp2p_mpi_get_hosts(hp2p_mpi_config *mpi_conf);
 int hp2p_mpi_finalize(hp2p_mpi_config *mpi_conf);
 
 // hp2p_result
 void hp2p_result_alloc(hp2p_result *result, hp2p_mpi_config *mpi_conf,
 		       hp2p_config *conf);
 void hp2p_result_free(hp2p_result *result);
+int hp2p_result_pending(hp2p_result *result);
 void hp2p_result_update(hp2p_result *result);
 void hp2p_result_display(hp2p_result *result);
+void hp2p_result_display_sweep(hp2p_result *result);
 void hp2p_result_display_time(hp2p_result *result);
 void hp2p_result_display_bw(hp2p_result *result);
 void hp2p_result_write(hp2p_result result);
+void hp2p_result_write_html_header(FILE *fp, hp2p_result result);
+void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result);
+void hp2p_result_write_html_corrupt(FILE *fp, hp2p_result *result);
+void hp2p_result_write_html_placement(FILE *fp, hp2p_result *result);
+void hp2p_result_write_html_sweep(FILE *fp, hp2p_result *result);
+void hp2p_result_write_html_footer(FILE *fp);
+void hp2p_result_free_html_assets();
+void hp2p_result_write_html_array(FILE *fp, hp2p_result result,
+				  const char *name, double *values, size_t n,
+				  double scale, int type, int scientific,
+				  int precision);
+
+// hp2p_export
+/**
+ * \struct hp2p_export_column
+ * \brief  Column of the pair exports (one value per other rank)
+ */
+typedef struct
+{
+  const char *name;
+  double *values; // real values
+  int *counts;	  // or integer values
+} hp2p_export_column;
+
+FILE *hp2p_export_open(hp2p_config *conf, const char *suffix);
+void hp2p_export_string(FILE *fp, const char *value);
+void hp2p_export_write(hp2p_result *result);
+
+// hp2p_writer
+FILE *hp2p_writer_open(const char *filename, const char *mode);
+int hp2p_writer_close(FILE *fp);
+void hp2p_writer_double(FILE *fp, double value, int scientific,
+			int precision);
+char *hp2p_writer_read_file(const char *filename, size_t *size);
+
+// hp2p_series
+void hp2p_series_init(hp2p_series *series, int capacity);
+void hp2p_series_free(hp2p_series *series);
+void hp2p_series_push(hp2p_series *series, double value);
+int hp2p_series_first(hp2p_series *series, int k);
+int hp2p_series_size(hp2p_series *series, int k);
+double hp2p_series_mean(hp2p_series *series, int first, int last);
+double hp2p_series_stdd(hp2p_series *series);
+int hp2p_series_packed_size(hp2p_series *series);
+void hp2p_series_pack(hp2p_series *series, double *buffer);
+void hp2p_series_unpack(hp2p_series *series, const double *buffer);
+
+// hp2p_converge
+void hp2p_converge_alloc(hp2p_result *result);
+void hp2p_converge_free(hp2p_result *result);
+int hp2p_converge_update(hp2p_result *result);
+
+// hp2p_robust
+void hp2p_robust_alloc(hp2p_result *result);
+void hp2p_robust_free(hp2p_result *result);
+void hp2p_robust_add(hp2p_result *result, int other, double sample);
+void hp2p_robust_update(hp2p_result *result);
+
+// hp2p_buffer
+extern const char *hp2p_buffer_source_name[];
+int hp2p_buffer_parse_node(const char *value);
+int hp2p_buffer_parse_pages(const char *value);
+int hp2p_buffer_parse_source(const char *value);
+void hp2p_buffer_parse_offsets(hp2p_config *conf, char *value);
+int hp2p_buffer_offset(hp2p_config *conf, int iteration);
+int hp2p_buffer_chunks(long long n);
+int hp2p_buffer_alloc(hp2p_buffer *buffer, hp2p_config *conf,
+		      hp2p_mpi_config *mpi_conf);
+void hp2p_buffer_free(hp2p_buffer *buffer, hp2p_mpi_config *mpi_conf);
+
+// hp2p_datatype
+extern const char *hp2p_datatype_name[];
+void hp2p_datatype_parse(hp2p_config *conf, const char *value);
+int hp2p_datatype_create(hp2p_config *conf, MPI_Datatype *type,
+			 size_t *extent, int root);
+void hp2p_datatype_alloc(hp2p_result *result);
+void hp2p_datatype_free(hp2p_result *result);
+void hp2p_datatype_update(hp2p_result *result);
+
+// hp2p_metrics
+void hp2p_metrics_alloc(hp2p_result *result);
+void hp2p_metrics_free(hp2p_result *result);
+void hp2p_metrics_write(hp2p_result *result);
+
+// hp2p_campaign
+extern const char *hp2p_campaign_status[];
+int hp2p_campaign_read(hp2p_campaign *campaign, hp2p_config *conf);
+void hp2p_campaign_record(hp2p_scenario *scenario, hp2p_result *result);
+void hp2p_campaign_write(hp2p_campaign *campaign, hp2p_config *conf,
+			 hp2p_mpi_config *mpi_conf);
+void hp2p_campaign_free(hp2p_campaign *campaign);
+
+// hp2p_sweep
+void hp2p_sweep_alloc(hp2p_result *result);
+void hp2p_sweep_free(hp2p_result *result);
+void hp2p_sweep_add(hp2p_result *result, int index, double sample);
+void hp2p_sweep_update(hp2p_result *result);
+double hp2p_sweep_stat(hp2p_result *result, int index, int stat);
+
+// hp2p_verify
+uint32_t hp2p_verify_key(int seed, int iteration, int sender);
+void hp2p_verify_fill(int *buf, size_t n, uint32_t key);
+long long hp2p_verify_check(const int *buf, size_t n, uint32_t key);
+void hp2p_verify_alloc(hp2p_result *result);
+void hp2p_verify_free(hp2p_result *result);
+void hp2p_verify_update(hp2p_result *result);
+
+// hp2p_checkpoint
+void hp2p_checkpoint_write(hp2p_result *result);
+int hp2p_checkpoint_read(hp2p_result *result, const char *filename);
+
+// hp2p_heatmap
+int hp2p_heatmap_levels(hp2p_result result);
+void hp2p_heatmap_write_html(FILE *fp, hp2p_result result);
+
+// hp2p_timeline
+void hp2p_timeline_update(hp2p_result *result);
+void hp2p_timeline_write_html(hp2p_result result);
+
 void init_signal_writer(hp2p_config conf);
-void check_signal(hp2p_result result);
+void check_signal(hp2p_result *result);
 #endif
@@ -22,6 +22,8 @@
 #include "hp2p.h"
 
 char *hp2p_algo_name[] = {"RANDOM", "SHIFT", "BISECTION", NULL};
+// Shift of the next draw of hp2p_algo_mirroring_shift
+static int hp2p_algo_shift = 0;
 
 /**
  * \fn     void hp2p_algo_get_num
@@ -71,7 +73,6 @@ char *hp2p_algo_get_name(int algo)
  **/
 void hp2p_algo_build_couples(int *v, int size, int algo)
 {
-  static int init = 0;
   // Generate random couples
   if (algo == 1)
   {
@@ -87,16 +88,24 @@ void hp2p_algo_build_couples(int *v, int size, int algo)
   }
 }
 
+/**
+ * \fn     void hp2p_algo_reset()
+ * \brief  Restart the draws from the first one (new run or scenario)
+ **/
+void hp2p_algo_reset()
+{
+  hp2p_algo_shift = 0;
+}
+
 void hp2p_algo_mirroring_shift(int *v, int size)
 {
-  static int init = 0;
   int i = 0;
   // Couples will be mirroring shift - ly permuted
   for (i = 0; i < size; i++)
   {
-    v[i] = (size + 1 - i + init) % size;
+    v[i] = (size + 1 - i + hp2p_algo_shift) % size;
   }
-  init++;
+  hp2p_algo_shift++;
 }
 
 void hp2p_algo_bisection(int *v, int size)
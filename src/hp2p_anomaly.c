@@ -0,0 +1,285 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_anomaly.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Online anomaly detector: running mean/variance (Welford) and
+ *            EWMA of the time of communication of each pair, with a
+ *            structured event log in JSON lines
+ */
+
+#include "hp2p.h"
+
+const char *hp2p_anomaly_kind[] = {"threshold", "mult", "zscore", "ewma"};
+
+/**
+ * \fn     int hp2p_anomaly_logged(hp2p_config *conf)
+ * \brief  Whether the events are logged (a statistical detector is on)
+ *
+ * \param  conf
+ * \return 1 with -Z or anomaly_ewma, else 0
+ **/
+int hp2p_anomaly_logged(hp2p_config *conf)
+{
+  return conf->anomaly_zscore > 0.0 || conf->anomaly_ewma > 0.0;
+}
+
+/**
+ * \fn     void hp2p_anomaly_alloc(hp2p_result *result)
+ * \brief  Allocate the detector state and truncate the event log (kept
+ *         on restart)
+ *
+ * \param  result
+ **/
+void hp2p_anomaly_alloc(hp2p_result *result)
+{
+  FILE *fp = NULL;
+  char *filename = NULL;
+  int nproc = result->mpi_conf->nproc;
+
+  result->l_mean = (double *)calloc(nproc, sizeof(double));
+  result->l_m2 = (double *)calloc(nproc, sizeof(double));
+  result->l_ewma = (double *)calloc(nproc, sizeof(double));
+  // Event buffer of the log only
+  result->max_anomalies =
+      hp2p_anomaly_logged(result->conf) ? HP2P_ANOMALY_BUFFER : 0;
+  result->anomalies = NULL;
+  if (result->max_anomalies > 0)
+    result->anomalies =
+	(hp2p_anomaly *)malloc(result->max_anomalies * sizeof(hp2p_anomaly));
+  result->nb_anomalies = 0;
+  result->l_nb_anomaly = 0;
+  result->nb_anomaly = 0;
+  memset(result->l_kind_anomaly, 0, sizeof(result->l_kind_anomaly));
+  memset(result->kind_anomaly, 0, sizeof(result->kind_anomaly));
+  result->dropped_anomalies = 0;
+  result->nb_dropped_anomaly = 0;
+
+  if (hp2p_anomaly_logged(result->conf) &&
+      result->mpi_conf->rank == result->mpi_conf->root)
+  {
+    filename =
+	(char *)malloc((strlen(result->conf->outname) + 32) * sizeof(char));
+    strcpy(filename, result->conf->outname);
+    strcat(filename, "-anomalies.jsonl");
+    // Events of the checkpointed iterations are kept with -R
+    fp = fopen(filename, strlen(result->conf->restart) > 0 ? "a" : "w");
+    if (fp != NULL)
+      fclose(fp);
+    free(filename);
+  }
+}
+
+void hp2p_anomaly_free(hp2p_result *result)
+{
+  free(result->l_mean);
+  free(result->l_m2);
+  free(result->l_ewma);
+  free(result->anomalies);
+}
+
+/**
+ * \fn     int hp2p_anomaly_check(hp2p_result *result, int other,
+ *                                double sample, double start)
+ * \brief  Check a new sample of a pair then add it to the pair statistics
+ *
+ * The sample is compared to the baseline of the pair before it is
+ * included: z-score against the running mean and standard deviation
+ * (-Z), and ratio against the EWMA (anomaly_ewma). -X compares it to the
+ * average time of all pairs at the last snapshot. Cost is O(1) per
+ * sample.
+ * l_count[other] must already count the sample.
+ *
+ * \param  result
+ * \param  other  other rank of couple
+ * \param  sample time of communication
+ * \param  start  global start time of the timed window
+ * \return HP2P_ANOMALY_* flags of the sample
+ **/
+int hp2p_anomaly_check(hp2p_result *result, int other, double sample,
+		       double start)
+{
+  hp2p_config *conf = result->conf;
+  hp2p_anomaly *ev = NULL;
+  double mean = 0.0;
+  double stdd = 0.0;
+  double ewma = 0.0;
+  double zscore = 0.0;
+  double delta = 0.0;
+  int n = 0;
+  int kinds = 0;
+  int k = 0;
+
+  n = result->l_count[other] - 1; // samples in the baseline
+  mean = result->l_mean[other];
+  ewma = result->l_ewma[other];
+  if (n > 1)
+    stdd = sqrt(result->l_m2[other] / (n - 1));
+  if (stdd > 0.0)
+    zscore = (sample - mean) / stdd;
+
+  // Fixed thresholds (-M and -X)
+  if (conf->time_mult < 1. && conf->local_max_time > 0.0 &&
+      conf->local_max_time < sample)
+    kinds |= HP2P_ANOMALY_THRESHOLD;
+  if (conf->time_mult >= 1. && result->avg_time > 0.0 &&
+      conf->time_mult * result->avg_time < sample)
+    kinds |= HP2P_ANOMALY_MULT;
+  // Statistical detectors
+  if (n >= conf->anomaly_warmup)
+  {
+    if (conf->anomaly_zscore > 0.0 && zscore > conf->anomaly_zscore)
+      kinds |= HP2P_ANOMALY_ZSCORE;
+    if (conf->anomaly_ewma > 0.0 && sample > (1.0 + conf->anomaly_ewma) * ewma)
+      kinds |= HP2P_ANOMALY_EWMA;
+  }
+
+  // Welford and EWMA updates
+  delta = sample - mean;
+  result->l_mean[other] = mean + delta / (n + 1);
+  result->l_m2[other] += delta * (sample - result->l_mean[other]);
+  if (n == 0)
+    result->l_ewma[other] = sample;
+  else
+    result->l_ewma[other] =
+	conf->anomaly_alpha * sample + (1.0 - conf->anomaly_alpha) * ewma;
+
+  // Only the lower rank of the pair reports
+  if (kinds && result->mpi_conf->rank < other)
+  {
+    result->l_nb_anomaly++;
+    for (k = 0; k < HP2P_ANOMALY_NB_KINDS; k++)
+      if (kinds & (1 << k))
+	result->l_kind_anomaly[k]++;
+    if (hp2p_anomaly_logged(conf))
+    {
+      if (result->nb_anomalies < result->max_anomalies)
+      {
+	ev = &result->anomalies[result->nb_anomalies++];
+	ev->time = start;
+	ev->sample = sample;
+	ev->mean = mean;
+	ev->stdd = stdd;
+	ev->ewma = ewma;
+	ev->zscore = zscore;
+	ev->iteration = result->current_iteration;
+	ev->rank = result->mpi_conf->rank;
+	ev->other = other;
+	ev->kinds = kinds;
+      }
+      else
+	result->dropped_anomalies++;
+    }
+  }
+  return kinds;
+}
+
+void hp2p_anomaly_write_events(FILE *fp, hp2p_result *result,
+			       hp2p_anomaly *ev, int nb)
+{
+  int i = 0;
+  int k = 0;
+  int first = 0;
+
+  for (i = 0; i < nb; i++)
+  {
+    fprintf(fp,
+	    "{\"iteration\": %d, \"time\": %.6lf, \"kinds\": [", ev[i].iteration,
+	    ev[i].time);
+    for (k = 0, first = 1; k < HP2P_ANOMALY_NB_KINDS; k++)
+      if (ev[i].kinds & (1 << k))
+      {
+	fprintf(fp, "%s\"%s\"", first ? "" : ", ", hp2p_anomaly_kind[k]);
+	first = 0;
+      }
+    fprintf(fp, "], \"rank\": %d, \"host\": ", ev[i].rank);
+    hp2p_export_string(fp, hp2p_mpi_get_host(result->mpi_conf, ev[i].rank));
+    fprintf(fp, ", \"peer\": %d, \"peer_host\": ", ev[i].other);
+    hp2p_export_string(fp, hp2p_mpi_get_host(result->mpi_conf, ev[i].other));
+    fprintf(fp,
+	    ", \"sample\": %.9e, \"mean\": %.9e, \"stddev\": %.9e, "
+	    "\"ewma\": %.9e, \"zscore\": %.3lf, \"msg_size\": %lld}\n",
+	    ev[i].sample, ev[i].mean, ev[i].stdd, ev[i].ewma, ev[i].zscore,
+	    result->conf->msg_size);
+  }
+}
+
+/**
+ * \fn     void hp2p_anomaly_gather(hp2p_result *result)
+ * \brief  Count anomalies and append buffered events to the log
+ *
+ * Events beyond HP2P_ANOMALY_BUFFER per rank between two calls are
+ * dropped from the log but counted.
+ * Events buffered since the last call are received by the root one rank
+ * at a time and appended to <outname>-anomalies.jsonl.
+ * This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_anomaly_gather(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  FILE *fp = NULL;
+  char *filename = NULL;
+  hp2p_anomaly *buf = NULL;
+  int nb = 0;
+  int r = 0;
+
+  MPI_Allreduce(&result->l_nb_anomaly, &result->nb_anomaly, 1, MPI_INT,
+		MPI_SUM, mpi_conf->comm);
+  MPI_Allreduce(result->l_kind_anomaly, result->kind_anomaly,
+		HP2P_ANOMALY_NB_KINDS, MPI_INT, MPI_SUM, mpi_conf->comm);
+  MPI_Allreduce(&result->dropped_anomalies, &result->nb_dropped_anomaly, 1,
+		MPI_INT, MPI_SUM, mpi_conf->comm);
+  if (!hp2p_anomaly_logged(result->conf))
+    return;
+
+  if (mpi_conf->rank != mpi_conf->root)
+  {
+    MPI_Send(&result->nb_anomalies, 1, MPI_INT, mpi_conf->root,
+	     HP2P_TAG_ANOMALY, mpi_conf->comm);
+    MPI_Send(result->anomalies, result->nb_anomalies * sizeof(hp2p_anomaly),
+	     MPI_BYTE, mpi_conf->root, HP2P_TAG_ANOMALY, mpi_conf->comm);
+  }
+  else
+  {
+    filename =
+	(char *)malloc((strlen(result->conf->outname) + 32) * sizeof(char));
+    strcpy(filename, result->conf->outname);
+    strcat(filename, "-anomalies.jsonl");
+    fp = hp2p_writer_open(filename, "a");
+    buf = (hp2p_anomaly *)malloc(result->max_anomalies * sizeof(hp2p_anomaly));
+    if (fp != NULL)
+      hp2p_anomaly_write_events(fp, result, result->anomalies,
+				result->nb_anomalies);
+    for (r = 0; r < mpi_conf->nproc; r++)
+    {
+      if (r == mpi_conf->root)
+	continue;
+      MPI_Recv(&nb, 1, MPI_INT, r, HP2P_TAG_ANOMALY, mpi_conf->comm,
+	       MPI_STATUS_IGNORE);
+      MPI_Recv(buf, nb * sizeof(hp2p_anomaly), MPI_BYTE, r, HP2P_TAG_ANOMALY,
+	       mpi_conf->comm, MPI_STATUS_IGNORE);
+      if (fp != NULL)
+	hp2p_anomaly_write_events(fp, result, buf, nb);
+    }
+    if (fp != NULL)
+      hp2p_writer_close(fp);
+    free(buf);
+    free(filename);
+  }
+  result->nb_anomalies = 0;
+}
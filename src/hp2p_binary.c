@@ -0,0 +1,311 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_binary.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Reader of the binary result format (version 3)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hp2p_binary.h"
+
+const char *hp2p_binary_errors[] = {"success",
+				    "cannot open file",
+				    "not an HP2P binary file (version 3)",
+				    "unsupported version",
+				    "file written with another byte order",
+				    "checksum mismatch"};
+
+/**
+ * \fn     uint64_t hp2p_binary_checksum(uint64_t hash, const void *data,
+ *                                       size_t size)
+ * \brief  Update a FNV-1a hash
+ *
+ * \param  hash HP2P_BINARY_CHECKSUM_INIT or previous value
+ * \param  data
+ * \param  size number of bytes
+ * \return updated hash
+ **/
+uint64_t hp2p_binary_checksum(uint64_t hash, const void *data, size_t size)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  size_t i = 0;
+
+  for (i = 0; i < size; i++)
+  {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * \fn     size_t hp2p_binary_type_size(uint32_t type)
+ * \brief  Size of an element of a section
+ *
+ * \param  type HP2P_BINARY_<type>
+ * \return bytes, 0 for an unknown type
+ **/
+size_t hp2p_binary_type_size(uint32_t type)
+{
+  switch (type)
+  {
+  case HP2P_BINARY_CHAR:
+    return 1;
+  case HP2P_BINARY_INT32:
+  case HP2P_BINARY_FLOAT32:
+    return 4;
+  case HP2P_BINARY_FLOAT64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * \fn     int hp2p_binary_check_sections(const hp2p_binary *bin)
+ * \brief  Check that the sections lie in the file and that the hostname
+ *         offsets lie in the string table
+ *
+ * Needed even without the checksum so that a truncated or corrupted file
+ * cannot be read outside of the mapping.
+ *
+ * \param  bin mapped file (header not set yet)
+ * \return 1 if the sections are valid, else 0
+ **/
+int hp2p_binary_check_sections(const hp2p_binary *bin)
+{
+  const hp2p_binary_header *h = (const hp2p_binary_header *)bin->map;
+  const hp2p_binary_section *sec = NULL;
+  const hp2p_binary_section *strings = NULL;
+  const hp2p_binary_section *hosts = NULL;
+  const int32_t *offsets = NULL;
+  size_t elem = 0;
+  uint64_t r = 0;
+  uint32_t i = 0;
+
+  for (i = 0; i < h->nb_sections; i++)
+  {
+    sec = &h->sections[i];
+    elem = hp2p_binary_type_size(sec->type);
+    // offset + count * elem <= size, without overflow
+    if (elem == 0 || sec->offset > bin->size || sec->offset % elem != 0 ||
+	sec->count > (bin->size - sec->offset) / elem)
+      return 0;
+    if (sec->id == HP2P_BINARY_HOSTNAMES)
+      strings = sec;
+    else if (sec->id == HP2P_BINARY_HOSTS)
+      hosts = sec;
+  }
+  if (hosts == NULL)
+    return 1;
+  if (hosts->type != HP2P_BINARY_INT32)
+    return 0;
+  if (hosts->count == 0)
+    return 1;
+  // NUL-terminated string table holding the name of every rank
+  if (strings == NULL || strings->type != HP2P_BINARY_CHAR ||
+      strings->count == 0 ||
+      ((const char *)bin->map)[strings->offset + strings->count - 1] != '\0')
+    return 0;
+  offsets = (const int32_t *)((const char *)bin->map + hosts->offset);
+  for (r = 0; r < hosts->count; r++)
+    if (offsets[r] < 0 || (uint64_t)offsets[r] >= strings->count)
+      return 0;
+  return 1;
+}
+
+/**
+ * \fn     int hp2p_binary_open(hp2p_binary *bin, const char *filename,
+ *                              int check)
+ * \brief  Map a binary result file and check its header
+ *
+ * \param  bin (output)
+ * \param  filename
+ * \param  check verify the checksum of the file
+ * \return HP2P_BINARY_OK or an error (see hp2p_binary_error)
+ **/
+int hp2p_binary_open(hp2p_binary *bin, const char *filename, int check)
+{
+  const hp2p_binary_header *h = NULL;
+  struct stat st;
+  int fd = 0;
+
+  bin->map = NULL;
+  bin->size = 0;
+  bin->header = NULL;
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return HP2P_BINARY_EOPEN;
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    return HP2P_BINARY_EOPEN;
+  }
+  if ((size_t)st.st_size < sizeof(hp2p_binary_header))
+  {
+    close(fd);
+    return HP2P_BINARY_EFORMAT;
+  }
+  bin->size = st.st_size;
+  bin->map = mmap(NULL, bin->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (bin->map == MAP_FAILED)
+  {
+    bin->map = NULL;
+    return HP2P_BINARY_EOPEN;
+  }
+
+  h = (const hp2p_binary_header *)bin->map;
+  if (memcmp(h->magic, HP2P_BINARY_MAGIC, sizeof(HP2P_BINARY_MAGIC)) != 0)
+  {
+    hp2p_binary_close(bin);
+    return HP2P_BINARY_EFORMAT;
+  }
+  if (h->endian != HP2P_BINARY_ENDIAN)
+  {
+    hp2p_binary_close(bin);
+    return HP2P_BINARY_EENDIAN;
+  }
+  if (h->version != HP2P_BINARY_VERSION)
+  {
+    hp2p_binary_close(bin);
+    return HP2P_BINARY_EVERSION;
+  }
+  if (h->file_size != bin->size || h->header_size > bin->size ||
+      h->nb_sections > HP2P_BINARY_MAX_SECTIONS)
+  {
+    hp2p_binary_close(bin);
+    return HP2P_BINARY_EFORMAT;
+  }
+  if (!hp2p_binary_check_sections(bin))
+  {
+    hp2p_binary_close(bin);
+    return HP2P_BINARY_EFORMAT;
+  }
+  if (check &&
+      hp2p_binary_checksum(HP2P_BINARY_CHECKSUM_INIT,
+			   (const char *)bin->map + h->header_size,
+			   bin->size - h->header_size) != h->checksum)
+  {
+    hp2p_binary_close(bin);
+    return HP2P_BINARY_ECHECKSUM;
+  }
+  bin->header = h;
+  return HP2P_BINARY_OK;
+}
+
+void hp2p_binary_close(hp2p_binary *bin)
+{
+  if (bin->map != NULL)
+    munmap(bin->map, bin->size);
+  bin->map = NULL;
+  bin->size = 0;
+  bin->header = NULL;
+}
+
+const char *hp2p_binary_error(int err)
+{
+  if (err < HP2P_BINARY_OK || err > HP2P_BINARY_ECHECKSUM)
+    return "unknown error";
+  return hp2p_binary_errors[err];
+}
+
+/**
+ * \fn     const void *hp2p_binary_section_data(const hp2p_binary *bin,
+ *                                             uint32_t id, uint64_t *count,
+ *                                             uint32_t *type)
+ * \brief  Find a section in a mapped file
+ *
+ * \param  bin
+ * \param  id    HP2P_BINARY_<section>
+ * \param  count number of elements (output, may be NULL)
+ * \param  type  type of the elements (output, may be NULL)
+ * \return pointer to the first element or NULL if the section is absent
+ **/
+const void *hp2p_binary_section_data(const hp2p_binary *bin, uint32_t id,
+				     uint64_t *count, uint32_t *type)
+{
+  const hp2p_binary_section *sec = NULL;
+  uint32_t i = 0;
+
+  for (i = 0; i < bin->header->nb_sections; i++)
+  {
+    sec = &bin->header->sections[i];
+    if (sec->id == id)
+    {
+      if (count != NULL)
+	*count = sec->count;
+      if (type != NULL)
+	*type = sec->type;
+      return (const char *)bin->map + sec->offset;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * \fn     double hp2p_binary_get(const hp2p_binary *bin, uint32_t id,
+ *                                uint64_t i)
+ * \brief  Read one element of a numeric section whatever its type
+ *
+ * \param  bin
+ * \param  id HP2P_BINARY_<section>
+ * \param  i  index of the element (i * nproc + j for matrices)
+ * \return value, 0 if the section or the element does not exist
+ **/
+double hp2p_binary_get(const hp2p_binary *bin, uint32_t id, uint64_t i)
+{
+  const void *data = NULL;
+  uint64_t count = 0;
+  uint32_t type = 0;
+
+  data = hp2p_binary_section_data(bin, id, &count, &type);
+  if (data == NULL || i >= count)
+    return 0.0;
+  switch (type)
+  {
+  case HP2P_BINARY_INT32:
+    return ((const int32_t *)data)[i];
+  case HP2P_BINARY_FLOAT32:
+    return ((const float *)data)[i];
+  case HP2P_BINARY_FLOAT64:
+    return ((const double *)data)[i];
+  default:
+    return 0.0;
+  }
+}
+
+const char *hp2p_binary_hostname(const hp2p_binary *bin, int rank)
+{
+  const char *strings = NULL;
+  const int32_t *hosts = NULL;
+  uint64_t count = 0;
+
+  strings = (const char *)hp2p_binary_section_data(bin, HP2P_BINARY_HOSTNAMES,
+						   NULL, NULL);
+  hosts = (const int32_t *)hp2p_binary_section_data(bin, HP2P_BINARY_HOSTS,
+						    &count, NULL);
+  if (strings == NULL || hosts == NULL || rank < 0 || (uint64_t)rank >= count)
+    return "";
+  return strings + hosts[rank];
+}
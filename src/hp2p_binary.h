@@ -0,0 +1,130 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_binary.h
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Binary result format (version 3) and its reader.
+ *
+ *            A file starts with a fixed-size header (hp2p_binary_header)
+ *            holding the magic, the version, an endianness marker, the
+ *            configuration of the run, a checksum and the table of
+ *            sections. Each section starts at an offset aligned on
+ *            HP2P_BINARY_ALIGN bytes so that a mapped file can be used
+ *            in place. Values are in the byte order of the writer.
+ *
+ *            This header does not depend on MPI.
+ */
+#ifndef __HP2P_BINARY_H__
+#define __HP2P_BINARY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HP2P_BINARY_MAGIC "HP2PBIN"
+#define HP2P_BINARY_VERSION 3
+#define HP2P_BINARY_ENDIAN 0x01020304
+#define HP2P_BINARY_ALIGN 64
+#define HP2P_BINARY_MAX_SECTIONS 16
+#define HP2P_BINARY_CHECKSUM_INIT 0xcbf29ce484222325ULL // FNV-1a offset
+
+// Sections
+#define HP2P_BINARY_HOSTNAMES 1 // string table (NUL-terminated hostnames)
+#define HP2P_BINARY_HOSTS 2	// offset of the hostname of each rank
+#define HP2P_BINARY_BANDWIDTH 3 // bandwidth matrix (B/s)
+#define HP2P_BINARY_TIME 4	// average time matrix (s)
+#define HP2P_BINARY_COUNT 5	// number of communications matrix
+// Bisection bandwidth of each iteration, or mean of nb_iterations / count
+// iterations (rounded up to a power of 2) when the series was downsampled
+#define HP2P_BINARY_BISECTION 6
+
+// Types of the elements of a section
+#define HP2P_BINARY_CHAR 1
+#define HP2P_BINARY_INT32 2
+#define HP2P_BINARY_FLOAT32 3
+#define HP2P_BINARY_FLOAT64 4
+
+// Errors of hp2p_binary_open
+#define HP2P_BINARY_OK 0
+#define HP2P_BINARY_EOPEN 1	// cannot open or map the file
+#define HP2P_BINARY_EFORMAT 2	// not an HP2P v3 file (or truncated)
+#define HP2P_BINARY_EVERSION 3	// unsupported version
+#define HP2P_BINARY_EENDIAN 4	// written on a host of other byte order
+#define HP2P_BINARY_ECHECKSUM 5 // corrupted file
+
+typedef struct
+{
+  uint32_t id;	   // HP2P_BINARY_<section>
+  uint32_t type;   // HP2P_BINARY_<type>
+  uint64_t offset; // from the start of the file
+  uint64_t count;  // number of elements
+} hp2p_binary_section;
+
+typedef struct
+{
+  char magic[8];	// HP2P_BINARY_MAGIC
+  uint32_t version;	// HP2P_BINARY_VERSION
+  uint32_t endian;	// HP2P_BINARY_ENDIAN in the byte order of the writer
+  uint64_t checksum;	// FNV-1a of the bytes after the header
+  uint64_t file_size;	// total size of the file
+  uint32_t header_size; // sizeof(hp2p_binary_header)
+  uint32_t nb_sections;
+  // Configuration of the run
+  int32_t nproc;
+  int32_t nb_shuffle;	 // number of iterations requested
+  int32_t nb_iterations; // number of iterations done
+  int32_t snap_freq;
+  int64_t msg_size; // bytes (version 3, int32_t in version 2)
+  int32_t nb_msg;
+  int32_t align_size;
+  int32_t build;
+  int32_t seed;
+  int32_t sync_mode;
+  int32_t reserved; // alignment of the dates
+  double start_time; // start of the run (seconds since epoch)
+  double write_time; // date of the file (seconds since epoch)
+  hp2p_binary_section sections[HP2P_BINARY_MAX_SECTIONS];
+} hp2p_binary_header;
+
+/**
+ * \struct binary
+ * \brief  File opened by hp2p_binary_open (read-only mapping)
+ */
+typedef struct
+{
+  void *map;
+  size_t size;
+  const hp2p_binary_header *header;
+} hp2p_binary;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+  uint64_t hp2p_binary_checksum(uint64_t hash, const void *data, size_t size);
+  size_t hp2p_binary_type_size(uint32_t type);
+  int hp2p_binary_check_sections(const hp2p_binary *bin);
+  int hp2p_binary_open(hp2p_binary *bin, const char *filename, int check);
+  void hp2p_binary_close(hp2p_binary *bin);
+  const char *hp2p_binary_error(int err);
+  const void *hp2p_binary_section_data(const hp2p_binary *bin, uint32_t id,
+				       uint64_t *count, uint32_t *type);
+  double hp2p_binary_get(const hp2p_binary *bin, uint32_t id, uint64_t i);
+  const char *hp2p_binary_hostname(const hp2p_binary *bin, int rank);
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,555 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_buffer.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Communication buffers, allocated once per run. They are either
+ *            aligned on align_size (first touch placement), or mapped with
+ *            mmap, optionally on huge pages, and bound to a NUMA node
+ *            (libnuma) before being touched, or allocated by the MPI
+ *            library (MPI_Alloc_mem or a window) which may register them
+ *            for zero-copy transfers. The CPU affinity and the NUMA
+ *            node of the CPU and of the buffers of each rank are gathered
+ *            by the root for the outputs. With an offset sweep, buffers
+ *            start on a page and the messages of an iteration are shifted
+ *            by one of the offsets.
+ */
+
+#define _GNU_SOURCE
+#include "hp2p.h"
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#ifdef _ENABLE_NUMA_
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+const char *hp2p_buffer_source_name[] = {"memalign", "alloc_mem", "window",
+					 "shared", "mmap"};
+
+/**
+ * \fn     int hp2p_buffer_parse_node(const char *value)
+ * \brief  NUMA placement of an option
+ *
+ * \param  value "nic", a node number or anything else for first touch
+ * \return node, HP2P_NUMA_NIC or HP2P_NUMA_NONE
+ **/
+int hp2p_buffer_parse_node(const char *value)
+{
+  if (strcmp(value, "nic") == 0)
+    return HP2P_NUMA_NIC;
+  if (value[0] >= '0' && value[0] <= '9')
+    return atoi(value);
+  return HP2P_NUMA_NONE;
+}
+
+/**
+ * \fn     int hp2p_buffer_parse_pages(const char *value)
+ * \brief  Huge page size of an option
+ *
+ * \param  value "2M", "1G" or "0"
+ * \return size in MB (0 = base pages)
+ **/
+int hp2p_buffer_parse_pages(const char *value)
+{
+  int size = atoi(value);
+  char *unit = strpbrk(value, "MmGg");
+
+  if (unit != NULL && (*unit == 'G' || *unit == 'g'))
+    size *= 1024;
+  return size;
+}
+
+/**
+ * \fn     int hp2p_buffer_parse_source(const char *value)
+ * \brief  Source of the buffers of an option
+ *
+ * \param  value name of a source (see hp2p_buffer_source_name)
+ * \return HP2P_SOURCE_*, HP2P_SOURCE_MEMALIGN if unknown
+ **/
+int hp2p_buffer_parse_source(const char *value)
+{
+  int i = 0;
+
+  for (i = 0; i < HP2P_SOURCE_NB; i++)
+    if (strcmp(value, hp2p_buffer_source_name[i]) == 0)
+      return i;
+  return HP2P_SOURCE_MEMALIGN;
+}
+
+/**
+ * \fn     void hp2p_buffer_parse_offsets(hp2p_config *conf, char *value)
+ * \brief  Offsets of the sweep of an option
+ *
+ * Offsets are bytes from a page boundary, rounded down to a multiple of
+ * the size of an int since messages are sent as MPI_INT.
+ *
+ * \param  conf
+ * \param  value comma-separated offsets ("0,8,64,4000") or "" for none
+ **/
+void hp2p_buffer_parse_offsets(hp2p_config *conf, char *value)
+{
+  char *token = NULL;
+  char *saveptr = NULL;
+  char *list = strdup(value);
+
+  conf->nb_offsets = 0;
+  for (token = strtok_r(list, ",", &saveptr);
+       token != NULL && conf->nb_offsets < HP2P_MAX_OFFSETS;
+       token = strtok_r(NULL, ",", &saveptr))
+    conf->offsets[conf->nb_offsets++] =
+	abs(atoi(token)) / (int)sizeof(int) * (int)sizeof(int);
+  free(list);
+}
+
+/**
+ * \fn     int hp2p_buffer_offset(hp2p_config *conf, int iteration)
+ * \brief  Index in the offset sweep of an iteration
+ *
+ * Both ranks of a couple share the iteration, so they use the same offset.
+ *
+ * \param  conf
+ * \param  iteration
+ * \return index in conf->offsets or -1 without sweep
+ **/
+int hp2p_buffer_offset(hp2p_config *conf, int iteration)
+{
+  if (conf->nb_offsets == 0)
+    return -1;
+  return iteration % conf->nb_offsets;
+}
+
+/**
+ * \fn     int hp2p_buffer_chunks(long long n)
+ * \brief  Number of chunks of a message of n ints
+ *
+ * Without the large-count functions of MPI-4, messages are sent in chunks
+ * of at most HP2P_CHUNK_WORDS ints so that the count of each chunk fits
+ * in an int.
+ *
+ * \param  n
+ * \return number of chunks (at least 1)
+ **/
+int hp2p_buffer_chunks(long long n)
+{
+#ifdef HP2P_LARGE_COUNT
+  return 1;
+#else
+  if (n <= HP2P_CHUNK_WORDS)
+    return 1;
+  return (int)((n + HP2P_CHUNK_WORDS - 1) / HP2P_CHUNK_WORDS);
+#endif
+}
+
+/**
+ * \fn     int hp2p_buffer_nic_node()
+ * \brief  NUMA node of the network interface
+ *
+ * The first RDMA device is used, then the first network interface
+ * attached to a NUMA node.
+ *
+ * \return node or -1 if unknown
+ **/
+int hp2p_buffer_nic_node()
+{
+  const char *classes[] = {"/sys/class/infiniband", "/sys/class/net"};
+  char path[1024];
+  struct dirent *entry = NULL;
+  DIR *dir = NULL;
+  FILE *fp = NULL;
+  int node = -1;
+  int c = 0;
+
+  for (c = 0; c < 2 && node < 0; c++)
+  {
+    dir = opendir(classes[c]);
+    if (dir == NULL)
+      continue;
+    while (node < 0 && (entry = readdir(dir)) != NULL)
+    {
+      if (entry->d_name[0] == '.')
+	continue;
+      snprintf(path, sizeof(path), "%s/%s/device/numa_node", classes[c],
+	       entry->d_name);
+      fp = fopen(path, "r");
+      if (fp == NULL)
+	continue;
+      if (fscanf(fp, "%d", &node) != 1)
+	node = -1;
+      fclose(fp);
+    }
+    closedir(dir);
+  }
+  return node;
+}
+
+/**
+ * \fn     void hp2p_buffer_cpus(char *cpus, int size)
+ * \brief  CPU affinity of the rank as a list of ranges ("0-3,8")
+ *
+ * \param  cpus output string
+ * \param  size size of the output string
+ **/
+void hp2p_buffer_cpus(char *cpus, int size)
+{
+  cpu_set_t set;
+  int first = -1;
+  int len = 0;
+  int c = 0;
+
+  cpus[0] = '\0';
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set))
+    return;
+  for (c = 0; c <= CPU_SETSIZE && len < size; c++)
+  {
+    if (c < CPU_SETSIZE && CPU_ISSET(c, &set))
+    {
+      if (first < 0)
+	first = c;
+      continue;
+    }
+    if (first < 0)
+      continue;
+    if (first == c - 1)
+      len += snprintf(cpus + len, size - len, "%s%d", len ? "," : "", first);
+    else
+      len += snprintf(cpus + len, size - len, "%s%d-%d", len ? "," : "",
+		      first, c - 1);
+    first = -1;
+  }
+}
+
+/**
+ * \fn     int *hp2p_buffer_map(size_t size, int pages, int node,
+ *                              size_t *length, int *page_kb)
+ * \brief  Map a buffer, on huge pages and bound to a node if asked
+ *
+ * Falls back to base pages if no huge page is available.
+ *
+ * \param  size    size in bytes
+ * \param  pages   huge page size in MB (0 = base pages)
+ * \param  node    NUMA node or -1
+ * \param  length  mapped length (output)
+ * \param  page_kb page size of the mapping in kB (output)
+ * \return buffer or NULL
+ **/
+int *hp2p_buffer_map(size_t size, int pages, int node, size_t *length,
+		     int *page_kb)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  void *ptr = MAP_FAILED;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  int shift = 0;
+
+  if (pages > 0)
+  {
+    // log2 of the huge page size in bytes
+    for (shift = 20; (1 << (shift - 20)) < pages; shift++)
+      ;
+    *length = (size + ((size_t)1 << shift) - 1) >> shift << shift;
+    ptr = mmap(NULL, *length, PROT_READ | PROT_WRITE,
+	       flags | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+    *page_kb = 1 << (shift - 10);
+  }
+  if (ptr == MAP_FAILED)
+  {
+    *length = (size + page - 1) / page * page;
+    ptr = mmap(NULL, *length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    *page_kb = (int)(page / 1024);
+  }
+  if (ptr == MAP_FAILED)
+    return NULL;
+#ifdef _ENABLE_NUMA_
+  if (node >= 0 && numa_available() >= 0)
+    numa_tonode_memory(ptr, *length, node);
+#else
+  (void)node;
+#endif
+  return (int *)ptr;
+}
+
+/**
+ * \fn     int *hp2p_buffer_mpi(hp2p_buffer *buffer, int k, size_t size,
+ *                             int align, hp2p_mpi_config *mpi_conf)
+ * \brief  Allocate a buffer with the MPI library
+ *
+ * The allocation has align more bytes so that the buffer is aligned as
+ * with posix_memalign. Windows are collective over the run (window) or
+ * over the ranks of the node (shared), each rank has its own segment.
+ *
+ * \param  buffer   buffers of the run (buffer->source)
+ * \param  k        0 = send, 1 = recv
+ * \param  size     size in bytes
+ * \param  align    alignment of the buffer
+ * \param  mpi_conf
+ * \return buffer or NULL
+ **/
+int *hp2p_buffer_mpi(hp2p_buffer *buffer, int k, size_t size, int align,
+		     hp2p_mpi_config *mpi_conf)
+{
+  MPI_Aint length = (MPI_Aint)(size + align);
+  MPI_Info info = MPI_INFO_NULL;
+  uintptr_t ptr = 0;
+  void *base = NULL;
+
+  if (buffer->source == HP2P_SOURCE_ALLOC_MEM)
+  {
+    if (MPI_Alloc_mem(length, MPI_INFO_NULL, &base) != MPI_SUCCESS)
+      base = NULL;
+  }
+  else if (buffer->source == HP2P_SOURCE_WINDOW)
+    MPI_Win_allocate(length, 1, MPI_INFO_NULL, mpi_conf->comm, &base,
+		     &buffer->win[k]);
+  else
+  {
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    MPI_Win_allocate_shared(length, 1, info, mpi_conf->local_comm, &base,
+			    &buffer->win[k]);
+    MPI_Info_free(&info);
+  }
+  buffer->base[k] = base;
+  if (base == NULL)
+    return NULL;
+  ptr = ((uintptr_t)base + align - 1) / align * align;
+  return (int *)ptr;
+}
+
+/**
+ * \fn     int hp2p_buffer_node(void *ptr)
+ * \brief  NUMA node of a touched buffer
+ *
+ * \param  ptr
+ * \return node or -1 if unknown
+ **/
+int hp2p_buffer_node(void *ptr)
+{
+  int node = -1;
+
+#ifdef _ENABLE_NUMA_
+  if (numa_available() < 0 ||
+      get_mempolicy(&node, NULL, 0, ptr, MPOL_F_NODE | MPOL_F_ADDR))
+    node = -1;
+#else
+  (void)ptr;
+#endif
+  return node;
+}
+
+/**
+ * \fn     int hp2p_buffer_alloc(hp2p_buffer *buffer, hp2p_config *conf,
+ *                               hp2p_mpi_config *mpi_conf)
+ * \brief  Allocate and place the buffers of the run, gather the placement
+ *         of all ranks in mpi_conf->bindings on the root
+ *
+ * This function is collective.
+ *
+ * \param  buffer
+ * \param  conf
+ * \param  mpi_conf
+ * \return 0 on success, -1 if a rank cannot allocate its buffers
+ **/
+int hp2p_buffer_alloc(hp2p_buffer *buffer, hp2p_config *conf,
+		      hp2p_mpi_config *mpi_conf)
+{
+  hp2p_binding binding;
+  int recv_page = 0;
+  size_t size = 0;
+  int pad = 0;
+  int align = conf->align_size;
+  int node = conf->numa_node;
+  int status[3];
+  size_t n = 0;
+  size_t i = 0;
+
+  memset(buffer, 0, sizeof(hp2p_buffer));
+  memset(&binding, 0, sizeof(binding));
+  buffer->win[0] = buffer->win[1] = MPI_WIN_NULL;
+  // Placement options need buffers mapped by hp2p
+  if (conf->buffer_source == HP2P_SOURCE_MEMALIGN &&
+      (conf->hugepages > 0 || conf->numa_node != HP2P_NUMA_NONE))
+    conf->buffer_source = HP2P_SOURCE_MMAP;
+  buffer->source = conf->buffer_source;
+  if (hp2p_datatype_create(conf, &buffer->type, &buffer->extent,
+			   mpi_conf->rank == mpi_conf->root))
+  {
+    if (mpi_conf->rank == mpi_conf->root)
+      fprintf(stderr, "Invalid %s datatype\n",
+	      hp2p_datatype_name[conf->datatype]);
+    return -1;
+  }
+  size = conf->msg_size > 0 ? (size_t)conf->msg_size : sizeof(int);
+  if (buffer->extent > size)
+    size = buffer->extent;
+  if (node == HP2P_NUMA_NIC)
+    node = hp2p_buffer_nic_node();
+  buffer->node = node;
+  // Room for the largest offset of the sweep, from a page boundary
+  if (conf->nb_offsets > 0)
+  {
+    for (i = 0; i < (size_t)conf->nb_offsets; i++)
+      if (conf->offsets[i] > pad)
+	pad = conf->offsets[i];
+    size += pad;
+    align = (int)sysconf(_SC_PAGESIZE);
+  }
+  n = size / sizeof(int);
+  buffer->page_kb = (int)(sysconf(_SC_PAGESIZE) / 1024);
+  if (buffer->source == HP2P_SOURCE_MMAP)
+  {
+    buffer->send = hp2p_buffer_map(size, conf->hugepages, node,
+				   &buffer->send_length, &buffer->page_kb);
+    buffer->recv = hp2p_buffer_map(size, conf->hugepages, node,
+				   &buffer->recv_length, &recv_page);
+    if (recv_page < buffer->page_kb)
+      buffer->page_kb = recv_page;
+  }
+  else if (buffer->source == HP2P_SOURCE_MEMALIGN)
+  {
+    if (posix_memalign((void **)&buffer->send, align, size))
+      buffer->send = NULL;
+    if (posix_memalign((void **)&buffer->recv, align, size))
+      buffer->recv = NULL;
+  }
+  else
+  {
+    buffer->send = hp2p_buffer_mpi(buffer, 0, size, align, mpi_conf);
+    buffer->recv = hp2p_buffer_mpi(buffer, 1, size, align, mpi_conf);
+  }
+
+  // Local status: allocation failed, NIC not found, huge pages missing
+  status[0] = (buffer->send == NULL || buffer->recv == NULL);
+  status[1] = (conf->numa_node == HP2P_NUMA_NIC && node < 0 &&
+	       buffer->source == HP2P_SOURCE_MMAP);
+  status[2] = (conf->hugepages > 0 && buffer->source == HP2P_SOURCE_MMAP &&
+	       buffer->page_kb != conf->hugepages * 1024);
+  MPI_Allreduce(MPI_IN_PLACE, status, 3, MPI_INT, MPI_SUM, mpi_conf->comm);
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    if (status[1])
+      fprintf(stderr,
+	      "warning: NUMA node of the network interface not found on %d "
+	      "ranks, buffers are placed by first touch\n",
+	      status[1]);
+    if (status[2])
+      fprintf(stderr,
+	      "warning: no %d MB huge page available on %d ranks, base pages "
+	      "are used\n",
+	      conf->hugepages, status[2]);
+    if (buffer->source != HP2P_SOURCE_MMAP &&
+	(conf->hugepages > 0 || conf->numa_node != HP2P_NUMA_NONE))
+      fprintf(stderr,
+	      "warning: NUMA node and huge pages are ignored with buffers "
+	      "from %s\n",
+	      hp2p_buffer_source_name[buffer->source]);
+#ifndef _ENABLE_NUMA_
+    if (conf->numa_node != HP2P_NUMA_NONE)
+      fprintf(stderr, "warning: built without libnuma, buffers are placed "
+		      "by first touch\n");
+#endif
+  }
+  if (status[0])
+  {
+    if (mpi_conf->rank == mpi_conf->root)
+      fprintf(stderr, "Cannot allocate memory on %d ranks\n", status[0]);
+    hp2p_buffer_free(buffer, mpi_conf);
+    return -1;
+  }
+
+  // First touch
+  for (i = 0; i < n; i++)
+    buffer->send[i] = (int)i;
+  memset(buffer->recv, 0, size);
+  buffer->nb_req = 2 * hp2p_buffer_chunks(conf->msg_size / sizeof(int));
+  buffer->req = (MPI_Request *)malloc(buffer->nb_req * sizeof(MPI_Request));
+#ifdef _ENABLE_CUDA_
+  cudaMalloc(&buffer->d_send, n * sizeof(int));
+  cudaMalloc(&buffer->d_recv, n * sizeof(int));
+  cudaMemcpy(buffer->d_send, buffer->send, n * sizeof(int),
+	     cudaMemcpyHostToDevice);
+#endif
+#ifdef _ENABLE_ROCM_
+  hipMalloc(&buffer->d_send, n * sizeof(int));
+  hipMalloc(&buffer->d_recv, n * sizeof(int));
+  hipMemcpy(buffer->d_send, buffer->send, n * sizeof(int),
+	    hipMemcpyHostToDevice);
+#endif
+
+  // Placement of the rank
+  binding.cpu_node = -1;
+#ifdef _ENABLE_NUMA_
+  if (numa_available() >= 0)
+    binding.cpu_node = numa_node_of_cpu(sched_getcpu());
+#endif
+  binding.buffer_node = hp2p_buffer_node(buffer->send);
+  binding.page_kb = buffer->page_kb;
+  hp2p_buffer_cpus(binding.cpus, HP2P_BINDING_CPUS);
+  if (mpi_conf->rank == mpi_conf->root)
+    mpi_conf->bindings =
+	(hp2p_binding *)malloc(mpi_conf->nproc * sizeof(hp2p_binding));
+  MPI_Gather(&binding, sizeof(hp2p_binding), MPI_BYTE, mpi_conf->bindings,
+	     sizeof(hp2p_binding), MPI_BYTE, mpi_conf->root, mpi_conf->comm);
+  return 0;
+}
+
+void hp2p_buffer_free(hp2p_buffer *buffer, hp2p_mpi_config *mpi_conf)
+{
+  int k = 0;
+
+  if (buffer->source == HP2P_SOURCE_MMAP)
+  {
+    if (buffer->send != NULL)
+      munmap(buffer->send, buffer->send_length);
+    if (buffer->recv != NULL)
+      munmap(buffer->recv, buffer->recv_length);
+  }
+  else if (buffer->source == HP2P_SOURCE_MEMALIGN)
+  {
+    free(buffer->send);
+    free(buffer->recv);
+  }
+  // Windows are freed by all ranks (collective)
+  for (k = 0; k < 2; k++)
+  {
+    if (buffer->source == HP2P_SOURCE_ALLOC_MEM && buffer->base[k] != NULL)
+      MPI_Free_mem(buffer->base[k]);
+    if (buffer->win[k] != MPI_WIN_NULL)
+      MPI_Win_free(&buffer->win[k]);
+    buffer->base[k] = NULL;
+  }
+#ifdef _ENABLE_CUDA_
+  cudaFree(buffer->d_send);
+  cudaFree(buffer->d_recv);
+#endif
+#ifdef _ENABLE_ROCM_
+  hipFree(buffer->d_send);
+  hipFree(buffer->d_recv);
+#endif
+  buffer->send = NULL;
+  buffer->recv = NULL;
+  free(buffer->req);
+  buffer->req = NULL;
+  if (buffer->type != MPI_DATATYPE_NULL)
+    MPI_Type_free(&buffer->type);
+  free(mpi_conf->bindings);
+  mpi_conf->bindings = NULL;
+}
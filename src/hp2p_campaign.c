@@ -0,0 +1,223 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_campaign.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Campaign of scenarios. Each section "[name]" of the
+ *            configuration file is a scenario: the keys before the first
+ *            section and the command line are common to all of them, the
+ *            keys of a section only apply to its scenario. The scenarios
+ *            run one after the other in the same MPI job, with their own
+ *            outputs (<outname>-<name> by default), and the root writes a
+ *            combined summary in <outname>-campaign.json.
+ */
+
+#include "hp2p.h"
+
+const char *hp2p_campaign_status[] = {"pending", "done", "failed", "skipped"};
+
+/**
+ * \fn     int hp2p_campaign_read(hp2p_campaign *campaign, hp2p_config *conf)
+ * \brief  Read the sections of the configuration file as scenarios
+ *
+ * \param  campaign
+ * \param  conf     configuration common to the scenarios
+ * \return number of scenarios (0 if the file has no section)
+ **/
+int hp2p_campaign_read(hp2p_campaign *campaign, hp2p_config *conf)
+{
+  hp2p_scenario *scenario = NULL;
+  FILE *fp = NULL;
+  char *buffer = NULL;
+  int max_len = 1024;
+  char *key = NULL;
+  char *value = NULL;
+  char name[HP2P_SCENARIO_NAME];
+  int nb = 0;
+  int k = -1;
+
+  campaign->nb_scenarios = 0;
+  campaign->scenarios = NULL;
+  if (strlen(conf->inname) == 0)
+    return 0;
+  fp = fopen(conf->inname, "r");
+  if (fp == NULL)
+    return 0;
+
+  buffer = (char *)malloc(max_len * sizeof(char));
+  key = (char *)malloc(max_len * sizeof(char));
+  value = (char *)malloc(max_len * sizeof(char));
+  while (fgets(buffer, max_len - 1, fp))
+    nb += hp2p_util_is_section(buffer, NULL);
+  if (nb > 0)
+    campaign->scenarios =
+	(hp2p_scenario *)calloc(nb, sizeof(hp2p_scenario));
+  rewind(fp);
+  while (nb > 0 && fgets(buffer, max_len - 1, fp))
+  {
+    // Remove trailing newline
+    buffer[strcspn(buffer, "\n")] = 0;
+    if (hp2p_util_is_section(buffer, name))
+    {
+      scenario = &campaign->scenarios[++k];
+      if (strlen(name) == 0)
+	sprintf(name, "%d", k + 1);
+      strcpy(scenario->name, name);
+      // Start from the common configuration
+      scenario->conf = *conf;
+      scenario->conf.buildname = hp2p_algo_get_name(conf->build);
+      // <outname>-<name> unless the section has its own outname
+      if (strlen(conf->outname) + strlen(name) + 1 < MAXCHARFILE)
+      {
+	strcat(scenario->conf.outname, "-");
+	strcat(scenario->conf.outname, name);
+      }
+      scenario->status = HP2P_SCENARIO_PENDING;
+      continue;
+    }
+    if (k >= 0 && buffer[0] != '#' &&
+	sscanf(buffer, "%s = %s", key, value) == 2)
+      hp2p_util_set_key(&scenario->conf, key, value);
+  }
+  campaign->nb_scenarios = nb;
+  free(buffer);
+  free(key);
+  free(value);
+  fclose(fp);
+  return nb;
+}
+
+/**
+ * \fn     void hp2p_campaign_record(hp2p_scenario *scenario,
+ *                                   hp2p_result *result)
+ * \brief  Keep the statistics of a scenario for the combined summary
+ *
+ * Must follow the final hp2p_result_update of the scenario.
+ *
+ * \param  scenario
+ * \param  result
+ **/
+void hp2p_campaign_record(hp2p_scenario *scenario, hp2p_result *result)
+{
+  scenario->status = HP2P_SCENARIO_DONE;
+  // Set by hp2p_buffer_alloc (datatype payload, resolved source)
+  scenario->conf.msg_size = result->conf->msg_size;
+  scenario->conf.buffer_source = result->conf->buffer_source;
+  // Algorithm of the checkpoint on restart
+  scenario->conf.build = result->conf->build;
+  scenario->iterations = result->current_iteration;
+  scenario->bw[0] = result->min_bw;
+  scenario->bw[1] = result->avg_bw;
+  scenario->bw[2] = result->max_bw;
+  scenario->bsbw[0] = result->min_bsbw;
+  scenario->bsbw[1] = result->avg_bsbw;
+  scenario->bsbw[2] = result->max_bsbw;
+  scenario->nb_anomaly = result->nb_anomaly;
+  scenario->nb_corrupt = result->nb_corrupt;
+}
+
+/**
+ * \fn     void hp2p_campaign_write(hp2p_campaign *campaign,
+ *                                  hp2p_config *conf,
+ *                                  hp2p_mpi_config *mpi_conf)
+ * \brief  Display the combined summary of the scenarios and write it to
+ *         <outname>-campaign.json (root)
+ *
+ * \param  campaign
+ * \param  conf     configuration common to the scenarios
+ * \param  mpi_conf
+ **/
+void hp2p_campaign_write(hp2p_campaign *campaign, hp2p_config *conf,
+			 hp2p_mpi_config *mpi_conf)
+{
+  hp2p_scenario *s = NULL;
+  FILE *fp = NULL;
+  double m = 1048576.0;
+  int k = 0;
+
+  if (mpi_conf->rank != mpi_conf->root)
+    return;
+  printf("\n\n");
+  printf(" === CAMPAIGN SUMMARY ===\n\n");
+  printf(" %-20s %-8s %10s %12s %12s %12s %14s\n", "Scenario", "Status",
+	 "Iterations", "Msg size", "Min MB/s", "Avg MB/s", "Avg bisec MB/s");
+  for (k = 0; k < campaign->nb_scenarios; k++)
+  {
+    s = &campaign->scenarios[k];
+    printf(" %-20s %-8s %10d %12lld %12.2lf %12.2lf %14.2lf\n", s->name,
+	   hp2p_campaign_status[s->status], s->iterations, s->conf.msg_size,
+	   s->bw[0] / m, s->bw[1] / m, s->bsbw[1] / m);
+  }
+  printf("\n");
+  fflush(stdout);
+
+  fp = hp2p_export_open(conf, "-campaign.json");
+  if (fp == NULL)
+    return;
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"nproc\": %d,\n", mpi_conf->nproc);
+  fprintf(fp, "  \"config_file\": ");
+  hp2p_export_string(fp, conf->inname);
+  fprintf(fp, ",\n");
+  fprintf(fp, "  \"scenarios\": [");
+  for (k = 0; k < campaign->nb_scenarios; k++)
+  {
+    s = &campaign->scenarios[k];
+    fprintf(fp, "%s\n    {\n", k ? "," : "");
+    fprintf(fp, "      \"name\": ");
+    hp2p_export_string(fp, s->name);
+    fprintf(fp, ",\n      \"output\": ");
+    hp2p_export_string(fp, s->conf.outname);
+    fprintf(fp, ",\n");
+    fprintf(fp, "      \"status\": \"%s\",\n",
+	    hp2p_campaign_status[s->status]);
+    fprintf(fp, "      \"msg_size\": %lld,\n", s->conf.msg_size);
+    fprintf(fp, "      \"nb_msg\": %d,\n", s->conf.nb_msg);
+    fprintf(fp, "      \"build\": \"%s\",\n",
+	    hp2p_algo_name[s->conf.build]);
+    fprintf(fp, "      \"sync_mode\": \"%s\",\n",
+	    s->conf.sync_mode == HP2P_SYNC_PAIR ? "pairwise" : "barrier");
+    fprintf(fp, "      \"buffer_source\": \"%s\",\n",
+	    hp2p_buffer_source_name[s->conf.buffer_source]);
+    fprintf(fp, "      \"datatype\": \"%s\",\n",
+	    hp2p_datatype_name[s->conf.datatype]);
+    fprintf(fp, "      \"iterations_done\": %d,\n", s->iterations);
+    fprintf(fp, "      \"duration\": %.6lf,\n", s->duration);
+    fprintf(fp, "      \"min_bandwidth\": %.9e,\n", s->bw[0]);
+    fprintf(fp, "      \"avg_bandwidth\": %.9e,\n", s->bw[1]);
+    fprintf(fp, "      \"max_bandwidth\": %.9e,\n", s->bw[2]);
+    fprintf(fp, "      \"min_bisection_bandwidth\": %.9e,\n", s->bsbw[0]);
+    fprintf(fp, "      \"avg_bisection_bandwidth\": %.9e,\n", s->bsbw[1]);
+    fprintf(fp, "      \"max_bisection_bandwidth\": %.9e,\n", s->bsbw[2]);
+    fprintf(fp, "      \"anomalies\": %d,\n", s->nb_anomaly);
+    fprintf(fp, "      \"corrupted_exchanges\": %lld\n", s->nb_corrupt);
+    fprintf(fp, "    }");
+  }
+  fprintf(fp, "\n  ]\n");
+  fprintf(fp, "}\n");
+  hp2p_writer_close(fp);
+}
+
+void hp2p_campaign_free(hp2p_campaign *campaign)
+{
+  int k = 0;
+
+  for (k = 0; k < campaign->nb_scenarios; k++)
+    free(campaign->scenarios[k].conf.buildname);
+  free(campaign->scenarios);
+  campaign->nb_scenarios = 0;
+  campaign->scenarios = NULL;
+}
@@ -0,0 +1,452 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_checkpoint.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Checkpoint of the accumulated results and restart in another
+ *            allocation.
+ *
+ *            Ranks are identified by their host: the k-th rank of a host in
+ *            the checkpoint is restored on the k-th rank of the same host,
+ *            so that a run can be resumed with another rank order or on a
+ *            subset of the nodes. The series of iterations are the
+ *            bisection bandwidth, synchronization time, start skew and the
+ *            monitoring times (build, communication, snapshot). For each
+ *            pair, the row holds the count, the accumulated time and the
+ *            baseline of the anomaly detector (mean, m2, EWMA).
+ */
+
+#include "hp2p.h"
+
+typedef struct
+{
+  const char *host;
+  int rank;
+} hp2p_checkpoint_key;
+
+int hp2p_checkpoint_compare(const void *a, const void *b)
+{
+  const hp2p_checkpoint_key *ka = (const hp2p_checkpoint_key *)a;
+  const hp2p_checkpoint_key *kb = (const hp2p_checkpoint_key *)b;
+  int c = strcmp(ka->host, kb->host);
+
+  if (c != 0)
+    return c;
+  return ka->rank - kb->rank;
+}
+
+/**
+ * \fn     void hp2p_checkpoint_map(const char *old_hosts, int old_nproc,
+ *                                  char **hosts, int nproc, int *map)
+ * \brief  Match the ranks of a checkpoint with the ranks of this run
+ *
+ * \param  old_hosts hostnames of the checkpoint
+ * \param  old_nproc
+ * \param  hosts     hostnames of this run
+ * \param  nproc
+ * \param  map       rank of the checkpoint of each rank or -1 (output)
+ **/
+void hp2p_checkpoint_map(const char *old_hosts, int old_nproc, char **hosts,
+			 int nproc, int *map)
+{
+  hp2p_checkpoint_key *old_keys = NULL;
+  hp2p_checkpoint_key *keys = NULL;
+  int c = 0;
+  int i = 0;
+  int j = 0;
+
+  old_keys = (hp2p_checkpoint_key *)malloc(old_nproc *
+					   sizeof(hp2p_checkpoint_key));
+  keys = (hp2p_checkpoint_key *)malloc(nproc * sizeof(hp2p_checkpoint_key));
+  for (i = 0; i < old_nproc; i++)
+  {
+    old_keys[i].host = &old_hosts[MPI_MAX_PROCESSOR_NAME * i];
+    old_keys[i].rank = i;
+  }
+  for (j = 0; j < nproc; j++)
+  {
+    keys[j].host = hosts[j];
+    keys[j].rank = j;
+    map[j] = -1;
+  }
+  // Sorted by host then rank, the k-th ranks of a host are face to face
+  qsort(old_keys, old_nproc, sizeof(hp2p_checkpoint_key),
+	hp2p_checkpoint_compare);
+  qsort(keys, nproc, sizeof(hp2p_checkpoint_key), hp2p_checkpoint_compare);
+  i = 0;
+  j = 0;
+  while (i < old_nproc && j < nproc)
+  {
+    c = strcmp(old_keys[i].host, keys[j].host);
+    if (c < 0)
+      i++;
+    else if (c > 0)
+      j++;
+    else
+      map[keys[j++].rank] = old_keys[i++].rank;
+  }
+  free(old_keys);
+  free(keys);
+}
+
+/**
+ * \fn     void hp2p_checkpoint_series(hp2p_result *result,
+ *                                    hp2p_series **series)
+ * \brief  Series of iterations in the order of the checkpoint
+ *
+ * \param  result
+ * \param  series HP2P_CHECKPOINT_SERIES pointers (output)
+ **/
+void hp2p_checkpoint_series(hp2p_result *result, hp2p_series **series)
+{
+  series[0] = &result->g_bsbw;
+  series[1] = &result->g_sync;
+  series[2] = &result->g_skew;
+  series[3] = &result->monitor_build_couples;
+  series[4] = &result->monitor_heavyp2p;
+  series[5] = &result->monitor_snapshot;
+}
+
+/**
+ * \fn     void hp2p_checkpoint_write(hp2p_result *result)
+ * \brief  Write the accumulated results in <outname>.ckpt
+ *
+ * The root receives the row of each rank in turn. The file is written
+ * under a temporary name and renamed, so that a job killed while writing
+ * keeps the previous checkpoint.
+ * This function is collective and must follow hp2p_result_update.
+ *
+ * \param  result
+ **/
+void hp2p_checkpoint_write(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_config *conf = result->conf;
+  hp2p_checkpoint_header header;
+  FILE *fp = NULL;
+  char *filename = NULL;
+  char *tmpname = NULL;
+  double *row = NULL;
+  double *packed = NULL;
+  hp2p_series *series[HP2P_CHECKPOINT_SERIES];
+  char name[MPI_MAX_PROCESSOR_NAME];
+  int nproc = mpi_conf->nproc;
+  int r = 0;
+  int i = 0;
+  int j = 0;
+
+  row = (double *)malloc(HP2P_CHECKPOINT_ROW * nproc * sizeof(double));
+  for (j = 0; j < nproc; j++)
+  {
+    row[j] = result->l_count[j];
+    row[nproc + j] = result->l_time[j];
+    row[2 * nproc + j] = result->l_mean[j];
+    row[3 * nproc + j] = result->l_m2[j];
+    row[4 * nproc + j] = result->l_ewma[j];
+  }
+  if (mpi_conf->rank != mpi_conf->root)
+  {
+    MPI_Send(row, HP2P_CHECKPOINT_ROW * nproc, MPI_DOUBLE, mpi_conf->root,
+	     HP2P_TAG_CHECKPOINT, mpi_conf->comm);
+    free(row);
+    return;
+  }
+
+  filename = (char *)malloc((strlen(conf->outname) + 16) * sizeof(char));
+  tmpname = (char *)malloc((strlen(conf->outname) + 16) * sizeof(char));
+  sprintf(filename, "%s.ckpt", conf->outname);
+  sprintf(tmpname, "%s.ckpt.tmp", conf->outname);
+  fp = hp2p_writer_open(tmpname, "wb");
+  if (fp == NULL)
+    fprintf(stderr, "Cannot open %s\n", tmpname);
+  else
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HP2P_CHECKPOINT_MAGIC,
+	   sizeof(HP2P_CHECKPOINT_MAGIC));
+    header.version = HP2P_CHECKPOINT_VERSION;
+    header.nproc = nproc;
+    header.iterations = result->current_iteration;
+    header.msg_size = conf->msg_size;
+    header.nb_msg = conf->nb_msg;
+    header.build = conf->build;
+    header.seed = conf->seed;
+    header.hostname_size = MPI_MAX_PROCESSOR_NAME;
+    fwrite(&header, sizeof(header), 1, fp);
+    // Fixed-size hostnames, as read by hp2p_checkpoint_read
+    for (r = 0; r < nproc; r++)
+    {
+      memset(name, 0, sizeof(name));
+      strncpy(name, hp2p_mpi_get_host(mpi_conf, r), sizeof(name) - 1);
+      fwrite(name, sizeof(char), sizeof(name), fp);
+    }
+    hp2p_checkpoint_series(result, series);
+    for (i = 0; i < HP2P_CHECKPOINT_SERIES; i++)
+    {
+      packed = (double *)malloc(hp2p_series_packed_size(series[i]) *
+				sizeof(double));
+      hp2p_series_pack(series[i], packed);
+      fwrite(packed, sizeof(double), hp2p_series_packed_size(series[i]), fp);
+      free(packed);
+    }
+  }
+  for (r = 0; r < nproc; r++)
+  {
+    if (r != mpi_conf->root)
+      MPI_Recv(row, HP2P_CHECKPOINT_ROW * nproc, MPI_DOUBLE, r,
+	       HP2P_TAG_CHECKPOINT, mpi_conf->comm, MPI_STATUS_IGNORE);
+    else
+    {
+      for (j = 0; j < nproc; j++)
+      {
+	row[j] = result->l_count[j];
+	row[nproc + j] = result->l_time[j];
+	row[2 * nproc + j] = result->l_mean[j];
+	row[3 * nproc + j] = result->l_m2[j];
+	row[4 * nproc + j] = result->l_ewma[j];
+      }
+    }
+    if (fp != NULL)
+      fwrite(row, sizeof(double), HP2P_CHECKPOINT_ROW * nproc, fp);
+  }
+  if (fp != NULL)
+  {
+    if (hp2p_writer_close(fp) != 0 || rename(tmpname, filename) != 0)
+      fprintf(stderr, "Cannot write %s\n", filename);
+  }
+  free(row);
+  free(filename);
+  free(tmpname);
+}
+
+/**
+ * \fn     void hp2p_checkpoint_apply(hp2p_result *result, double *row,
+ *                                    int old_nproc, int *map)
+ * \brief  Add the row of a rank of the checkpoint to the local results
+ *
+ * \param  result
+ * \param  row       row of the checkpoint
+ * \param  old_nproc number of ranks of the checkpoint
+ * \param  map       rank of the checkpoint of each rank or -1
+ **/
+void hp2p_checkpoint_apply(hp2p_result *result, double *row, int old_nproc,
+			   int *map)
+{
+  int o = 0;
+  int j = 0;
+
+  for (j = 0; j < result->mpi_conf->nproc; j++)
+  {
+    o = map[j];
+    if (o < 0)
+      continue;
+    result->l_count[j] += (int)row[o];
+    result->l_time[j] += row[old_nproc + o];
+    result->l_mean[j] = row[2 * old_nproc + o];
+    result->l_m2[j] = row[3 * old_nproc + o];
+    result->l_ewma[j] = row[4 * old_nproc + o];
+  }
+}
+
+/**
+ * \fn     int hp2p_checkpoint_read(hp2p_result *result,
+ *                                  const char *filename)
+ * \brief  Restore the results of a checkpoint
+ *
+ * The message size and the number of messages must be the ones of the
+ * checkpoint. The seed and the algorithm of the checkpoint are used so
+ * that the caller can replay the draws of the iterations done. The
+ * robust estimators, the payload verification, the derived datatype
+ * mode and the offset sweep are not saved, so a run using them cannot
+ * be resumed.
+ * This function is collective.
+ *
+ * \param  result
+ * \param  filename
+ * \return number of iterations done, -1 on error
+ **/
+int hp2p_checkpoint_read(hp2p_result *result, const char *filename)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_config *conf = result->conf;
+  hp2p_checkpoint_header header;
+  FILE *fp = NULL;
+  char *old_hosts = NULL;
+  char **hosts = NULL;
+  double *row = NULL;
+  double *packed = NULL;
+  hp2p_series *series[HP2P_CHECKPOINT_SERIES];
+  int *map = NULL;
+  int *inverse = NULL;
+  int nproc = mpi_conf->nproc;
+  int root = mpi_conf->root;
+  int rank = mpi_conf->rank;
+  int size = 0;
+  int count = 0;
+  int ok = 0;
+  int r = 0;
+  int i = 0;
+
+  // Same configuration on all ranks
+  if (conf->robust_samples > 0 || conf->verify ||
+      conf->datatype != HP2P_TYPE_CONTIGUOUS || conf->nb_offsets > 0)
+  {
+    if (rank == root)
+      fprintf(stderr,
+	      "%s: a run cannot be resumed with -U, -v, -D or -O (not "
+	      "saved in checkpoints)\n",
+	      filename);
+    return -1;
+  }
+  if (rank == root)
+  {
+    fp = fopen(filename, "rb");
+    ok = fp != NULL && fread(&header, sizeof(header), 1, fp) == 1 &&
+	 memcmp(header.magic, HP2P_CHECKPOINT_MAGIC,
+		sizeof(HP2P_CHECKPOINT_MAGIC)) == 0 &&
+	 header.version == HP2P_CHECKPOINT_VERSION &&
+	 header.hostname_size == MPI_MAX_PROCESSOR_NAME;
+    if (!ok)
+      fprintf(stderr, "%s is not a valid checkpoint\n", filename);
+  }
+  MPI_Bcast(&ok, 1, MPI_INT, root, mpi_conf->comm);
+  if (!ok)
+  {
+    if (fp != NULL)
+      fclose(fp);
+    return -1;
+  }
+  MPI_Bcast(&header, sizeof(header), MPI_BYTE, root, mpi_conf->comm);
+  if (header.msg_size != conf->msg_size || header.nb_msg != conf->nb_msg)
+  {
+    if (rank == root)
+    {
+      fprintf(stderr,
+	      "%s was written with messages of %lld bytes x %d, not %lld x "
+	      "%d\n",
+	      filename, (long long)header.msg_size, header.nb_msg,
+	      conf->msg_size, conf->nb_msg);
+      fclose(fp);
+    }
+    return -1;
+  }
+  if (rank == root &&
+      (header.seed != conf->seed || header.build != conf->build))
+    printf(" Restart: using the seed (%d) and the algorithm (%d) of the "
+	   "checkpoint\n",
+	   header.seed, header.build);
+  conf->seed = header.seed;
+  // conf->buildname belongs to the caller: outputs use hp2p_algo_name
+  conf->build = header.build;
+
+  // Ranks of the checkpoint of each rank
+  map = (int *)malloc(nproc * sizeof(int));
+  row = (double *)malloc(HP2P_CHECKPOINT_ROW * header.nproc * sizeof(double));
+  if (rank == root)
+  {
+    old_hosts = (char *)malloc(header.nproc * MPI_MAX_PROCESSOR_NAME);
+    ok = fread(old_hosts, MPI_MAX_PROCESSOR_NAME, header.nproc, fp) ==
+	 (size_t)header.nproc;
+    // Packed series: 7 doubles then 3 doubles per bucket
+    for (i = 0; ok && i < HP2P_CHECKPOINT_SERIES; i++)
+    {
+      packed = (double *)realloc(packed, (size + 7) * sizeof(double));
+      ok = fread(&packed[size], sizeof(double), 7, fp) == 7;
+      count = ok ? (int)packed[size] : 0;
+      ok = ok && count >= 0 && count <= header.iterations;
+      if (!ok)
+	break;
+      packed = (double *)realloc(packed,
+				 (size + 7 + 3 * count) * sizeof(double));
+      ok = fread(&packed[size + 7], sizeof(double), 3 * count, fp) ==
+	   (size_t)(3 * count);
+      size += 7 + 3 * count;
+    }
+    hosts = hp2p_mpi_get_hosts(mpi_conf);
+    hp2p_checkpoint_map(old_hosts, header.nproc, hosts, nproc, map);
+    free(hosts);
+    inverse = (int *)malloc(header.nproc * sizeof(int));
+    for (r = 0; r < header.nproc; r++)
+      inverse[r] = -1;
+    for (r = 0, i = 0; r < nproc; r++)
+      if (map[r] >= 0)
+      {
+	inverse[map[r]] = r;
+	i++;
+      }
+    printf(" Restart: %d iterations and %d of %d ranks restored from %s\n",
+	   header.iterations, i, header.nproc, filename);
+    free(old_hosts);
+    if (!ok)
+    {
+      fprintf(stderr, "%s is truncated\n", filename);
+      size = 0;
+    }
+  }
+  MPI_Bcast(map, nproc, MPI_INT, root, mpi_conf->comm);
+  MPI_Bcast(&size, 1, MPI_INT, root, mpi_conf->comm);
+  if (rank != root)
+    packed = (double *)malloc((size > 0 ? size : 1) * sizeof(double));
+  MPI_Bcast(packed, size, MPI_DOUBLE, root, mpi_conf->comm);
+
+  // Rows are read in the order of the checkpoint and sent to their rank
+  if (rank == root)
+  {
+    for (r = 0; r < header.nproc; r++)
+    {
+      if (!ok ||
+	  fread(row, sizeof(double), HP2P_CHECKPOINT_ROW * header.nproc, fp) !=
+	      (size_t)(HP2P_CHECKPOINT_ROW * header.nproc))
+      {
+	if (ok)
+	  fprintf(stderr, "%s is truncated\n", filename);
+	ok = 0;
+	memset(row, 0, HP2P_CHECKPOINT_ROW * header.nproc * sizeof(double));
+      }
+      if (inverse[r] == root)
+	hp2p_checkpoint_apply(result, row, header.nproc, map);
+      else if (inverse[r] >= 0)
+	MPI_Send(row, HP2P_CHECKPOINT_ROW * header.nproc, MPI_DOUBLE,
+		 inverse[r], HP2P_TAG_CHECKPOINT, mpi_conf->comm);
+    }
+    free(inverse);
+    fclose(fp);
+  }
+  else if (map[rank] >= 0)
+  {
+    MPI_Recv(row, HP2P_CHECKPOINT_ROW * header.nproc, MPI_DOUBLE, root,
+	     HP2P_TAG_CHECKPOINT, mpi_conf->comm, MPI_STATUS_IGNORE);
+    hp2p_checkpoint_apply(result, row, header.nproc, map);
+  }
+  MPI_Bcast(&ok, 1, MPI_INT, root, mpi_conf->comm);
+
+  // Series of the iterations done continue from the checkpoint
+  if (ok && size > 0)
+  {
+    hp2p_checkpoint_series(result, series);
+    for (i = 0, r = 0; i < HP2P_CHECKPOINT_SERIES; i++)
+    {
+      hp2p_series_unpack(series[i], &packed[r]);
+      r += 7 + 3 * (int)packed[r];
+    }
+    result->current_iteration = header.iterations;
+    result->reduced = header.iterations;
+  }
+  free(packed);
+  free(map);
+  free(row);
+  return ok ? header.iterations : -1;
+}
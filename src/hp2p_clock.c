@@ -0,0 +1,133 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_clock.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Global time base: estimation of clock offset and drift of
+ *            each rank relatively to the root with ping-pongs along a
+ *            tree
+ */
+
+#include "hp2p.h"
+
+/**
+ * \fn     void hp2p_clock_init(hp2p_clock *clock)
+ * \brief  Initialize a clock model (local clock = global clock)
+ *
+ * \param  clock
+ **/
+void hp2p_clock_init(hp2p_clock *clock)
+{
+  clock->offset = 0.0;
+  clock->drift = 0.0;
+  clock->ref = 0.0;
+  clock->rtt = 0.0;
+  clock->nb_sync = 0;
+}
+
+/**
+ * \fn     void hp2p_clock_sync(hp2p_mpi_config *mpi_conf)
+ * \brief  Estimate the offset of every rank with the root clock
+ *
+ * Offsets are estimated along a binomial tree rooted at the root, in
+ * log2(nproc) rounds: at each round, every rank which already knows its
+ * offset answers HP2P_CLOCK_NB_PINGPONG pings of a new rank with its time
+ * in the global time base. The new rank keeps the sample with the
+ * smallest round-trip time and takes the middle of the round-trip as the
+ * date of the answer, so errors of at most log2(nproc) hops add up. The
+ * drift is updated from two successive estimations.
+ * This function is collective.
+ *
+ * \param  mpi_conf
+ **/
+void hp2p_clock_sync(hp2p_mpi_config *mpi_conf)
+{
+  hp2p_clock *clock = NULL;
+  double t0 = 0.0;
+  double t1 = 0.0;
+  double troot = 0.0;
+  double best_rtt = 0.0;
+  double best_offset = 0.0;
+  double best_ref = 0.0;
+  int nproc = mpi_conf->nproc;
+  int vrank = 0;
+  int peer = 0;
+  int mask = 1;
+  int k = 0;
+
+  clock = &mpi_conf->clock;
+  // Rank relative to the root, which is the root of the tree
+  vrank = (mpi_conf->rank - mpi_conf->root + nproc) % nproc;
+  best_ref = hp2p_util_get_time();
+  while (mask < nproc)
+    mask <<= 1;
+  for (mask >>= 1; mask > 0; mask >>= 1)
+  {
+    if (vrank % (2 * mask) == 0 && vrank + mask < nproc)
+    {
+      // Answer the pings of the child with the global time
+      peer = (vrank + mask + mpi_conf->root) % nproc;
+      for (k = 0; k < HP2P_CLOCK_NB_PINGPONG; k++)
+      {
+	MPI_Recv(NULL, 0, MPI_BYTE, peer, HP2P_TAG_CLOCK, mpi_conf->comm,
+		 MPI_STATUS_IGNORE);
+	troot = hp2p_util_get_time() + best_offset;
+	MPI_Send(&troot, 1, MPI_DOUBLE, peer, HP2P_TAG_CLOCK, mpi_conf->comm);
+      }
+    }
+    else if (vrank % (2 * mask) == mask)
+    {
+      // Estimate the offset with the parent
+      peer = (vrank - mask + mpi_conf->root) % nproc;
+      best_rtt = 1.0e15;
+      for (k = 0; k < HP2P_CLOCK_NB_PINGPONG; k++)
+      {
+	t0 = hp2p_util_get_time();
+	MPI_Send(NULL, 0, MPI_BYTE, peer, HP2P_TAG_CLOCK, mpi_conf->comm);
+	MPI_Recv(&troot, 1, MPI_DOUBLE, peer, HP2P_TAG_CLOCK, mpi_conf->comm,
+		 MPI_STATUS_IGNORE);
+	t1 = hp2p_util_get_time();
+	if (t1 - t0 < best_rtt)
+	{
+	  best_rtt = t1 - t0;
+	  best_ref = 0.5 * (t0 + t1);
+	  best_offset = troot - best_ref;
+	}
+      }
+    }
+  }
+
+  // Drift is only meaningful if estimations are far enough
+  if (clock->nb_sync > 0 && best_ref - clock->ref > 1.0)
+    clock->drift = (best_offset - clock->offset) / (best_ref - clock->ref);
+  clock->offset = best_offset;
+  clock->ref = best_ref;
+  clock->rtt = best_rtt;
+  clock->nb_sync++;
+}
+
+/**
+ * \fn     double hp2p_clock_global(hp2p_clock *clock, double t)
+ * \brief  Convert a local time into the global time base
+ *
+ * \param  clock
+ * \param  t local time (from hp2p_util_get_time)
+ * \return global time
+ **/
+double hp2p_clock_global(hp2p_clock *clock, double t)
+{
+  return t + clock->offset + clock->drift * (t - clock->ref);
+}
@@ -0,0 +1,275 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_converge.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Confidence-driven stop. The confidence interval of the mean
+ *            time of a pair is derived from its running mean and variance
+ *            (normal approximation, half-width z * s / sqrt(n) relative to
+ *            the mean). The run stops when converge_fraction of the pairs
+ *            of ranks, or of the pairs of nodes whose samples are merged,
+ *            have an interval narrower than converge_width.
+ */
+
+#include "hp2p.h"
+
+/**
+ * \fn     void hp2p_converge_merge(const double *a, double *b)
+ * \brief  Merge the count, mean and m2 of a into b (Chan et al.)
+ *
+ * \param  a
+ * \param  b
+ **/
+void hp2p_converge_merge(const double *a, double *b)
+{
+  double n = a[0] + b[0];
+  double delta = 0.0;
+
+  if (a[0] == 0.0)
+    return;
+  if (b[0] == 0.0)
+  {
+    memcpy(b, a, 3 * sizeof(double));
+    return;
+  }
+  delta = a[1] - b[1];
+  b[2] += a[2] + delta * delta * a[0] * b[0] / n;
+  b[1] += delta * a[0] / n;
+  b[0] = n;
+}
+
+/**
+ * \fn     void hp2p_converge_reduce(void *in, void *inout, int *len,
+ *                                   MPI_Datatype *type)
+ * \brief  User-defined MPI_Op merging (count, mean, m2) triples
+ **/
+void hp2p_converge_reduce(void *in, void *inout, int *len, MPI_Datatype *type)
+{
+  double *a = (double *)in;
+  double *b = (double *)inout;
+  int i = 0;
+
+  (void)type;
+  for (i = 0; i < *len; i++)
+    hp2p_converge_merge(&a[3 * i], &b[3 * i]);
+}
+
+/**
+ * \fn     double hp2p_converge_quantile(double confidence)
+ * \brief  Quantile of the normal distribution of a two-sided interval
+ *
+ * \param  confidence level (e.g. 0.95)
+ * \return z such that P(|X| < z) = confidence
+ **/
+double hp2p_converge_quantile(double confidence)
+{
+  double lo = 0.0;
+  double hi = 10.0;
+  double mid = 0.0;
+  int i = 0;
+
+  for (i = 0; i < 64; i++)
+  {
+    mid = 0.5 * (lo + hi);
+    if (erf(mid / sqrt(2.0)) < confidence)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return 0.5 * (lo + hi);
+}
+
+/**
+ * \fn     void hp2p_converge_alloc(hp2p_result *result)
+ * \brief  Number the nodes and create the merge operation
+ *
+ * \param  result
+ **/
+void hp2p_converge_alloc(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  int *leaders = NULL;
+  int *first = NULL;
+  int leader = mpi_conf->rank;
+  int j = 0;
+
+  result->node_id = NULL;
+  result->nb_nodes = 0;
+  result->converged = 0;
+  result->converge_total = 0;
+  result->converge_achieved = -1.0;
+  result->converge_stop = 0;
+  result->converge_z = 0.0;
+  if (result->conf->converge_width <= 0.0)
+    return;
+
+  result->converge_z =
+      hp2p_converge_quantile(result->conf->converge_confidence);
+  // A node is identified by the rank of its first local rank
+  MPI_Bcast(&leader, 1, MPI_INT, 0, mpi_conf->local_comm);
+  leaders = (int *)malloc(mpi_conf->nproc * sizeof(int));
+  first = (int *)malloc(mpi_conf->nproc * sizeof(int));
+  MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, mpi_conf->comm);
+  result->node_id = (int *)malloc(mpi_conf->nproc * sizeof(int));
+  for (j = 0; j < mpi_conf->nproc; j++)
+    first[j] = -1;
+  for (j = 0; j < mpi_conf->nproc; j++)
+  {
+    if (first[leaders[j]] < 0)
+      first[leaders[j]] = result->nb_nodes++;
+    result->node_id[j] = first[leaders[j]];
+  }
+  free(leaders);
+  free(first);
+  MPI_Type_contiguous(3, MPI_DOUBLE, &result->welford_type);
+  MPI_Type_commit(&result->welford_type);
+  MPI_Op_create(hp2p_converge_reduce, 1, &result->welford_op);
+}
+
+void hp2p_converge_free(hp2p_result *result)
+{
+  if (result->node_id == NULL)
+    return;
+  free(result->node_id);
+  result->node_id = NULL;
+  MPI_Type_free(&result->welford_type);
+  MPI_Op_free(&result->welford_op);
+}
+
+/**
+ * \fn     void hp2p_converge_count(hp2p_result *result, const double *pair,
+ *                                  double *counts)
+ * \brief  Add a pair to the number of pairs, of converged pairs and to the
+ *         histogram of the relative half-widths
+ *
+ * \param  result
+ * \param  pair   count, mean and m2 of the times of the pair
+ * \param  counts pairs, converged pairs, histogram (output)
+ **/
+void hp2p_converge_count(hp2p_result *result, const double *pair,
+			 double *counts)
+{
+  double width = 0.0;
+  int b = 0;
+
+  // Only the pairs drawn at least once are tested
+  if (pair[0] <= 0.0)
+    return;
+  counts[0] += 1.0;
+  if (pair[0] < 2.0 || pair[0] < result->conf->converge_min ||
+      pair[1] <= 0.0)
+    return;
+  width = result->converge_z * sqrt(pair[2] / (pair[0] - 1.0) / pair[0]) /
+	  pair[1];
+  if (width <= result->conf->converge_width)
+    counts[1] += 1.0;
+  b = 0;
+  if (width > 0.0)
+    b = (int)floor((log10(width) + 4.0) * HP2P_CONVERGE_BINS / 6.0);
+  if (b < 0)
+    b = 0;
+  if (b >= HP2P_CONVERGE_BINS)
+    b = HP2P_CONVERGE_BINS - 1;
+  counts[2 + b] += 1.0;
+}
+
+/**
+ * \fn     int hp2p_converge_update(hp2p_result *result)
+ * \brief  Count the pairs whose confidence interval is narrow enough
+ *
+ * At the node level, the samples of the pairs of ranks of two nodes are
+ * merged on the first local rank of the node. The half-width reached by
+ * converge_fraction of the pairs is derived from a histogram.
+ * This function is collective.
+ *
+ * \param  result
+ * \return 1 if converge_fraction of the pairs have converged
+ **/
+int hp2p_converge_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_config *conf = result->conf;
+  double counts[2 + HP2P_CONVERGE_BINS];
+  double pair[3];
+  double *row = NULL;
+  double target = 0.0;
+  double sum = 0.0;
+  int a = 0;
+  int b = 0;
+  int j = 0;
+
+  if (conf->converge_width <= 0.0)
+    return 0;
+  memset(counts, 0, sizeof(counts));
+  if (conf->converge_level == HP2P_CONVERGE_NODE)
+  {
+    row = (double *)calloc(3 * result->nb_nodes, sizeof(double));
+    for (j = 0; j < mpi_conf->nproc; j++)
+    {
+      if (j == mpi_conf->rank)
+	continue;
+      pair[0] = result->l_count[j];
+      pair[1] = result->l_mean[j];
+      pair[2] = result->l_m2[j];
+      hp2p_converge_merge(pair, &row[3 * result->node_id[j]]);
+    }
+    if (mpi_conf->local_rank == 0)
+    {
+      MPI_Reduce(MPI_IN_PLACE, row, result->nb_nodes, result->welford_type,
+		 result->welford_op, 0, mpi_conf->local_comm);
+      a = result->node_id[mpi_conf->rank];
+      for (b = 0; b < result->nb_nodes; b++)
+	if (b != a || mpi_conf->local_nproc > 1)
+	  hp2p_converge_count(result, &row[3 * b], counts);
+    }
+    else
+      MPI_Reduce(row, NULL, result->nb_nodes, result->welford_type,
+		 result->welford_op, 0, mpi_conf->local_comm);
+    free(row);
+  }
+  else
+  {
+    for (j = 0; j < mpi_conf->nproc; j++)
+    {
+      if (j == mpi_conf->rank)
+	continue;
+      pair[0] = result->l_count[j];
+      pair[1] = result->l_mean[j];
+      pair[2] = result->l_m2[j];
+      hp2p_converge_count(result, pair, counts);
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, counts, 2 + HP2P_CONVERGE_BINS, MPI_DOUBLE,
+		MPI_SUM, mpi_conf->comm);
+
+  result->converge_total = (long long)counts[0];
+  result->converged = (long long)counts[1];
+  result->converge_achieved = -1.0;
+  target = conf->converge_fraction * counts[0];
+  for (b = 0; b < HP2P_CONVERGE_BINS && target > 0.0; b++)
+  {
+    sum += counts[2 + b];
+    if (sum >= target)
+    {
+      result->converge_achieved =
+	  pow(10.0, -4.0 + 6.0 * (b + 1) / HP2P_CONVERGE_BINS);
+      break;
+    }
+  }
+  result->converge_stop =
+      counts[0] > 0.0 && counts[1] >= target && result->converged > 0;
+  return result->converge_stop;
+}
@@ -0,0 +1,238 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_datatype.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Derived datatype mode. After the contiguous messages, each
+ *            couple exchanges the same payload described by a vector or a
+ *            subarray datatype in a second timed window, so that the cost
+ *            of the datatype engine (pack/unpack) is measured per pair
+ *            with the same couples.
+ */
+
+#include "hp2p.h"
+
+const char *hp2p_datatype_name[] = {"contiguous", "vector", "subarray"};
+
+/**
+ * \fn     int hp2p_datatype_parse_dims(char *value, int *dims)
+ * \brief  Dimensions "NXxNYxNZ" (1 to 3)
+ *
+ * \param  value
+ * \param  dims  output
+ * \return number of dimensions
+ **/
+int hp2p_datatype_parse_dims(char *value, int *dims)
+{
+  char *token = NULL;
+  char *saveptr = NULL;
+  int ndims = 0;
+
+  for (token = strtok_r(value, "x", &saveptr); token != NULL && ndims < 3;
+       token = strtok_r(NULL, "x", &saveptr))
+    dims[ndims++] = atoi(token);
+  return ndims;
+}
+
+/**
+ * \fn     void hp2p_datatype_parse(hp2p_config *conf, const char *value)
+ * \brief  Datatype of an option
+ *
+ * "vector:block:stride" (in ints) or "subarray:sizes:subsizes" with sizes
+ * as "NXxNYxNZ" (C order, the subarray starts at 0), anything else for
+ * contiguous messages only.
+ *
+ * \param  conf
+ * \param  value
+ **/
+void hp2p_datatype_parse(hp2p_config *conf, const char *value)
+{
+  char *copy = strdup(value);
+  char *fields[3] = {NULL, NULL, NULL};
+  char *saveptr = NULL;
+
+  fields[0] = strtok_r(copy, ":", &saveptr);
+  fields[1] = strtok_r(NULL, ":", &saveptr);
+  fields[2] = strtok_r(NULL, ":", &saveptr);
+  conf->datatype = HP2P_TYPE_CONTIGUOUS;
+  if (fields[2] != NULL && strcmp(fields[0], "vector") == 0)
+  {
+    conf->datatype = HP2P_TYPE_VECTOR;
+    conf->type_block = atoi(fields[1]);
+    conf->type_stride = atoi(fields[2]);
+  }
+  else if (fields[2] != NULL && strcmp(fields[0], "subarray") == 0)
+  {
+    conf->datatype = HP2P_TYPE_SUBARRAY;
+    conf->type_ndims = hp2p_datatype_parse_dims(fields[1], conf->type_sizes);
+    if (hp2p_datatype_parse_dims(fields[2], conf->type_subsizes) !=
+	conf->type_ndims)
+      conf->type_ndims = 0;
+  }
+  free(copy);
+}
+
+/**
+ * \fn     int hp2p_datatype_create(hp2p_config *conf, MPI_Datatype *type,
+ *                                  size_t *extent, int root)
+ * \brief  Create the derived datatype
+ *
+ * The payload of the derived datatype is also the size of the contiguous
+ * messages: msg_size is rounded down to whole blocks of a vector, and set
+ * to the size of the subarray.
+ *
+ * \param  conf
+ * \param  type   datatype (output, MPI_DATATYPE_NULL if contiguous)
+ * \param  extent bytes spanned by the datatype (output)
+ * \param  root   print the adjustments
+ * \return 0 on success, -1 if the datatype is invalid
+ **/
+int hp2p_datatype_create(hp2p_config *conf, MPI_Datatype *type,
+			 size_t *extent, int root)
+{
+  int starts[3] = {0, 0, 0};
+  long long payload = 0;
+  long long count = 0;
+  int d = 0;
+
+  *type = MPI_DATATYPE_NULL;
+  *extent = 0;
+  if (conf->datatype == HP2P_TYPE_VECTOR)
+  {
+    if (conf->type_block < 1 || conf->type_stride < conf->type_block)
+      return -1;
+    count = conf->msg_size / (conf->type_block * (long long)sizeof(int));
+    if (count < 1)
+      count = 1;
+    // The datatype window sends one element of the datatype
+    if (count > INT_MAX)
+      return -1;
+    payload = count * conf->type_block * sizeof(int);
+    *extent = ((size_t)(count - 1) * conf->type_stride + conf->type_block) *
+	      sizeof(int);
+    MPI_Type_vector((int)count, conf->type_block, conf->type_stride, MPI_INT,
+		    type);
+  }
+  else if (conf->datatype == HP2P_TYPE_SUBARRAY)
+  {
+    if (conf->type_ndims < 1)
+      return -1;
+    payload = sizeof(int);
+    *extent = sizeof(int);
+    for (d = 0; d < conf->type_ndims; d++)
+    {
+      if (conf->type_subsizes[d] < 1 ||
+	  conf->type_subsizes[d] > conf->type_sizes[d])
+	return -1;
+      payload *= conf->type_subsizes[d];
+      *extent *= conf->type_sizes[d];
+    }
+    MPI_Type_create_subarray(conf->type_ndims, conf->type_sizes,
+			     conf->type_subsizes, starts, MPI_ORDER_C, MPI_INT,
+			     type);
+  }
+  else
+    return 0;
+  MPI_Type_commit(type);
+  if (payload != conf->msg_size && root)
+    printf(" Message size set to %lld bytes, the payload of the %s datatype\n",
+	   payload, hp2p_datatype_name[conf->datatype]);
+  conf->msg_size = payload;
+  return 0;
+}
+
+void hp2p_datatype_alloc(hp2p_result *result)
+{
+  int nproc = result->mpi_conf->nproc;
+
+  result->l_type_time = NULL;
+  result->l_type_avg = NULL;
+  result->l_type_bw = NULL;
+  result->avg_type_bw = 0.0;
+  result->avg_type_ratio = 0.0;
+  result->min_type_ratio = 0.0;
+  result->i_min_type = 0;
+  result->j_min_type = 0;
+  if (result->conf->datatype == HP2P_TYPE_CONTIGUOUS)
+    return;
+  result->l_type_time = (double *)calloc(nproc, sizeof(double));
+  result->l_type_avg = (double *)calloc(nproc, sizeof(double));
+  result->l_type_bw = (double *)calloc(nproc, sizeof(double));
+}
+
+void hp2p_datatype_free(hp2p_result *result)
+{
+  free(result->l_type_time);
+  free(result->l_type_avg);
+  free(result->l_type_bw);
+}
+
+/**
+ * \fn     void hp2p_datatype_update(hp2p_result *result)
+ * \brief  Bandwidth of the derived datatype per pair and relatively to
+ *         the contiguous bandwidth of the pair
+ *
+ * Must follow hp2p_result_stats_row. This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_datatype_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  double sums[3] = {0.0, 0.0, 0.0};
+  double ratio = 0.0;
+  // Lowest ratio of a rank, with the rank for MPI_MINLOC
+  struct
+  {
+    double value;
+    int rank;
+  } worst = {1.0e15, 0}, global;
+  int other = 0;
+  int j = 0;
+
+  if (result->conf->datatype == HP2P_TYPE_CONTIGUOUS)
+    return;
+  for (j = 0; j < mpi_conf->nproc; j++)
+  {
+    if (j == mpi_conf->rank || result->l_count[j] == 0 ||
+	result->l_bw[j] <= 0.0)
+      continue;
+    result->l_type_avg[j] = result->l_type_time[j] / result->l_count[j];
+    result->l_type_bw[j] = result->msg_size / result->l_type_avg[j];
+    ratio = result->l_type_bw[j] / result->l_bw[j];
+    sums[0] += 1.0;
+    sums[1] += result->l_type_bw[j];
+    sums[2] += ratio;
+    if (ratio < worst.value)
+    {
+      worst.value = ratio;
+      other = j;
+    }
+  }
+  worst.rank = mpi_conf->rank;
+  MPI_Allreduce(MPI_IN_PLACE, sums, 3, MPI_DOUBLE, MPI_SUM, mpi_conf->comm);
+  MPI_Allreduce(&worst, &global, 1, MPI_DOUBLE_INT, MPI_MINLOC,
+		mpi_conf->comm);
+  MPI_Bcast(&other, 1, MPI_INT, global.rank, mpi_conf->comm);
+  if (sums[0] > 0.0)
+  {
+    result->avg_type_bw = sums[1] / sums[0];
+    result->avg_type_ratio = sums[2] / sums[0];
+    result->min_type_ratio = global.value;
+    result->i_min_type = global.rank;
+    result->j_min_type = other;
+  }
+}
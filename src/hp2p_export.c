@@ -0,0 +1,573 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_export.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Exports for ingestion pipelines: JSON summary, and per-pair
+ *            and per-iteration rows in CSV or JSON lines
+ */
+
+#include "hp2p.h"
+
+FILE *hp2p_export_open(hp2p_config *conf, const char *suffix)
+{
+  FILE *fp = NULL;
+  char *filename = NULL;
+
+  filename = (char *)malloc((strlen(conf->outname) + 32) * sizeof(char));
+  strcpy(filename, conf->outname);
+  strcat(filename, suffix);
+  fp = hp2p_writer_open(filename, "w");
+  if (fp == NULL)
+    fprintf(stderr, "Cannot open %s\n", filename);
+  free(filename);
+  return fp;
+}
+
+/**
+ * \fn     void hp2p_export_string(FILE *fp, const char *value)
+ * \brief  Write a JSON string: quoted, with the escapes of the format
+ *
+ * \param  fp
+ * \param  value
+ **/
+void hp2p_export_string(FILE *fp, const char *value)
+{
+  fputc('"', fp);
+  for (; *value != '\0'; value++)
+  {
+    if (*value == '\\' || *value == '"')
+      fprintf(fp, "\\%c", *value);
+    else if (*value == '\n')
+      fputs("\\n", fp);
+    else if (*value == '\t')
+      fputs("\\t", fp);
+    else if ((unsigned char)*value < 0x20)
+      fprintf(fp, "\\u%04x", (unsigned char)*value);
+    else
+      fputc(*value, fp);
+  }
+  fputc('"', fp);
+}
+
+void hp2p_export_number(FILE *fp, const char *sep, double value)
+{
+  fputs(sep, fp);
+  hp2p_writer_double(fp, value, 1, 9);
+}
+
+/**
+ * \fn     int hp2p_export_columns(hp2p_result *result,
+ *                                 hp2p_export_column *columns)
+ * \brief  Columns of the pair exports: count, mean time and bandwidth,
+ *         then the columns of the enabled options
+ *
+ * \param  result
+ * \param  columns HP2P_EXPORT_COLUMNS columns (output)
+ * \return number of columns
+ **/
+int hp2p_export_columns(hp2p_result *result, hp2p_export_column *columns)
+{
+  hp2p_config *conf = result->conf;
+  int nb = 0;
+
+  memset(columns, 0, HP2P_EXPORT_COLUMNS * sizeof(hp2p_export_column));
+  columns[nb].name = "count";
+  columns[nb++].counts = result->l_count;
+  columns[nb].name = "mean_time";
+  columns[nb++].values = result->l_avg_time;
+  columns[nb].name = "bandwidth";
+  columns[nb++].values = result->l_bw;
+  if (conf->robust_samples > 0)
+  {
+    columns[nb].name = "trimmed_time";
+    columns[nb++].values = result->l_trim;
+    columns[nb].name = "mom_time";
+    columns[nb++].values = result->l_mom;
+    columns[nb].name = "min_time";
+    columns[nb++].values = result->l_min;
+  }
+  if (conf->verify)
+  {
+    columns[nb].name = "corrupted";
+    columns[nb++].counts = result->l_corrupt;
+  }
+  if (conf->datatype != HP2P_TYPE_CONTIGUOUS)
+  {
+    columns[nb].name = "type_time";
+    columns[nb++].values = result->l_type_avg;
+    columns[nb].name = "type_bandwidth";
+    columns[nb++].values = result->l_type_bw;
+  }
+  return nb;
+}
+
+/**
+ * \fn     void hp2p_export_write_pairs(FILE *csv, FILE *jsonl,
+ *                                      hp2p_result *result, int rank,
+ *                                      double *row,
+ *                                      hp2p_export_column *columns, int nb)
+ * \brief  Write the pairs of the row of a rank
+ *
+ * \param  csv     CSV file or NULL
+ * \param  jsonl   JSON lines file or NULL
+ * \param  result
+ * \param  rank    source rank
+ * \param  row     values of each column for each destination
+ * \param  columns
+ * \param  nb      number of columns
+ **/
+void hp2p_export_write_pairs(FILE *csv, FILE *jsonl, hp2p_result *result,
+			     int rank, double *row, hp2p_export_column *columns,
+			     int nb)
+{
+  char src[HP2P_HOST_NAME];
+  char *dst = NULL;
+  char key[64];
+  int nproc = result->mpi_conf->nproc;
+  int j = 0;
+  int c = 0;
+
+  strcpy(src, hp2p_mpi_get_host(result->mpi_conf, rank));
+  for (j = 0; j < nproc; j++)
+  {
+    // First column is the count
+    if (row[j] <= 0.0)
+      continue;
+    dst = hp2p_mpi_get_host(result->mpi_conf, j);
+    if (csv != NULL)
+    {
+      fprintf(csv, "%d,%s,%d,%s", rank, src, j, dst);
+      for (c = 0; c < nb; c++)
+	if (columns[c].counts != NULL)
+	  fprintf(csv, ",%d", (int)row[c * nproc + j]);
+	else
+	  hp2p_export_number(csv, ",", row[c * nproc + j]);
+      fputc('\n', csv);
+    }
+    if (jsonl != NULL)
+    {
+      fprintf(jsonl, "{\"src_rank\": %d, \"src_host\": ", rank);
+      hp2p_export_string(jsonl, src);
+      fprintf(jsonl, ", \"dst_rank\": %d, \"dst_host\": ", j);
+      hp2p_export_string(jsonl, dst);
+      for (c = 0; c < nb; c++)
+      {
+	snprintf(key, sizeof(key), ", \"%s\": ", columns[c].name);
+	if (columns[c].counts != NULL)
+	  fprintf(jsonl, "%s%d", key, (int)row[c * nproc + j]);
+	else
+	  hp2p_export_number(jsonl, key, row[c * nproc + j]);
+      }
+      fputs("}\n", jsonl);
+    }
+  }
+}
+
+/**
+ * \fn     void hp2p_export_pairs(hp2p_result *result, int csv, int jsonl)
+ * \brief  Stream the statistics of all pairs to <outname>-pairs.csv and/or
+ *         <outname>-pairs.jsonl
+ *
+ * The root receives the row of each rank in turn and writes it, so that
+ * its memory does not depend on the number of pairs.
+ * This function is collective.
+ *
+ * \param  result
+ * \param  csv   write the CSV file
+ * \param  jsonl write the JSON lines file
+ **/
+void hp2p_export_pairs(hp2p_result *result, int csv, int jsonl)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_export_column columns[HP2P_EXPORT_COLUMNS];
+  FILE *fcsv = NULL;
+  FILE *fjsonl = NULL;
+  double *row = NULL;
+  int nproc = mpi_conf->nproc;
+  int width = hp2p_export_columns(result, columns);
+  int r = 0;
+  int j = 0;
+  int c = 0;
+
+  row = (double *)malloc(width * nproc * sizeof(double));
+  for (c = 0; c < width; c++)
+    for (j = 0; j < nproc; j++)
+      row[c * nproc + j] = (columns[c].counts != NULL)
+			       ? columns[c].counts[j]
+			       : columns[c].values[j];
+  if (mpi_conf->rank != mpi_conf->root)
+    MPI_Send(row, width * nproc, MPI_DOUBLE, mpi_conf->root, HP2P_TAG_EXPORT,
+	     mpi_conf->comm);
+  else
+  {
+    if (csv)
+    {
+      fcsv = hp2p_export_open(result->conf, "-pairs.csv");
+      if (fcsv != NULL)
+      {
+	fprintf(fcsv, "src_rank,src_host,dst_rank,dst_host");
+	for (c = 0; c < width; c++)
+	  fprintf(fcsv, ",%s", columns[c].name);
+	fputc('\n', fcsv);
+      }
+    }
+    if (jsonl)
+      fjsonl = hp2p_export_open(result->conf, "-pairs.jsonl");
+    for (r = 0; r < nproc; r++)
+    {
+      if (r != mpi_conf->root)
+	MPI_Recv(row, width * nproc, MPI_DOUBLE, r, HP2P_TAG_EXPORT,
+		 mpi_conf->comm, MPI_STATUS_IGNORE);
+      hp2p_export_write_pairs(fcsv, fjsonl, result, r, row, columns, width);
+    }
+    if (fcsv != NULL)
+      hp2p_writer_close(fcsv);
+    if (fjsonl != NULL)
+      hp2p_writer_close(fjsonl);
+  }
+  free(row);
+}
+
+/**
+ * \fn     void hp2p_export_iterations(hp2p_result *result, int csv, int jsonl)
+ * \brief  Write one row per point of the bisection bandwidth series
+ *         (bisection bandwidth, time of the phases, synchronization) to
+ *         <outname>-iterations.csv and/or <outname>-iterations.jsonl
+ *
+ * A row is a single iteration until the series are downsampled, then the
+ * mean of the iterations of the point.
+ *
+ * \param  result
+ * \param  csv   write the CSV file
+ * \param  jsonl write the JSON lines file
+ **/
+void hp2p_export_iterations(hp2p_result *result, int csv, int jsonl)
+{
+  FILE *fcsv = NULL;
+  FILE *fjsonl = NULL;
+  hp2p_series *series[5];
+  double values[6];
+  int first = 0;
+  int last = 0;
+  int k = 0;
+  int s = 0;
+
+  series[0] = &result->monitor_build_couples;
+  series[1] = &result->monitor_heavyp2p;
+  series[2] = &result->monitor_snapshot;
+  series[3] = &result->g_sync;
+  series[4] = &result->g_skew;
+  if (csv)
+    fcsv = hp2p_export_open(result->conf, "-iterations.csv");
+  if (jsonl)
+    fjsonl = hp2p_export_open(result->conf, "-iterations.jsonl");
+  if (fcsv != NULL)
+    fprintf(fcsv, "iteration,bisection_bandwidth,build_time,comm_time,"
+		  "snapshot_time,sync_time,start_skew,iterations\n");
+  for (k = 0; k < result->g_bsbw.count; k++)
+  {
+    first = hp2p_series_first(&result->g_bsbw, k);
+    last = first + hp2p_series_size(&result->g_bsbw, k) - 1;
+    values[0] = result->g_bsbw.mean[k];
+    for (s = 0; s < 5; s++)
+      values[s + 1] = hp2p_series_mean(series[s], first, last);
+    if (fcsv != NULL)
+    {
+      fprintf(fcsv, "%d", first);
+      for (s = 0; s < 6; s++)
+	hp2p_export_number(fcsv, ",", values[s]);
+      fprintf(fcsv, ",%d\n", last - first + 1);
+    }
+    if (fjsonl != NULL)
+    {
+      fprintf(fjsonl, "{\"iteration\": %d", first);
+      hp2p_export_number(fjsonl, ", \"bisection_bandwidth\": ", values[0]);
+      hp2p_export_number(fjsonl, ", \"build_time\": ", values[1]);
+      hp2p_export_number(fjsonl, ", \"comm_time\": ", values[2]);
+      hp2p_export_number(fjsonl, ", \"snapshot_time\": ", values[3]);
+      hp2p_export_number(fjsonl, ", \"sync_time\": ", values[4]);
+      hp2p_export_number(fjsonl, ", \"start_skew\": ", values[5]);
+      fprintf(fjsonl, ", \"iterations\": %d}\n", last - first + 1);
+    }
+  }
+  if (fcsv != NULL)
+    hp2p_writer_close(fcsv);
+  if (fjsonl != NULL)
+    hp2p_writer_close(fjsonl);
+}
+
+void hp2p_export_location(FILE *fp, hp2p_result *result, const char *name,
+			  double value, int i, int j)
+{
+  fprintf(fp, "    \"%s\": {\"value\": %.9e, \"src_rank\": %d, \"src_host\": ",
+	  name, value, i);
+  hp2p_export_string(fp, hp2p_mpi_get_host(result->mpi_conf, i));
+  fprintf(fp, ", \"dst_rank\": %d, \"dst_host\": ", j);
+  hp2p_export_string(fp, hp2p_mpi_get_host(result->mpi_conf, j));
+  fprintf(fp, "},\n");
+}
+
+/**
+ * \fn     void hp2p_export_sweep(FILE *fp, hp2p_result *result)
+ * \brief  Write the statistics of each offset of the sweep
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_export_sweep(FILE *fp, hp2p_result *result)
+{
+  int k = 0;
+
+  fprintf(fp, ",\n  \"offsets\": [");
+  for (k = 0; k < result->conf->nb_offsets; k++)
+    fprintf(fp,
+	    "%s\n    {\"offset\": %d, \"samples\": %.0lf, \"avg_bandwidth\": "
+	    "%.9e, \"avg_time\": %.9e, \"min_time\": %.9e}",
+	    k ? "," : "", result->conf->offsets[k],
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_COUNT),
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_BW),
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_TIME),
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_BEST));
+  fprintf(fp, "\n  ]");
+}
+
+/**
+ * \fn     void hp2p_export_placement(FILE *fp, hp2p_result *result)
+ * \brief  Write the placement policy and the binding of each rank
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_export_placement(FILE *fp, hp2p_result *result)
+{
+  hp2p_binding *b = result->mpi_conf->bindings;
+  int numa_node = result->conf->numa_node;
+  int i = 0;
+
+  fprintf(fp, ",\n  \"placement\": {\n");
+  if (numa_node == HP2P_NUMA_NIC)
+    fprintf(fp, "    \"numa_node\": \"nic\",\n");
+  else if (numa_node == HP2P_NUMA_NONE)
+    fprintf(fp, "    \"numa_node\": \"first_touch\",\n");
+  else
+    fprintf(fp, "    \"numa_node\": %d,\n", numa_node);
+  fprintf(fp, "    \"hugepages_mb\": %d,\n", result->conf->hugepages);
+  fprintf(fp, "    \"source\": \"%s\",\n",
+	  hp2p_buffer_source_name[result->conf->buffer_source]);
+  fprintf(fp, "    \"ranks\": [");
+  for (i = 0; b != NULL && i < result->mpi_conf->nproc; i++)
+  {
+    fprintf(fp, "%s\n      {\"rank\": %d, \"host\": ", i ? "," : "", i);
+    hp2p_export_string(fp, hp2p_mpi_get_host(result->mpi_conf, i));
+    fprintf(fp, ", \"cpus\": ");
+    hp2p_export_string(fp, b[i].cpus);
+    fprintf(fp, ", \"cpu_node\": %d, \"buffer_node\": %d, \"page_kb\": %d}",
+	    b[i].cpu_node, b[i].buffer_node, b[i].page_kb);
+  }
+  fprintf(fp, "\n    ]\n");
+  fprintf(fp, "  }");
+}
+
+/**
+ * \fn     void hp2p_export_summary(hp2p_result *result)
+ * \brief  Write the configuration and the statistics of the run to
+ *         <outname>-summary.json
+ *
+ * \param  result
+ **/
+void hp2p_export_summary(hp2p_result *result)
+{
+  hp2p_config *conf = result->conf;
+  FILE *fp = NULL;
+  int ncouples = result->mpi_conf->nproc / 2;
+  double efficiency = 0.0;
+  int i = 0;
+
+  fp = hp2p_export_open(conf, "-summary.json");
+  if (fp == NULL)
+    return;
+  if (ncouples > 0 && result->avg_bw > 0.0)
+    efficiency = 100.0 * result->avg_bsbw / (ncouples * result->avg_bw);
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"config\": {\n");
+  fprintf(fp, "    \"nproc\": %d,\n", result->mpi_conf->nproc);
+  fprintf(fp, "    \"nb_iterations\": %d,\n", conf->nb_shuffle);
+  fprintf(fp, "    \"snap_freq\": %d,\n", conf->snap_freq);
+  fprintf(fp, "    \"msg_size\": %lld,\n", conf->msg_size);
+  fprintf(fp, "    \"nb_msg\": %d,\n", conf->nb_msg);
+  fprintf(fp, "    \"align_size\": %d,\n", conf->align_size);
+  fprintf(fp, "    \"max_time\": %d,\n", conf->max_time);
+  fprintf(fp, "    \"build\": \"%s\",\n", hp2p_algo_name[conf->build]);
+  fprintf(fp, "    \"seed\": %d,\n", conf->seed);
+  fprintf(fp, "    \"sync_mode\": \"%s\",\n",
+	  conf->sync_mode == HP2P_SYNC_PAIR ? "pairwise" : "barrier");
+  fprintf(fp, "    \"fence_freq\": %d,\n", conf->fence_freq);
+  fprintf(fp, "    \"clock_freq\": %d,\n", conf->clock_freq);
+  fprintf(fp, "    \"anomaly_zscore\": %g,\n", conf->anomaly_zscore);
+  fprintf(fp, "    \"warmup\": %d,\n", conf->warmup);
+  fprintf(fp, "    \"verify\": %d,\n", conf->verify);
+  fprintf(fp, "    \"buffer_source\": \"%s\",\n",
+	  hp2p_buffer_source_name[conf->buffer_source]);
+  fprintf(fp, "    \"datatype\": \"%s\",\n",
+	  hp2p_datatype_name[conf->datatype]);
+  fprintf(fp, "    \"output\": ");
+  hp2p_export_string(fp, conf->outname);
+  fprintf(fp, ",\n");
+  fprintf(fp, "    \"start_time\": %.6lf\n", conf->__start_time);
+  fprintf(fp, "  },\n");
+
+  fprintf(fp, "  \"stats\": {\n");
+  fprintf(fp, "    \"iterations_done\": %d,\n", result->current_iteration);
+  fprintf(fp, "    \"pairs\": %d,\n", result->count_time);
+  fprintf(fp, "    \"avg_bandwidth\": %.9e,\n", result->avg_bw);
+  fprintf(fp, "    \"sum_bandwidth\": %.9e,\n", result->sum_bw);
+  fprintf(fp, "    \"stdd_bandwidth\": %.9e,\n", result->stdd_bw);
+  hp2p_export_location(fp, result, "min_bandwidth", result->min_bw,
+		       result->i_min_bw, result->j_min_bw);
+  hp2p_export_location(fp, result, "max_bandwidth", result->max_bw,
+		       result->i_max_bw, result->j_max_bw);
+  fprintf(fp, "    \"avg_time\": %.9e,\n", result->avg_time);
+  fprintf(fp, "    \"sum_time\": %.9e,\n", result->sum_time);
+  fprintf(fp, "    \"stdd_time\": %.9e,\n", result->stdd_time);
+  hp2p_export_location(fp, result, "min_time", result->min_time,
+		       result->i_min_time, result->j_min_time);
+  hp2p_export_location(fp, result, "max_time", result->max_time,
+		       result->i_max_time, result->j_max_time);
+  fprintf(fp, "    \"avg_bisection_bandwidth\": %.9e,\n", result->avg_bsbw);
+  fprintf(fp, "    \"min_bisection_bandwidth\": %.9e,\n", result->min_bsbw);
+  fprintf(fp, "    \"max_bisection_bandwidth\": %.9e,\n", result->max_bsbw);
+  fprintf(fp, "    \"stdd_bisection_bandwidth\": %.9e,\n", result->stdd_bsbw);
+  fprintf(fp, "    \"avg_bisection_efficiency\": %.6lf,\n", efficiency);
+  fprintf(fp, "    \"avg_sync_time\": %.9e,\n", result->avg_sync);
+  fprintf(fp, "    \"max_sync_time\": %.9e,\n", result->max_sync);
+  fprintf(fp, "    \"avg_start_skew\": %.9e,\n", result->avg_skew);
+  fprintf(fp, "    \"max_start_skew\": %.9e,\n", result->max_skew);
+  fprintf(fp, "    \"slow_communications\": %d,\n",
+	  result->nb_timeline + result->timeline_dropped);
+  fprintf(fp, "    \"slow_communications_dropped\": %d,\n",
+	  result->timeline_dropped);
+  fprintf(fp, "    \"max_simultaneous_slow\": %d,\n", result->max_cluster);
+  fprintf(fp, "    \"anomalies\": %d,\n", result->nb_anomaly);
+  fprintf(fp, "    \"anomalies_not_logged\": %d\n",
+	  result->nb_dropped_anomaly);
+  fprintf(fp, "  }");
+  if (conf->converge_width > 0.0)
+  {
+    fprintf(fp, ",\n  \"convergence\": {\n");
+    fprintf(fp, "    \"level\": \"%s\",\n",
+	    conf->converge_level == HP2P_CONVERGE_NODE ? "node" : "rank");
+    fprintf(fp, "    \"confidence\": %g,\n", conf->converge_confidence);
+    fprintf(fp, "    \"half_width\": %g,\n", conf->converge_width);
+    fprintf(fp, "    \"target_fraction\": %g,\n", conf->converge_fraction);
+    fprintf(fp, "    \"pairs\": %lld,\n", result->converge_total);
+    fprintf(fp, "    \"converged_pairs\": %lld,\n", result->converged);
+    fprintf(fp, "    \"coverage\": %.6lf,\n",
+	    result->converge_total > 0
+		? (double)result->converged / result->converge_total
+		: 0.0);
+    if (result->converge_achieved > 0.0)
+      fprintf(fp, "    \"achieved_half_width\": %.6lf,\n",
+	      result->converge_achieved);
+    else
+      fprintf(fp, "    \"achieved_half_width\": null,\n");
+    fprintf(fp, "    \"reached\": %s\n",
+	    result->converge_stop ? "true" : "false");
+    fprintf(fp, "  }");
+  }
+  if (conf->robust_samples > 0)
+  {
+    fprintf(fp, ",\n  \"robust\": {\n");
+    fprintf(fp, "    \"samples\": %d,\n", conf->robust_samples);
+    fprintf(fp, "    \"trim\": %g,\n", conf->robust_trim);
+    fprintf(fp, "    \"groups\": %d,\n", conf->robust_groups);
+    fprintf(fp, "    \"noise\": %g,\n", conf->robust_noise);
+    fprintf(fp, "    \"avg_bandwidth_raw\": %.9e,\n", result->avg_bw);
+    fprintf(fp, "    \"avg_bandwidth_trimmed\": %.9e,\n", result->avg_bw_trim);
+    fprintf(fp, "    \"avg_bandwidth_mom\": %.9e,\n", result->avg_bw_mom);
+    fprintf(fp, "    \"avg_bandwidth_best\": %.9e,\n", result->avg_bw_best);
+    fprintf(fp, "    \"noisy_pairs\": %d,\n", result->noisy_pairs);
+    fprintf(fp, "    \"slow_pairs\": %d\n", result->slow_pairs);
+    fprintf(fp, "  }");
+  }
+  if (conf->verify)
+  {
+    fprintf(fp, ",\n  \"verification\": {\n");
+    fprintf(fp, "    \"corrupted_exchanges\": %lld,\n", result->nb_corrupt);
+    fprintf(fp, "    \"corrupted_pairs\": %d,\n", result->corrupt_pairs);
+    fprintf(fp, "    \"corrupted_words\": %lld,\n", result->corrupt_words);
+    fprintf(fp, "    \"avg_time\": %.9e,\n", result->avg_verify_time);
+    fprintf(fp, "    \"max_time\": %.9e,\n", result->max_verify_time);
+    fprintf(fp, "    \"overhead\": %.6lf\n", result->verify_overhead);
+    fprintf(fp, "  }");
+  }
+  if (conf->datatype != HP2P_TYPE_CONTIGUOUS)
+  {
+    fprintf(fp, ",\n  \"datatype\": {\n");
+    fprintf(fp, "    \"name\": \"%s\",\n", hp2p_datatype_name[conf->datatype]);
+    if (conf->datatype == HP2P_TYPE_VECTOR)
+      fprintf(fp, "    \"block\": %d,\n    \"stride\": %d,\n",
+	      conf->type_block, conf->type_stride);
+    else
+    {
+      fprintf(fp, "    \"sizes\": [");
+      for (i = 0; i < conf->type_ndims; i++)
+	fprintf(fp, "%s%d", i ? ", " : "", conf->type_sizes[i]);
+      fprintf(fp, "],\n    \"subsizes\": [");
+      for (i = 0; i < conf->type_ndims; i++)
+	fprintf(fp, "%s%d", i ? ", " : "", conf->type_subsizes[i]);
+      fprintf(fp, "],\n");
+    }
+    fprintf(fp, "    \"avg_bandwidth\": %.9e,\n", result->avg_type_bw);
+    fprintf(fp, "    \"avg_ratio\": %.6lf,\n", result->avg_type_ratio);
+    fprintf(fp, "    \"min_ratio\": %.6lf,\n", result->min_type_ratio);
+    fprintf(fp, "    \"min_ratio_ranks\": [%d, %d]\n", result->i_min_type,
+	    result->j_min_type);
+    fprintf(fp, "  }");
+  }
+  hp2p_export_placement(fp, result);
+  if (conf->nb_offsets > 0)
+    hp2p_export_sweep(fp, result);
+  fprintf(fp, "\n");
+  fprintf(fp, "}\n");
+  hp2p_writer_close(fp);
+}
+
+/**
+ * \fn     void hp2p_export_write(hp2p_result *result)
+ * \brief  Write the exports requested with -f (json, csv, jsonl, prom)
+ *
+ * This function is collective: the pairs are streamed from all ranks.
+ *
+ * \param  result
+ **/
+void hp2p_export_write(hp2p_result *result)
+{
+  hp2p_config *conf = result->conf;
+  int csv = hp2p_util_has_format(conf, "csv");
+  int jsonl = hp2p_util_has_format(conf, "jsonl");
+
+  if (csv || jsonl)
+    hp2p_export_pairs(result, csv, jsonl);
+  hp2p_metrics_write(result);
+  if (result->mpi_conf->rank != result->mpi_conf->root)
+    return;
+  if (csv || jsonl)
+    hp2p_export_iterations(result, csv, jsonl);
+  if (hp2p_util_has_format(conf, "json"))
+    hp2p_export_summary(result);
+}
@@ -0,0 +1,489 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_heatmap.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Multi-resolution bandwidth heatmap of the HTML output.
+ *
+ *            Level l of the pyramid pools blocks of 2^l x 2^l pairs
+ *            (minimum, mean and maximum of the measured pairs). The
+ *            coarsest level, of at most heatmap_tile x heatmap_tile cells,
+ *            is embedded in the page. Finer levels, down to the full
+ *            resolution (level 0), are cut in tiles of heatmap_tile x
+ *            heatmap_tile cells written in <output>-tiles/L<l>_<r>_<c>.js
+ *            and loaded by the page with script tags when zooming.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+
+#include "hp2p.h"
+
+extern int plotly_id;
+
+// Rendering and drill-down of the heatmap (see hp2p_heatmap_write_html)
+const char hp2p_heatmap_js[] =
+    "<script type=\"text/javascript\">\n"
+    "var hp2p_heatmap = {id: null, nproc: 0, tile: 0, top: 0, path: \"\",\n"
+    "  levels: null, stat: \"mean\", filter: null, tiles: {}, pending: {},\n"
+    "  view: null};\n"
+    "function hp2p_heatmap_size(level) {\n"
+    "  return Math.ceil(hp2p_heatmap.nproc / Math.pow(2, level));\n"
+    "}\n"
+    "function hp2p_tile(level, row, col, data) {\n"
+    "  var key = level + \"_\" + row + \"_\" + col;\n"
+    "  hp2p_heatmap.tiles[key] = data;\n"
+    "  delete hp2p_heatmap.pending[key];\n"
+    "  if (hp2p_heatmap.view != null &&\n"
+    "      Object.keys(hp2p_heatmap.pending).length == 0)\n"
+    "    hp2p_heatmap_draw(hp2p_heatmap.view);\n"
+    "}\n"
+    "function hp2p_heatmap_load(key) {\n"
+    "  if (key in hp2p_heatmap.pending)\n"
+    "    return;\n"
+    "  hp2p_heatmap.pending[key] = true;\n"
+    "  var script = document.createElement(\"script\");\n"
+    "  script.src = hp2p_heatmap.path + \"L\" + key + \".js\";\n"
+    "  document.head.appendChild(script);\n"
+    "}\n"
+    "function hp2p_heatmap_stat(data) {\n"
+    "  return (hp2p_heatmap.stat in data) ? data[hp2p_heatmap.stat] :\n"
+    "    data.mean;\n"
+    "}\n"
+    "// Cells [r0, r1) x [c0, c1) of a level, null until tiles are loaded\n"
+    "function hp2p_heatmap_cells(level, r0, r1, c0, c1) {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  var size = hp2p_heatmap_size(level);\n"
+    "  var z = [];\n"
+    "  var missing = false;\n"
+    "  if (level == h.top) {\n"
+    "    var data = hp2p_heatmap_stat(h.levels);\n"
+    "    for (var i = r0; i < r1; i++)\n"
+    "      z.push(Array.from(data.slice(i * size + c0, i * size + c1)));\n"
+    "    return z;\n"
+    "  }\n"
+    "  for (var tr = Math.floor(r0 / h.tile); tr * h.tile < r1; tr++)\n"
+    "    for (var tc = Math.floor(c0 / h.tile); tc * h.tile < c1; tc++) {\n"
+    "      var key = level + \"_\" + tr + \"_\" + tc;\n"
+    "      if (!(key in h.tiles)) {\n"
+    "        missing = true;\n"
+    "        hp2p_heatmap_load(key);\n"
+    "      }\n"
+    "    }\n"
+    "  if (missing)\n"
+    "    return null;\n"
+    "  for (var i = r0; i < r1; i++) {\n"
+    "    var row = [];\n"
+    "    var tr = Math.floor(i / h.tile);\n"
+    "    for (var j = c0; j < c1; j++) {\n"
+    "      var tc = Math.floor(j / h.tile);\n"
+    "      var width = Math.min(h.tile, size - tc * h.tile);\n"
+    "      var data = hp2p_heatmap_stat(h.tiles[level + \"_\" + tr + \"_\" + "
+    "tc]);\n"
+    "      row.push(data[(i % h.tile) * width + (j % h.tile)]);\n"
+    "    }\n"
+    "    z.push(row);\n"
+    "  }\n"
+    "  return z;\n"
+    "}\n"
+    "function hp2p_heatmap_label(k, f) {\n"
+    "  var n = Math.min(f, hp2p_heatmap.nproc - k * f);\n"
+    "  return (n > 1) ? hostlist[k * f] + \" (+\" + (n - 1) + \")\" :\n"
+    "    hostlist[k * f];\n"
+    "}\n"
+    "// A block of ranks is selected if one of its hosts matches the filter\n"
+    "function hp2p_heatmap_match(k, f) {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  if (h.filter == null)\n"
+    "    return true;\n"
+    "  for (var r = k * f; r < Math.min((k + 1) * f, h.nproc); r++)\n"
+    "    if (h.filter.test(hostlist[r]))\n"
+    "      return true;\n"
+    "  return false;\n"
+    "}\n"
+    "// Draw the ranks [x0, x1) x [y0, y1) at the finest level having at most\n"
+    "// tile x tile cells in the view\n"
+    "function hp2p_heatmap_draw(view) {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  var span = Math.max(view.x1 - view.x0, view.y1 - view.y0);\n"
+    "  var level = 0;\n"
+    "  h.view = view;\n"
+    "  while (level < h.top && span / Math.pow(2, level) > h.tile)\n"
+    "    level++;\n"
+    "  var f = Math.pow(2, level);\n"
+    "  var size = hp2p_heatmap_size(level);\n"
+    "  var r0 = 0, r1 = size, c0 = 0, c1 = size;\n"
+    "  if (level < h.top) {\n"
+    "    c0 = Math.max(0, Math.floor(view.x0 / f));\n"
+    "    c1 = Math.min(size, Math.ceil(view.x1 / f));\n"
+    "    r0 = Math.max(0, Math.floor(view.y0 / f));\n"
+    "    r1 = Math.min(size, Math.ceil(view.y1 / f));\n"
+    "  }\n"
+    "  var z = hp2p_heatmap_cells(level, r0, r1, c0, c1);\n"
+    "  if (z == null)\n"
+    "    return;\n"
+    "  var rows = [], cols = [];\n"
+    "  for (var i = r0; i < r1; i++)\n"
+    "    if (hp2p_heatmap_match(i, f))\n"
+    "      rows.push(i);\n"
+    "  for (var j = c0; j < c1; j++)\n"
+    "    if (hp2p_heatmap_match(j, f))\n"
+    "      cols.push(j);\n"
+    "  var trace = {type: \"heatmapgl\", colorscale: \"Jet\", z: [], x: [],\n"
+    "    y: []};\n"
+    "  var layout = {height: 800, width: 800, autosize: true,\n"
+    "    title: {text: \"Bandwidth (MB/s), \" + h.stat +\n"
+    "      ((f > 1) ? \" of blocks of \" + f + \" x \" + f + \" pairs\" : "
+    "\"\")},\n"
+    "    xaxis: {}, yaxis: {autorange: \"reversed\"}};\n"
+    "  for (const i of rows)\n"
+    "    trace.z.push(cols.map(function(j) { return z[i - r0][j - c0]; }));\n"
+    "  if (h.filter != null) {\n"
+    "    // Only the selected hosts, without drill-down\n"
+    "    trace.x = cols.map(function(j) { return hp2p_heatmap_label(j, f); "
+    "});\n"
+    "    trace.y = rows.map(function(i) { return hp2p_heatmap_label(i, f); "
+    "});\n"
+    "  }\n"
+    "  else {\n"
+    "    // Cells are centered on their ranks\n"
+    "    trace.x = cols.map(function(j) { return j * f + (f - 1) / 2; });\n"
+    "    trace.y = rows.map(function(i) { return i * f + (f - 1) / 2; });\n"
+    "    layout.xaxis = {range: [view.x0 - 0.5, view.x1 - 0.5]};\n"
+    "    layout.yaxis = {range: [view.y1 - 0.5, view.y0 - 0.5]};\n"
+    "  }\n"
+    "  h.level = level;\n"
+    "  h.drawing = true;\n"
+    "  Plotly.react(h.id, [trace], layout);\n"
+    "  h.drawing = false;\n"
+    "}\n"
+    "function hp2p_heatmap_relayout(event) {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  var view = {x0: 0, x1: h.nproc, y0: 0, y1: h.nproc};\n"
+    "  if (h.drawing || h.filter != null)\n"
+    "    return;\n"
+    "  if (\"xaxis.range[0]\" in event) {\n"
+    "    view.x0 = event[\"xaxis.range[0]\"] + 0.5;\n"
+    "    view.x1 = event[\"xaxis.range[1]\"] + 0.5;\n"
+    "  }\n"
+    "  else if (!(\"xaxis.autorange\" in event) && h.view != null) {\n"
+    "    view.x0 = h.view.x0;\n"
+    "    view.x1 = h.view.x1;\n"
+    "  }\n"
+    "  if (\"yaxis.range[0]\" in event) {\n"
+    "    view.y0 = Math.min(event[\"yaxis.range[0]\"],\n"
+    "                       event[\"yaxis.range[1]\"]) + 0.5;\n"
+    "    view.y1 = Math.max(event[\"yaxis.range[0]\"],\n"
+    "                       event[\"yaxis.range[1]\"]) + 0.5;\n"
+    "  }\n"
+    "  else if (!(\"yaxis.autorange\" in event) && h.view != null) {\n"
+    "    view.y0 = h.view.y0;\n"
+    "    view.y1 = h.view.y1;\n"
+    "  }\n"
+    "  hp2p_heatmap_draw(view);\n"
+    "}\n"
+    "function hp2p_heatmap_hover(event) {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  var point = event.points[0];\n"
+    "  var f = Math.pow(2, h.level);\n"
+    "  var text = (typeof point.x == \"string\") ?\n"
+    "    point.y + \" -> \" + point.x :\n"
+    "    hp2p_heatmap_label(Math.floor(point.y / f), f) + \" -> \" +\n"
+    "    hp2p_heatmap_label(Math.floor(point.x / f), f);\n"
+    "  document.getElementById(h.id + \"-info\").textContent =\n"
+    "    text + \": \" + point.z + \" MB/s\";\n"
+    "}\n"
+    "function hp2p_heatmap_select() {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  var filter = document.getElementById(h.id + \"-filter\").value;\n"
+    "  h.stat = document.getElementById(h.id + \"-stat\").value;\n"
+    "  try {\n"
+    "    h.filter = (filter.length > 0) ? new RegExp(filter) : null;\n"
+    "  } catch (e) {\n"
+    "    h.filter = null;\n"
+    "  }\n"
+    "  hp2p_heatmap_draw(h.view);\n"
+    "}\n"
+    "function hp2p_heatmap_init(id, nproc, tile, top, path, levels) {\n"
+    "  var h = hp2p_heatmap;\n"
+    "  h.id = id;\n"
+    "  h.nproc = nproc;\n"
+    "  h.tile = tile;\n"
+    "  h.top = top;\n"
+    "  h.path = path;\n"
+    "  h.levels = levels;\n"
+    "  hp2p_heatmap_draw({x0: 0, x1: nproc, y0: 0, y1: nproc});\n"
+    "  var div = document.getElementById(id);\n"
+    "  if (div.on) {\n"
+    "    div.on(\"plotly_relayout\", hp2p_heatmap_relayout);\n"
+    "    div.on(\"plotly_hover\", hp2p_heatmap_hover);\n"
+    "  }\n"
+    "}\n"
+    "</script>\n";
+
+/**
+ * \fn     int hp2p_heatmap_levels(hp2p_result result)
+ * \brief  Coarsest level of the pyramid of the heatmap
+ *
+ * \param  result
+ * \return smallest level of at most heatmap_tile x heatmap_tile cells,
+ *         0 if the full matrix is embedded in the page
+ **/
+int hp2p_heatmap_levels(hp2p_result result)
+{
+  int nproc = result.mpi_conf->nproc;
+  int tile = result.conf->heatmap_tile;
+  int level = 0;
+
+  if (tile <= 0)
+    return 0;
+  while (((nproc - 1) >> level) + 1 > tile)
+    level++;
+  return level;
+}
+
+/**
+ * \fn     void hp2p_heatmap_pool(hp2p_result result, int level, int row,
+ *                                int col, int nrows, int ncols, double *min,
+ *                                double *mean, double *max)
+ * \brief  Compute cells of a level of the pyramid from the bandwidths
+ *
+ * A cell pools the measured pairs of a block of 2^level x 2^level pairs,
+ * cells without measured pairs are 0.
+ *
+ * \param  result
+ * \param  level
+ * \param  row   first row of cells
+ * \param  col   first column of cells
+ * \param  nrows number of rows of cells
+ * \param  ncols number of columns of cells
+ * \param  min   minimum of each cell (output, nrows * ncols)
+ * \param  mean  mean of each cell (output)
+ * \param  max   maximum of each cell (output)
+ **/
+void hp2p_heatmap_pool(hp2p_result result, int level, int row, int col,
+		       int nrows, int ncols, double *min, double *mean,
+		       double *max)
+{
+  int nproc = result.mpi_conf->nproc;
+  int f = 1 << level;
+  double bw = 0.0;
+  double lo = 0.0;
+  double hi = 0.0;
+  double sum = 0.0;
+  int count = 0;
+  int i = 0;
+  int j = 0;
+  int a = 0;
+  int b = 0;
+
+  for (i = 0; i < nrows; i++)
+    for (j = 0; j < ncols; j++)
+    {
+      lo = 0.0;
+      hi = 0.0;
+      sum = 0.0;
+      count = 0;
+      for (a = (row + i) * f; a < (row + i + 1) * f && a < nproc; a++)
+	for (b = (col + j) * f; b < (col + j + 1) * f && b < nproc; b++)
+	{
+	  bw = result.g_bw[(size_t)a * nproc + b];
+	  if (bw <= 0.0)
+	    continue;
+	  if (count == 0 || bw < lo)
+	    lo = bw;
+	  if (bw > hi)
+	    hi = bw;
+	  sum += bw;
+	  count++;
+	}
+      min[i * ncols + j] = lo;
+      mean[i * ncols + j] = (count > 0) ? sum / count : 0.0;
+      max[i * ncols + j] = hi;
+    }
+}
+
+/**
+ * \fn     void hp2p_heatmap_write_tiles(hp2p_result result)
+ * \brief  Write the tiles of the levels finer than the embedded one
+ *
+ * \param  result
+ **/
+void hp2p_heatmap_write_tiles(hp2p_result result)
+{
+  FILE *fp = NULL;
+  char *dirname = NULL;
+  char *filename = NULL;
+  double *min = NULL;
+  double *mean = NULL;
+  double *max = NULL;
+  double m = 1024.0 * 1024.0;
+  int nproc = result.mpi_conf->nproc;
+  int tile = result.conf->heatmap_tile;
+  int top = 0;
+  int size = 0;
+  int nrows = 0;
+  int ncols = 0;
+  int level = 0;
+  int r = 0;
+  int c = 0;
+
+  top = hp2p_heatmap_levels(result);
+  if (top == 0)
+    return;
+
+  dirname = (char *)malloc((strlen(result.conf->outname) + 8) * sizeof(char));
+  filename =
+      (char *)malloc((strlen(result.conf->outname) + 64) * sizeof(char));
+  sprintf(dirname, "%s-tiles", result.conf->outname);
+  if (mkdir(dirname, 0755) != 0 && errno != EEXIST)
+  {
+    fprintf(stderr, "Failed to create %s\n", dirname);
+    free(dirname);
+    free(filename);
+    return;
+  }
+  min = (double *)malloc((size_t)tile * tile * sizeof(double));
+  mean = (double *)malloc((size_t)tile * tile * sizeof(double));
+  max = (double *)malloc((size_t)tile * tile * sizeof(double));
+
+  for (level = 0; level < top; level++)
+  {
+    size = ((nproc - 1) >> level) + 1;
+    for (r = 0; r * tile < size; r++)
+      for (c = 0; c * tile < size; c++)
+      {
+	nrows = (size - r * tile < tile) ? size - r * tile : tile;
+	ncols = (size - c * tile < tile) ? size - c * tile : tile;
+	hp2p_heatmap_pool(result, level, r * tile, c * tile, nrows, ncols,
+			  min, mean, max);
+	sprintf(filename, "%s/L%d_%d_%d.js", dirname, level, r, c);
+	fp = hp2p_writer_open(filename, "w");
+	if (fp == NULL)
+	  continue;
+	fprintf(fp, "(function() {\n");
+	hp2p_result_write_html_array(fp, result, "mean", mean,
+				     (size_t)nrows * ncols, m,
+				     HP2P_HTML_FLOAT32, 0, 2);
+	if (level == 0)
+	  fprintf(fp, "hp2p_tile(%d, %d, %d, {\"mean\": mean});\n", level, r,
+		  c);
+	else
+	{
+	  hp2p_result_write_html_array(fp, result, "min", min,
+				       (size_t)nrows * ncols, m,
+				       HP2P_HTML_FLOAT32, 0, 2);
+	  hp2p_result_write_html_array(fp, result, "max", max,
+				       (size_t)nrows * ncols, m,
+				       HP2P_HTML_FLOAT32, 0, 2);
+	  fprintf(fp,
+		  "hp2p_tile(%d, %d, %d, {\"min\": min, \"mean\": mean, "
+		  "\"max\": max});\n",
+		  level, r, c);
+	}
+	fprintf(fp, "})();\n");
+	hp2p_writer_close(fp);
+      }
+  }
+  free(min);
+  free(mean);
+  free(max);
+  free(dirname);
+  free(filename);
+}
+
+/**
+ * \fn     void hp2p_heatmap_write_html(FILE *fp, hp2p_result result)
+ * \brief  Write the heatmap of the bandwidths in the HTML page
+ *
+ * Without tiles, the page must define bandwidth_flat. Otherwise the
+ * coarsest level is embedded, the tiles are written next to the page and
+ * the page must define heatmap_tile and heatmap_path (relative path of
+ * the tiles).
+ * As the other plots of the page, the flex container is left open.
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_heatmap_write_html(FILE *fp, hp2p_result result)
+{
+  double *min = NULL;
+  double *mean = NULL;
+  double *max = NULL;
+  double m = 1024.0 * 1024.0;
+  int nproc = result.mpi_conf->nproc;
+  int top = 0;
+  int size = 0;
+  int id = plotly_id++;
+
+  top = hp2p_heatmap_levels(result);
+  fputs(hp2p_heatmap_js, fp);
+  fprintf(fp, "<div class=flex-container >\n");
+  fprintf(fp, "<div>\n");
+  fprintf(fp,
+	  "Value: <select id=\"%d-stat\" onchange=\"hp2p_heatmap_select()\">"
+	  "<option value=\"mean\">mean</option><option value=\"min\">min"
+	  "</option><option value=\"max\">max</option></select>\n",
+	  id);
+  fprintf(fp,
+	  "Hosts (regular expression): <input type=\"text\" id=\"%d-filter\" "
+	  "onchange=\"hp2p_heatmap_select()\">\n",
+	  id);
+  fprintf(fp, "<span id=\"%d-info\"></span>\n", id);
+  fprintf(fp,
+	  "<div id=\"%d\" style=\"height: 800px; width: 80%%;\" "
+	  "class=\"plotly-graph-div\"></div>\n",
+	  id);
+  fprintf(fp, "  <script type=\"text/javascript\">\n");
+  fprintf(fp, "    window.PLOTLYENV=window.PLOTLYENV || {};\n");
+  fprintf(fp, "    window.PLOTLYENV.BASE_URL=\"https://plot.ly\";\n");
+  if (top == 0)
+  {
+    fprintf(fp,
+	    "    hp2p_heatmap_init(\"%d\", %d, %d, 0, \"\", "
+	    "{\"mean\": bandwidth_flat});\n",
+	    id, nproc, nproc);
+  }
+  else
+  {
+    size = ((nproc - 1) >> top) + 1;
+    min = (double *)malloc((size_t)size * size * sizeof(double));
+    mean = (double *)malloc((size_t)size * size * sizeof(double));
+    max = (double *)malloc((size_t)size * size * sizeof(double));
+    hp2p_heatmap_pool(result, top, 0, 0, size, size, min, mean, max);
+    hp2p_result_write_html_array(fp, result, "heatmap_min", min,
+				 (size_t)size * size, m, HP2P_HTML_FLOAT32, 0,
+				 2);
+    hp2p_result_write_html_array(fp, result, "heatmap_mean", mean,
+				 (size_t)size * size, m, HP2P_HTML_FLOAT32, 0,
+				 2);
+    hp2p_result_write_html_array(fp, result, "heatmap_max", max,
+				 (size_t)size * size, m, HP2P_HTML_FLOAT32, 0,
+				 2);
+    free(min);
+    free(mean);
+    free(max);
+    fprintf(fp,
+	    "    hp2p_heatmap_init(\"%d\", %d, heatmap_tile, %d, heatmap_path, "
+	    "{\"min\": heatmap_min, \"mean\": heatmap_mean, \"max\": "
+	    "heatmap_max});\n",
+	    id, nproc, top);
+  }
+  fprintf(fp, "  </script>\n");
+  fprintf(fp, "</div>\n");
+  hp2p_heatmap_write_tiles(result);
+}
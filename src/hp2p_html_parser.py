@@ -9,13 +9,83 @@
 # modify and/ or redistribute the software under the terms of the CeCILL-C
 # license as circulated by CEA, CNRS and INRIA at the following URL
 # "http://www.cecill.info".
-"""Script and functions to process the HTML file generated by HP2P benchmark
+"""Script and functions to process the results of HP2P benchmark
+
+Results are read from the binary file (format version 3, see hp2p_binary.h)
+when possible: the file is mapped in memory and the matrices are used in
+place with numpy. HTML files are still supported as a fallback. Without
+numpy, the same commands run on Python arrays (slower on large runs).
 """
 
 import sys
+import re
 import json
+import base64
+import array
+import mmap
+import os
+import math
+import struct
+import statistics
 import click
-import plotly.express as px
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+# Binary format (hp2p_binary.h)
+BINARY_MAGIC = b"HP2PBIN\0"
+BINARY_VERSION = 3
+BINARY_ENDIAN = 0x01020304
+BINARY_MAX_SECTIONS = 16
+# magic, version, endian, checksum, file_size, header_size, nb_sections,
+# nproc, nb_shuffle, nb_iterations, snap_freq, msg_size, nb_msg,
+# align_size, build, seed, sync_mode, reserved, start_time, write_time
+BINARY_HEADER = "8sIIQQII4iq6idd"
+BINARY_SECTION = "IIQQ"
+BINARY_HOSTNAMES = 1
+BINARY_HOSTS = 2
+BINARY_BANDWIDTH = 3
+BINARY_TIME = 4
+BINARY_COUNT = 5
+BINARY_BISECTION = 6
+# type: (array typecode, numpy type)
+BINARY_TYPES = {1: ("B", "u1"), 2: ("i", "i4"), 3: ("f", "f4"),
+                4: ("d", "f8")}
+
+MB = 1024.0 * 1024.0
+
+
+def find_between_patterns(contents, start_pattern, end_pattern):
+    """Find string between two motifs in a string
+
+    Parameters
+    ----------
+    contents : string
+       Content of a HTML file
+
+    start_pattern : string
+       motif at the start
+
+    end_pattern : string
+       motif at the end
+
+    Returns
+    -------
+    string
+       string between motifs else None if not found
+    """
+    start_index = contents.find(start_pattern)
+    if start_index == -1:
+        print(f"'{start_pattern}' was not found")
+        return None
+    start_index += len(start_pattern)
+    end_index = contents.find(end_pattern, start_index)
+    if end_index == -1:
+        print(f"'{end_pattern}' was not found")
+        return None
+    return contents[start_index:end_index]
 
 
 def read_between_patterns(file_path, start_pattern, end_pattern):
@@ -39,39 +109,30 @@ def read_between_patterns(file_path, start_pattern, end_pattern):
     """
     try:
         with open(file_path, 'r', encoding="utf-8") as file:
-            file_contents = file.read()
-            start_index = file_contents.find(start_pattern)
-            if start_index == -1:
-                print(f"'{start_pattern}' was not found in '{file_path}'")
-                return None
-            start_index += len(start_pattern)
-            end_index = file_contents.find(end_pattern, start_index)
-            if end_index == -1:
-                print(f"'{end_pattern}' was not found in '{file_path}'")
-                return None
-            return file_contents[start_index:end_index]
+            return find_between_patterns(file.read(), start_pattern,
+                                         end_pattern)
     except FileNotFoundError:
         print(f"'{file_path}' was not found")
         sys.exit(1)
     return None
 
 
-def read_hostlist(filename):
+def read_hostlist(contents):
     """Read hostlist variable
 
     Hostlist is a list of string containing hostname
 
     Parameters
     ----------
-    file_path : string
-       Filename of HTML file
+    contents : string
+       Content of HTML file
 
     Returns
     -------
     list
        list of hostnames
     """
-    found_string = read_between_patterns(filename, "// hostlist start",
+    found_string = find_between_patterns(contents, "// hostlist start",
                                          "// hostlist end").splitlines()[2]
     last_comma_index = found_string.rfind(',')
     found_string = found_string[:last_comma_index] + \
@@ -79,53 +140,137 @@ def read_hostlist(filename):
     return json.loads("{ \"tab\": " + found_string + "}")["tab"]
 
 
-def read_msgsize(filename):
+def read_msgsize(contents):
     """Read msgsize variable
 
     msgsize is an integer containing the message size used for the benchmark
 
     Parameters
     ----------
-    file_path : string
-       Filename of HTML file
+    contents : string
+       Content of HTML file
 
     Returns
     -------
     integer
        message size
     """
-    return int(read_between_patterns(filename, "// msg_size start",
+    return int(find_between_patterns(contents, "// msg_size start",
                                      "// msg_size end")
                .splitlines()[2])
 
 
-def read_bandwidth(filename):
+def decode_array(found_string):
+    """Decode an array written with hp2p_decode
+
+    Parameters
+    ----------
+    found_string : string
+       hp2p_decode("f32"|"f64", "<base64>") call
+
+    Returns
+    -------
+    array
+       array of floats (numpy array if numpy is available)
+    """
+    match = re.search(r'hp2p_decode\("(f32|f64)", "([^"]*)"\)', found_string)
+    raw = base64.b64decode(match.group(2))
+    if np is not None:
+        return np.frombuffer(raw, dtype="<f4" if match.group(1) == "f32"
+                             else "<f8")
+    values = array.array('f' if match.group(1) == "f32" else 'd')
+    values.frombytes(raw)
+    if sys.byteorder == "big":
+        values.byteswap()
+    return values
+
+
+def read_bandwidth(contents):
     """Read bendwidth variable
 
-    Bandwidth is a matrix of bandwiths
+    Bandwidth is a matrix of bandwiths, written either as a JavaScript
+    array or as a base64 typed array
 
     Parameters
     ----------
-    file_path : string
-       Filename of HTML file
+    contents : string
+       Content of HTML file
 
     Returns
     -------
-    list
-       list of hostnames
+    array
+       flattened matrix of bandwidths (MB/s)
     """
-    found_string = read_between_patterns(filename, "// bandwidth start",
+    found_string = find_between_patterns(contents, "// bandwidth start",
                                          "// bandwidth end").splitlines()[2]
-    return json.loads("{ \"tab\": " + found_string.replace(", ]", " ]")
+    if found_string.startswith("hp2p_decode"):
+        return decode_array(found_string)
+    rows = json.loads("{ \"tab\": " + found_string.replace(", ]", " ]")
                       .replace(",     ]", " ]") + "}")["tab"]
+    values = [value for row in rows for value in row]
+    if np is not None:
+        return np.array(values)
+    return values
 
 
-def read_file(filename):
+def read_tiles(filename, contents, nproc):
+    """Read the bandwidth matrix from the tiles of a large run
+
+    Above heatmap_tile ranks, the matrix is not in the page but in
+    full-resolution tiles (<output>-tiles/L0_<row>_<col>.js)
+
+    Parameters
+    ----------
+    filename : string
+       Filename of HTML file
+
+    contents : string
+       Content of HTML file
+
+    nproc : integer
+       Number of ranks
+
+    Returns
+    -------
+    array
+       flattened matrix of bandwidths (MB/s)
+    """
+    lines = find_between_patterns(contents, "// tiles start",
+                                  "// tiles end").splitlines()
+    tile = int(lines[2])
+    path = os.path.join(os.path.dirname(filename), json.loads(lines[5]))
+    if np is not None:
+        values = np.zeros(nproc * nproc, dtype=np.float32)
+    else:
+        values = array.array('f', bytes(4 * nproc * nproc))
+    for row in range(0, nproc, tile):
+        for col in range(0, nproc, tile):
+            name = os.path.join(path, f"L0_{row // tile}_{col // tile}.js")
+            with open(name, 'r', encoding="utf-8") as file:
+                found_string = find_between_patterns(file.read(),
+                                                     "var mean = \n", "\n;")
+            if found_string.startswith("hp2p_decode"):
+                tile_values = decode_array(found_string)
+            else:
+                tile_values = array.array('f', json.loads(
+                    found_string.replace(",    ]", "]")))
+            width = min(tile, nproc - col)
+            for i in range(min(tile, nproc - row)):
+                start = (row + i) * nproc + col
+                values[start:start + width] = \
+                    tile_values[i * width:(i + 1) * width]
+    return values
+
+
+def read_html(filename):
     """Read HTML input file
 
+    The file is read once, only the bandwidth matrix is available (in the
+    page or in its tiles)
+
     Parameters
     ----------
-    file_path : string
+    filename : string
        Filename of HTML file
 
     Returns
@@ -133,13 +278,476 @@ def read_file(filename):
     hashmap
        data
     """
+    try:
+        with open(filename, 'r', encoding="utf-8") as file:
+            contents = file.read()
+    except FileNotFoundError:
+        print(f"'{filename}' was not found")
+        sys.exit(1)
+    data = {}
+    data["hostlist"] = read_hostlist(contents)
+    data["nproc"] = len(data["hostlist"])
+    data["msgsize"] = read_msgsize(contents)
+    if "// tiles start" in contents:
+        data["bandwidth"] = read_tiles(filename, contents, data["nproc"])
+    else:
+        data["bandwidth"] = read_bandwidth(contents)
+    data["bw_scale"] = 1.0
+    return data
+
+
+def read_section(buffer, order, section):
+    """Read a section of a mapped binary file
+
+    Parameters
+    ----------
+    buffer : numpy.memmap or mmap
+       mapped file
+
+    order : string
+       struct byte order of the file
+
+    section : tuple
+       (id, type, offset, count) entry of the table of sections
+
+    Returns
+    -------
+    array
+       view of the section (numpy) or copy of the section (array)
+    """
+    _, kind, offset, count = section
+    code, dtype = BINARY_TYPES[kind]
+    if np is not None:
+        return np.frombuffer(buffer, dtype=np.dtype(dtype).newbyteorder(order),
+                             count=count, offset=offset)
+    values = array.array(code)
+    values.frombytes(buffer[offset:offset + count * values.itemsize])
+    if (order == "<") != (sys.byteorder == "little"):
+        values.byteswap()
+    return values
+
+
+def read_binary(filename):
+    """Read binary input file (format version 3)
+
+    Parameters
+    ----------
+    filename : string
+       Filename of binary file
+
+    Returns
+    -------
+    hashmap
+       data
+    """
+    if np is not None:
+        buffer = np.memmap(filename, dtype=np.uint8, mode='r')
+    else:
+        with open(filename, 'rb') as file:
+            buffer = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+    # The endianness marker tells the byte order of the writer
+    order = "<"
+    header = struct.unpack_from(order + BINARY_HEADER, buffer)
+    if header[2] != BINARY_ENDIAN:
+        order = ">"
+        header = struct.unpack_from(order + BINARY_HEADER, buffer)
+    if header[0] != BINARY_MAGIC or header[1] != BINARY_VERSION or \
+       header[4] != len(buffer) or header[6] > BINARY_MAX_SECTIONS:
+        print(f"'{filename}' is not a HP2P binary file (version 3)")
+        sys.exit(1)
+    sections = {}
+    offset = struct.calcsize(order + BINARY_HEADER)
+    for _ in range(header[6]):
+        section = struct.unpack_from(order + BINARY_SECTION, buffer, offset)
+        sections[section[0]] = read_section(buffer, order, section)
+        offset += struct.calcsize(order + BINARY_SECTION)
+
     data = {}
-    data["hostlist"] = read_hostlist(filename)
-    data["msgsize"] = read_msgsize(filename)
-    data["bandwidth"] = read_bandwidth(filename)
+    data["nproc"] = header[7]
+    data["iterations"] = header[9]
+    data["msgsize"] = header[11]
+    strings = bytes(sections[BINARY_HOSTNAMES])
+    data["hostlist"] = [strings[i:strings.index(b"\0", i)].decode()
+                        for i in sections[BINARY_HOSTS]]
+    data["bandwidth"] = sections[BINARY_BANDWIDTH]
+    data["bw_scale"] = 1.0 / MB
+    data["time"] = sections.get(BINARY_TIME)
+    data["count"] = sections.get(BINARY_COUNT)
+    data["bisection"] = sections.get(BINARY_BISECTION)
     return data
 
 
+def read_file(filename):
+    """Read input file (binary or HTML)
+
+    Parameters
+    ----------
+    filename : string
+       Filename of binary or HTML file
+
+    Returns
+    -------
+    hashmap
+       data: hostlist, nproc, msgsize, bandwidth (flattened matrix, to
+       multiply by bw_scale for MB/s) and for binary files iterations,
+       time, count and bisection
+    """
+    try:
+        with open(filename, 'rb') as file:
+            magic = file.read(len(BINARY_MAGIC))
+    except FileNotFoundError:
+        print(f"'{filename}' was not found")
+        sys.exit(1)
+    if magic == BINARY_MAGIC:
+        return read_binary(filename)
+    return read_html(filename)
+
+
+def measured_pairs(data):
+    """Find the pairs which have communicated
+
+    Parameters
+    ----------
+    data : hashmap
+       data from read_file
+
+    Returns
+    -------
+    tuple
+       bandwidths (MB/s), source ranks and destination ranks of the pairs
+    """
+    nproc = data["nproc"]
+    values = data["bandwidth"]
+    scale = data["bw_scale"]
+    if np is not None:
+        index = np.flatnonzero(values > 0.0)
+        return values[index] * scale, index // nproc, index % nproc
+    index = [k for k, value in enumerate(values) if value > 0.0]
+    return ([values[k] * scale for k in index], [k // nproc for k in index],
+            [k % nproc for k in index])
+
+
+def lowest(values, top):
+    """Indices of the lowest values in increasing order
+
+    Parameters
+    ----------
+    values : array
+       values
+
+    top : integer
+       number of indices
+
+    Returns
+    -------
+    list
+       indices
+    """
+    top = min(top, len(values))
+    if top <= 0:
+        return []
+    if np is not None:
+        index = np.argpartition(values, top - 1)[:top]
+        return index[np.argsort(values[index], kind="stable")]
+    return sorted(range(len(values)), key=values.__getitem__)[:top]
+
+
+def host_stats(data):
+    """Bandwidths of the pairs of each host
+
+    Parameters
+    ----------
+    data : hashmap
+       data from read_file
+
+    Returns
+    -------
+    list
+       (host, ranks, pairs, mean, min, mean sent, mean received) of each
+       host with at least one pair, bandwidths in MB/s
+    """
+    values, src, dst = measured_pairs(data)
+    hosts = sorted(set(data["hostlist"]))
+    ids = {host: i for i, host in enumerate(hosts)}
+    host_of = [ids[host] for host in data["hostlist"]]
+    nhost = len(hosts)
+    if np is not None:
+        host_of = np.array(host_of, dtype=np.int64)
+        ranks = np.bincount(host_of, minlength=nhost)
+        src_host = host_of[src]
+        dst_host = host_of[dst]
+        sent = np.bincount(src_host, weights=values, minlength=nhost)
+        nsent = np.bincount(src_host, minlength=nhost)
+        received = np.bincount(dst_host, weights=values, minlength=nhost)
+        nreceived = np.bincount(dst_host, minlength=nhost)
+        minimum = np.full(nhost, np.inf)
+        np.minimum.at(minimum, src_host, values)
+        np.minimum.at(minimum, dst_host, values)
+    else:
+        ranks = [0] * nhost
+        sent = [0.0] * nhost
+        nsent = [0] * nhost
+        received = [0.0] * nhost
+        nreceived = [0] * nhost
+        minimum = [float("inf")] * nhost
+        for host in host_of:
+            ranks[host] += 1
+        for value, i, j in zip(values, src, dst):
+            sent[host_of[i]] += value
+            nsent[host_of[i]] += 1
+            received[host_of[j]] += value
+            nreceived[host_of[j]] += 1
+            minimum[host_of[i]] = min(minimum[host_of[i]], value)
+            minimum[host_of[j]] = min(minimum[host_of[j]], value)
+    stats = []
+    for i, host in enumerate(hosts):
+        pairs = int(nsent[i] + nreceived[i])
+        if pairs == 0:
+            continue
+        stats.append((host, int(ranks[i]), pairs,
+                      float(sent[i] + received[i]) / pairs,
+                      float(minimum[i]),
+                      float(sent[i]) / nsent[i] if nsent[i] else 0.0,
+                      float(received[i]) / nreceived[i]
+                      if nreceived[i] else 0.0))
+    return stats
+
+
+def rank_keys(hostlist):
+    """Identify ranks independently of their order
+
+    The k-th rank on a host is identified by (host, k) so that two runs can
+    be aligned even if ranks were placed in another order
+
+    Parameters
+    ----------
+    hostlist : list
+       hostname of each rank
+
+    Returns
+    -------
+    list
+       key of each rank
+    """
+    seen = {}
+    keys = []
+    for host in hostlist:
+        keys.append((host, seen.get(host, 0)))
+        seen[host] = seen.get(host, 0) + 1
+    return keys
+
+
+def align_ranks(hostlist_a, hostlist_b):
+    """Ranks of two runs placed on the same hosts
+
+    Parameters
+    ----------
+    hostlist_a : list
+       hostnames of the first run
+
+    hostlist_b : list
+       hostnames of the second run
+
+    Returns
+    -------
+    tuple
+       ranks of the first run and matching ranks of the second run
+    """
+    index_b = {key: j for j, key in enumerate(rank_keys(hostlist_b))}
+    ranks_a = []
+    ranks_b = []
+    for i, key in enumerate(rank_keys(hostlist_a)):
+        if key in index_b:
+            ranks_a.append(i)
+            ranks_b.append(index_b[key])
+    return (np.array(ranks_a, dtype=np.int64),
+            np.array(ranks_b, dtype=np.int64))
+
+
+def relative_noise(data):
+    """Relative dispersion of the bandwidths of a run
+
+    The coefficient of variation between pairs is used as an upper bound of
+    the dispersion between samples of a pair, which is not stored
+
+    Parameters
+    ----------
+    data : hashmap
+       data from read_file
+
+    Returns
+    -------
+    float
+       standard deviation / mean
+    """
+    values, _, _ = measured_pairs(data)
+    if len(values) == 0:
+        return 0.0
+    return float(values.std() / values.mean())
+
+
+def compare_runs(data_a, data_b, top, zscore, diff, resolution):
+    """Compare the bandwidths of the pairs of two runs
+
+    Pairs are compared on the log of the ratio of bandwidths. When the
+    number of communications of the pairs is known (binary files), the
+    standard error of the log of the mean bandwidth of a pair is estimated
+    as noise / sqrt(count) and each delta gets a z-score. Matrices are
+    processed by blocks of rows to bound the memory used.
+
+    Parameters
+    ----------
+    data_a : hashmap
+       data of the reference run
+
+    data_b : hashmap
+       data of the new run
+
+    top : integer
+       number of pairs of the ranked list
+
+    zscore : float
+       threshold of significant differences (ignored without counts)
+
+    diff : float
+       minimum relative difference of a regression or improvement (%)
+
+    resolution : integer
+       maximum size of the diff heatmap (blocks of ranks are averaged)
+
+    Returns
+    -------
+    hashmap
+       ranks_a, ranks_b, pairs, mean (mean log ratio), number of
+       regressions and improvements, worst (ranked list of the regressions
+       as arrays i, j, log ratio, z-score), per host statistics and heatmap
+    """
+    ranks_a, ranks_b = align_ranks(data_a["hostlist"], data_b["hostlist"])
+    nrank = len(ranks_a)
+    nproc_a = data_a["nproc"]
+    nproc_b = data_b["nproc"]
+    # MB/s whatever the format (binary files hold B/s)
+    bw_a = (np.asarray(data_a["bandwidth"], dtype=np.float64)
+            .reshape(nproc_a, nproc_a) * data_a["bw_scale"])
+    bw_b = (np.asarray(data_b["bandwidth"], dtype=np.float64)
+            .reshape(nproc_b, nproc_b) * data_b["bw_scale"])
+    count_a = data_a.get("count")
+    count_b = data_b.get("count")
+    significance = count_a is not None and count_b is not None
+    if significance:
+        count_a = count_a.reshape(nproc_a, nproc_a)
+        count_b = count_b.reshape(nproc_b, nproc_b)
+        var_a = relative_noise(data_a) ** 2
+        var_b = relative_noise(data_b) ** 2
+    hosts, host_of = np.unique([data_a["hostlist"][i] for i in ranks_a],
+                               return_inverse=True)
+    nhost = len(hosts)
+    host_sum = np.zeros(nhost)
+    host_var = np.zeros(nhost)
+    host_pairs = np.zeros(nhost, dtype=np.int64)
+    pool = max(1, -(-nrank // max(1, resolution)))
+    size = -(-nrank // pool)
+    heat_sum = np.zeros(size * size)
+    heat_count = np.zeros(size * size)
+    worst = (np.empty(0, dtype=np.int64), np.empty(0, dtype=np.int64),
+             np.empty(0), np.empty(0))
+    total = 0.0
+    pairs = 0
+    regressions = 0
+    improvements = 0
+    block = max(1, (1 << 22) // max(1, nrank))
+    slower = math.log1p(-min(diff, 99.0) / 100.0)
+    faster = math.log1p(diff / 100.0)
+
+    for start in range(0, nrank, block):
+        rows = slice(start, min(nrank, start + block))
+        a = bw_a[np.ix_(ranks_a[rows], ranks_a)]
+        b = bw_b[np.ix_(ranks_b[rows], ranks_b)]
+        mask = (a > 0.0) & (b > 0.0)
+        i, j = np.nonzero(mask)
+        ratio = np.log(b[mask] / a[mask])
+        if significance:
+            n_a = count_a[np.ix_(ranks_a[rows], ranks_a)][mask]
+            n_b = count_b[np.ix_(ranks_b[rows], ranks_b)][mask]
+            var = var_a / np.maximum(n_a, 1) + var_b / np.maximum(n_b, 1)
+            score = ratio / np.sqrt(np.maximum(var, 1.0e-300))
+        else:
+            var = np.zeros(len(ratio))
+            score = ratio
+            zscore = 0.0
+        i += start
+        total += float(ratio.sum())
+        pairs += len(ratio)
+        regression = (ratio < slower) & (score < -zscore)
+        regressions += int(np.count_nonzero(regression))
+        improvements += int(np.count_nonzero((ratio > faster) &
+                                             (score > zscore)))
+
+        for host in (host_of[i], host_of[j]):
+            host_sum += np.bincount(host, weights=ratio, minlength=nhost)
+            host_var += np.bincount(host, weights=var, minlength=nhost)
+            host_pairs += np.bincount(host, minlength=nhost)
+
+        cell = (i // pool) * size + j // pool
+        heat_sum += np.bincount(cell, weights=np.expm1(ratio),
+                                minlength=size * size)
+        heat_count += np.bincount(cell, minlength=size * size)
+
+        # Keep the top regressions seen so far
+        worst = tuple(np.concatenate((kept, new[regression])) for kept, new
+                      in zip(worst, (i, j, ratio, score)))
+        keep = lowest(worst[3], top)
+        worst = tuple(values[keep] for values in worst)
+
+    heatmap = np.full(size * size, np.nan)
+    np.divide(heat_sum, heat_count, out=heatmap, where=heat_count > 0)
+    with np.errstate(divide="ignore", invalid="ignore"):
+        host_mean = host_sum / host_pairs
+        if significance:
+            host_z = host_sum / np.sqrt(host_var)
+        else:
+            host_z = host_mean
+    return {"ranks_a": ranks_a, "ranks_b": ranks_b, "pairs": pairs,
+            "mean": total / pairs if pairs else 0.0,
+            "significance": significance, "regressions": regressions,
+            "improvements": improvements,
+            "worst": worst, "hosts": hosts, "host_pairs": host_pairs,
+            "host_mean": host_mean, "host_z": host_z, "pool": pool,
+            "heatmap": heatmap.reshape(size, size) * 100.0}
+
+
+def write_diff_heatmap(data, result, output):
+    """Write the heatmap of the relative differences of bandwidth
+
+    Parameters
+    ----------
+    data : hashmap
+       data of the reference run (for hostnames)
+
+    result : hashmap
+       result of compare_runs
+
+    output : string
+       HTML or image file
+    """
+    # plotly is only needed by the heatmap
+    import plotly.graph_objects as go
+    hostlist = data["hostlist"]
+    ranks = result["ranks_a"]
+    pool = result["pool"]
+    labels = [hostlist[ranks[k]] for k in range(0, len(ranks), pool)]
+    if pool > 1:
+        labels = [f"{label} (+{pool - 1})" for label in labels]
+    fig = go.Figure(go.Heatmap(z=result["heatmap"], x=labels, y=labels,
+                               colorscale="RdBu", zmid=0.0,
+                               colorbar={"title": "%"}))
+    fig.update_layout(title_text='Bandwidth difference (%)', title_x=0.5)
+    if output.endswith(".html"):
+        fig.write_html(output)
+    else:
+        fig.write_image(output)
+
+
 @click.group()
 def main():
     """ Main function
@@ -153,12 +761,178 @@ def main():
 def png(filename, output):
     """ Command to generate PNG static image
     """
+    # plotly is only needed by this command
+    import plotly.express as px
     data = read_file(filename)
-    fig = px.imshow(data["bandwidth"], x=data["hostlist"],
+    nproc = data["nproc"]
+    values = data["bandwidth"]
+    if np is not None:
+        matrix = values.reshape(nproc, nproc) * data["bw_scale"]
+    else:
+        matrix = [[value * data["bw_scale"]
+                   for value in values[i * nproc:(i + 1) * nproc]]
+                  for i in range(nproc)]
+    fig = px.imshow(matrix, x=data["hostlist"],
                     y=data["hostlist"], color_continuous_scale="Jet")
     fig.update_layout(title_text='Bandwidth (MB/s)', title_x=0.5)
     fig.write_image(output)
 
 
+@main.command()
+@click.argument('filename')
+def summary(filename):
+    """ Command to print the statistics of a run
+    """
+    data = read_file(filename)
+    hostlist = data["hostlist"]
+    values, src, dst = measured_pairs(data)
+    print(f" Number of processes      : {data['nproc']}")
+    print(f" Number of hosts          : {len(set(hostlist))}")
+    if "iterations" in data:
+        print(f" Iterations               : {data['iterations']}")
+    print(f" Message size             : {data['msgsize']}")
+    print(f" Pairs measured           : {len(values)}")
+    if len(values) == 0:
+        return
+    k_min = lowest(values, 1)[0]
+    k_max = lowest([-value for value in values] if np is None
+                   else -values, 1)[0]
+    if np is not None:
+        mean = float(values.mean())
+        stdd = float(values.std())
+    else:
+        mean = statistics.fmean(values)
+        stdd = statistics.pstdev(values)
+    print(f" Min bandwidth            : {values[k_min]:.2f} MB/s "
+          f"({hostlist[src[k_min]]} -> {hostlist[dst[k_min]]})")
+    print(f" Max bandwidth            : {values[k_max]:.2f} MB/s "
+          f"({hostlist[src[k_max]]} -> {hostlist[dst[k_max]]})")
+    print(f" Avg bandwidth            : {mean:.2f} MB/s")
+    print(f" Std bandwidth            : {stdd:.2f} MB/s")
+    bisection = data.get("bisection")
+    if bisection is not None and len(bisection) > 0:
+        bisection = [value / MB for value in bisection]
+        print(f" Min bisection bandwidth  : {min(bisection):.2f} MB/s")
+        print(f" Max bisection bandwidth  : {max(bisection):.2f} MB/s")
+        print(f" Avg bisection bandwidth  : "
+              f"{statistics.fmean(bisection):.2f} MB/s")
+
+
+@main.command()
+@click.argument('filename')
+@click.option('--top', default=10, help='Number of hosts (0 = all)')
+@click.option('--best', is_flag=True, help='Rank the fastest hosts first')
+def hosts(filename, top, best):
+    """ Command to rank hosts by the mean bandwidth of their pairs
+    """
+    stats = host_stats(read_file(filename))
+    stats.sort(key=lambda host: host[3], reverse=best)
+    if top > 0:
+        stats = stats[:top]
+    print(f"{'host':<24} {'ranks':>6} {'pairs':>8} {'avg MB/s':>10} "
+          f"{'min MB/s':>10} {'sent MB/s':>10} {'recv MB/s':>10}")
+    for host, ranks, pairs, mean, minimum, sent, received in stats:
+        print(f"{host:<24} {ranks:>6} {pairs:>8} {mean:>10.2f} "
+              f"{minimum:>10.2f} {sent:>10.2f} {received:>10.2f}")
+
+
+@main.command()
+@click.argument('filename')
+@click.option('--top', default=10, help='Number of pairs')
+def worst(filename, top):
+    """ Command to print the pairs with the lowest bandwidth
+    """
+    data = read_file(filename)
+    hostlist = data["hostlist"]
+    nproc = data["nproc"]
+    values, src, dst = measured_pairs(data)
+    print(f"{'src':>6} {'src host':<24} {'dst':>6} {'dst host':<24} "
+          f"{'MB/s':>10} {'count':>6} {'time (us)':>10}")
+    for k in lowest(values, top):
+        i = int(src[k])
+        j = int(dst[k])
+        line = f"{i:>6} {hostlist[i]:<24} {j:>6} {hostlist[j]:<24} " \
+            f"{values[k]:>10.2f}"
+        if data.get("count") is not None:
+            line += f" {int(data['count'][i * nproc + j]):>6}"
+        if data.get("time") is not None:
+            line += f" {data['time'][i * nproc + j] * 1.0e6:>10.2f}"
+        print(line)
+
+
+@main.command()
+@click.argument('reference')
+@click.argument('filename')
+@click.option('--top', default=10, help='Number of pairs and hosts')
+@click.option('--zscore', default=3.0,
+              help='Threshold of significant differences')
+@click.option('--diff', default=5.0,
+              help='Minimum difference of a regression (%)')
+@click.option('--heatmap', default=None,
+              help='HTML or image file of the diff heatmap')
+@click.option('--resolution', default=1000,
+              help='Maximum number of rows of the heatmap')
+def compare(reference, filename, top, zscore, diff, heatmap, resolution):
+    """ Command to compare a run to a reference run
+    """
+    if np is None:
+        print("compare requires numpy")
+        sys.exit(1)
+    data_a = read_file(reference)
+    data_b = read_file(filename)
+    # The heatmap is reduced to one cell if it is not written
+    if heatmap is None:
+        resolution = 1
+    result = compare_runs(data_a, data_b, top, zscore, diff, resolution)
+    hostlist = data_a["hostlist"]
+    print(f" Ranks compared           : {len(result['ranks_a'])} "
+          f"({data_a['nproc']} / {data_b['nproc']})")
+    print(f" Pairs compared           : {result['pairs']}")
+    print(f" Mean difference          : "
+          f"{math.expm1(result['mean']) * 100.0:+.2f} %")
+    threshold = f"|diff| > {diff} %"
+    if result["significance"]:
+        threshold += f", |z| > {zscore}"
+    else:
+        print(" No number of communications (HTML file): no z-score")
+    print(f" Regressions              : {result['regressions']} "
+          f"({threshold})")
+    print(f" Improvements             : {result['improvements']}")
+    print("")
+    header = f"{'src host':<24} {'dst host':<24} {'ref MB/s':>10} " \
+        f"{'new MB/s':>10} {'diff %':>8}"
+    print(header + (f" {'z':>8}" if result["significance"] else ""))
+    for i, j, ratio, score in zip(*result["worst"]):
+        src_a = result["ranks_a"][i]
+        dst_a = result["ranks_a"][j]
+        src_b = result["ranks_b"][i]
+        dst_b = result["ranks_b"][j]
+        bw_a = data_a["bandwidth"][src_a * data_a["nproc"] + dst_a] * \
+            data_a["bw_scale"]
+        bw_b = data_b["bandwidth"][src_b * data_b["nproc"] + dst_b] * \
+            data_b["bw_scale"]
+        line = f"{hostlist[src_a]:<24} {hostlist[dst_a]:<24} " \
+            f"{bw_a:>10.2f} {bw_b:>10.2f} {math.expm1(ratio) * 100.0:>+8.2f}"
+        if result["significance"]:
+            line += f" {score:>8.2f}"
+        print(line)
+
+    print("")
+    header = f"{'host':<24} {'pairs':>8} {'diff %':>8}"
+    print(header + (f" {'z':>8}" if result["significance"] else ""))
+    order = lowest(result["host_z"], top)
+    for k in order:
+        if result["host_pairs"][k] == 0:
+            continue
+        line = f"{result['hosts'][k]:<24} {result['host_pairs'][k]:>8} " \
+            f"{math.expm1(result['host_mean'][k]) * 100.0:>+8.2f}"
+        if result["significance"]:
+            line += f" {result['host_z'][k]:>8.2f}"
+        print(line)
+
+    if heatmap is not None:
+        write_diff_heatmap(data_a, result, heatmap)
+
+
 if __name__ == '__main__':
     main()
@@ -0,0 +1,261 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_metrics.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Live metrics of the run in the Prometheus text format (-f
+ *            prom). At every snapshot the root writes <outname>.prom.tmp
+ *            and renames it to <outname>.prom, so that a scraper (e.g.
+ *            the textfile collector of node_exporter) never reads a
+ *            partial file.
+ */
+
+#include "hp2p.h"
+
+/**
+ * \fn     void hp2p_metrics_alloc(hp2p_result *result)
+ * \brief  Allocate the bandwidth of the nodes on the root
+ *
+ * Nodes are the ones of the host table (see hp2p_mpi_host_table).
+ *
+ * \param  result
+ **/
+void hp2p_metrics_alloc(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+
+  result->metrics_nodes = 0;
+  result->metrics_bw = NULL;
+  if (!hp2p_util_has_format(result->conf, "prom") ||
+      mpi_conf->rank != mpi_conf->root)
+    return;
+  result->metrics_nodes = mpi_conf->nb_hosts;
+  result->metrics_bw =
+      (double *)calloc(2 * result->metrics_nodes, sizeof(double));
+}
+
+void hp2p_metrics_free(hp2p_result *result)
+{
+  free(result->metrics_bw);
+  result->metrics_bw = NULL;
+}
+
+/**
+ * \fn     void hp2p_metrics_label(FILE *fp, const char *value)
+ * \brief  Write the value of a label with the escapes of the format
+ *
+ * \param  fp
+ * \param  value
+ **/
+void hp2p_metrics_label(FILE *fp, const char *value)
+{
+  for (; *value != '\0'; value++)
+  {
+    if (*value == '\\' || *value == '"')
+      fputc('\\', fp);
+    if (*value == '\n')
+      fputs("\\n", fp);
+    else
+      fputc(*value, fp);
+  }
+}
+
+/**
+ * \fn     void hp2p_metrics_head(FILE *fp, const char *name,
+ *                                const char *type, const char *help)
+ * \brief  Write the HELP and TYPE lines of a metric
+ *
+ * \param  fp
+ * \param  name
+ * \param  type "gauge" or "counter"
+ * \param  help
+ **/
+void hp2p_metrics_head(FILE *fp, const char *name, const char *type,
+		       const char *help)
+{
+  fprintf(fp, "# HELP %s %s\n", name, help);
+  fprintf(fp, "# TYPE %s %s\n", name, type);
+}
+
+/**
+ * \fn     void hp2p_metrics_sample(FILE *fp, const char *name,
+ *                                  const char *run, const char *label,
+ *                                  const char *value, double sample)
+ * \brief  Write a sample of a metric with the run label and an optional
+ *         label
+ *
+ * \param  fp
+ * \param  name
+ * \param  run    value of the run label
+ * \param  label  name of the other label or NULL
+ * \param  value  value of the other label
+ * \param  sample
+ **/
+void hp2p_metrics_sample(FILE *fp, const char *name, const char *run,
+			 const char *label, const char *value, double sample)
+{
+  fprintf(fp, "%s{run=\"", name);
+  hp2p_metrics_label(fp, run);
+  if (label != NULL)
+  {
+    fprintf(fp, "\",%s=\"", label);
+    hp2p_metrics_label(fp, value);
+  }
+  fprintf(fp, "\"} %.12g\n", sample);
+}
+
+/**
+ * \fn     void hp2p_metrics_write(hp2p_result *result)
+ * \brief  Write <outname>.prom: iterations, bandwidth of the pairs and of
+ *         the nodes, bisection bandwidth and anomaly counts
+ *
+ * Must follow hp2p_result_update. This function is collective: the
+ * bandwidth of the pairs of each rank is gathered by the root.
+ *
+ * \param  result
+ **/
+void hp2p_metrics_write(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_config *conf = result->conf;
+  FILE *fp = NULL;
+  char *filename = NULL;
+  char *tmpname = NULL;
+  const char *run = NULL;
+  const char *stats[3] = {"min", "avg", "max"};
+  const char *name = NULL;
+  double bw[3];
+  double bsbw[3];
+  double local[2] = {0.0, 0.0};
+  double *rows = NULL;
+  int node = 0;
+  int j = 0;
+  int k = 0;
+
+  if (!hp2p_util_has_format(conf, "prom"))
+    return;
+  // Sum of the bandwidths of the pairs of the rank
+  for (j = 0; j < mpi_conf->nproc; j++)
+  {
+    if (j == mpi_conf->rank || result->l_count[j] == 0)
+      continue;
+    local[0] += result->l_bw[j];
+    local[1] += 1.0;
+  }
+  if (mpi_conf->rank == mpi_conf->root)
+    rows = (double *)malloc(2 * mpi_conf->nproc * sizeof(double));
+  MPI_Gather(local, 2, MPI_DOUBLE, rows, 2, MPI_DOUBLE, mpi_conf->root,
+	     mpi_conf->comm);
+  if (mpi_conf->rank != mpi_conf->root)
+    return;
+  for (k = 0; k < 2 * result->metrics_nodes; k++)
+    result->metrics_bw[k] = 0.0;
+  for (j = 0; j < mpi_conf->nproc; j++)
+  {
+    node = mpi_conf->host_node[j];
+    result->metrics_bw[2 * node] += rows[2 * j];
+    result->metrics_bw[2 * node + 1] += rows[2 * j + 1];
+  }
+  free(rows);
+
+  filename = (char *)malloc((strlen(conf->outname) + 16) * sizeof(char));
+  tmpname = (char *)malloc((strlen(conf->outname) + 16) * sizeof(char));
+  strcpy(filename, conf->outname);
+  strcat(filename, ".prom");
+  strcpy(tmpname, filename);
+  strcat(tmpname, ".tmp");
+  fp = hp2p_writer_open(tmpname, "w");
+  if (fp == NULL)
+  {
+    fprintf(stderr, "Cannot open %s\n", tmpname);
+    free(filename);
+    free(tmpname);
+    return;
+  }
+  run = strrchr(conf->outname, '/');
+  run = (run != NULL) ? run + 1 : conf->outname;
+  bw[0] = result->min_bw;
+  bw[1] = result->avg_bw;
+  bw[2] = result->max_bw;
+  bsbw[0] = result->min_bsbw;
+  bsbw[1] = result->avg_bsbw;
+  bsbw[2] = result->max_bsbw;
+
+  hp2p_metrics_head(fp, "hp2p_iterations", "gauge", "Iterations done");
+  hp2p_metrics_sample(fp, "hp2p_iterations", run, NULL, NULL,
+		      result->current_iteration);
+  hp2p_metrics_head(fp, "hp2p_iterations_requested", "gauge",
+		    "Iterations requested");
+  hp2p_metrics_sample(fp, "hp2p_iterations_requested", run, NULL, NULL,
+		      conf->nb_shuffle);
+  hp2p_metrics_head(fp, "hp2p_ranks", "gauge", "MPI ranks of the run");
+  hp2p_metrics_sample(fp, "hp2p_ranks", run, NULL, NULL, mpi_conf->nproc);
+  hp2p_metrics_head(fp, "hp2p_message_size_bytes", "gauge",
+		    "Size of a message");
+  hp2p_metrics_sample(fp, "hp2p_message_size_bytes", run, NULL, NULL,
+		      (double)conf->msg_size);
+  hp2p_metrics_head(fp, "hp2p_bandwidth_bytes_per_second", "gauge",
+		    "Bandwidth of the pairs of ranks");
+  for (k = 0; k < 3; k++)
+    hp2p_metrics_sample(fp, "hp2p_bandwidth_bytes_per_second", run, "stat",
+			stats[k], bw[k]);
+  hp2p_metrics_head(fp, "hp2p_bisection_bandwidth_bytes_per_second", "gauge",
+		    "Bisection bandwidth of the iterations");
+  for (k = 0; k < 3; k++)
+    hp2p_metrics_sample(fp, "hp2p_bisection_bandwidth_bytes_per_second", run,
+			"stat", stats[k], bsbw[k]);
+  hp2p_metrics_head(fp, "hp2p_node_bandwidth_bytes_per_second", "gauge",
+		    "Average bandwidth of the pairs sent from a node");
+  // The first rank of node k is the first rank numbered k
+  for (j = 0, node = 0; j < mpi_conf->nproc; j++)
+  {
+    if (mpi_conf->host_node[j] != node)
+      continue;
+    name = mpi_conf->anonymize
+	       ? hp2p_mpi_get_host(mpi_conf, j)
+	       : &mpi_conf->host_names[mpi_conf->host_offset[node]];
+    if (result->metrics_bw[2 * node + 1] > 0.0)
+      hp2p_metrics_sample(
+	  fp, "hp2p_node_bandwidth_bytes_per_second", run, "node", name,
+	  result->metrics_bw[2 * node] / result->metrics_bw[2 * node + 1]);
+    node++;
+  }
+  hp2p_metrics_head(fp, "hp2p_anomalies_total", "counter",
+		    "Slow communications of the pairs");
+  hp2p_metrics_sample(fp, "hp2p_anomalies_total", run, NULL, NULL,
+		      result->nb_anomaly);
+  hp2p_metrics_head(fp, "hp2p_anomalies_kind_total", "counter",
+		    "Slow communications of the pairs by detector");
+  for (k = 0; k < HP2P_ANOMALY_NB_KINDS; k++)
+    hp2p_metrics_sample(fp, "hp2p_anomalies_kind_total", run, "kind",
+			hp2p_anomaly_kind[k], result->kind_anomaly[k]);
+  if (conf->verify)
+  {
+    hp2p_metrics_head(fp, "hp2p_corrupted_exchanges_total", "counter",
+		      "Exchanges with corrupted data");
+    hp2p_metrics_sample(fp, "hp2p_corrupted_exchanges_total", run, NULL,
+			NULL, (double)result->nb_corrupt);
+  }
+  hp2p_metrics_head(fp, "hp2p_last_snapshot_timestamp_seconds", "gauge",
+		    "Date of the last snapshot");
+  hp2p_metrics_sample(fp, "hp2p_last_snapshot_timestamp_seconds", run, NULL,
+		      NULL, hp2p_util_get_time());
+  hp2p_writer_close(fp);
+  if (rename(tmpname, filename) != 0)
+    fprintf(stderr, "Cannot rename %s to %s\n", tmpname, filename);
+  free(filename);
+  free(tmpname);
+}
@@ -17,13 +17,119 @@
  * \date      June 21 2023
  * \brief     HP2P Benchmark
  *
- * \details   No
+ * \details   MPI setup and host table. The hostnames are gathered
+ *            through the first rank of each node (local_comm): the root
+ *            keeps the name of each node once and the node and local rank
+ *            of each rank, so that startup and memory scale with the
+ *            number of nodes rather than with MPI_MAX_PROCESSOR_NAME bytes
+ *            per rank on every rank.
  */
 
 #include "hp2p.h"
 
+/**
+ * \fn     void hp2p_mpi_host_table(hp2p_mpi_config *mpi_conf,
+ *                                  const char *nodename)
+ * \brief  Build the host table on the root from the first rank of each
+ *         node
+ *
+ * This function is collective.
+ *
+ * \param  mpi_conf
+ * \param  nodename name of the node of the rank
+ **/
+void hp2p_mpi_host_table(hp2p_mpi_config *mpi_conf, const char *nodename)
+{
+  MPI_Comm leader_comm;
+  int *local_ranks = NULL;
+  int *ranks = NULL;
+  int *infos = NULL;
+  int *counts = NULL;
+  int *displs = NULL;
+  int info[2];
+  int nb = 0;
+  int size = 0;
+  int i = 0;
+  int k = 0;
+
+  mpi_conf->host_names = NULL;
+  mpi_conf->host_offset = NULL;
+  mpi_conf->host_size = NULL;
+  mpi_conf->host_node = NULL;
+  mpi_conf->host_rank = NULL;
+  mpi_conf->nb_hosts = 0;
+  // Ranks of the node on its first rank, in the order of the local ranks
+  if (mpi_conf->local_rank == 0)
+    local_ranks = (int *)malloc(mpi_conf->local_nproc * sizeof(int));
+  MPI_Gather(&mpi_conf->rank, 1, MPI_INT, local_ranks, 1, MPI_INT, 0,
+	     mpi_conf->local_comm);
+  // The root is the first rank of its node and of leader_comm
+  MPI_Comm_split(mpi_conf->comm, mpi_conf->local_rank == 0 ? 0 : MPI_UNDEFINED,
+		 mpi_conf->rank, &leader_comm);
+  if (mpi_conf->local_rank != 0)
+    return;
+
+  MPI_Comm_size(leader_comm, &nb);
+  info[0] = mpi_conf->local_nproc;
+  info[1] = strlen(nodename) + 1;
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    infos = (int *)malloc(2 * nb * sizeof(int));
+    counts = (int *)malloc(nb * sizeof(int));
+    displs = (int *)malloc(nb * sizeof(int));
+  }
+  MPI_Gather(info, 2, MPI_INT, infos, 2, MPI_INT, 0, leader_comm);
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    mpi_conf->nb_hosts = nb;
+    mpi_conf->host_offset = (int *)malloc(nb * sizeof(int));
+    mpi_conf->host_size = (int *)malloc(nb * sizeof(int));
+    for (k = 0, size = 0; k < nb; k++)
+    {
+      mpi_conf->host_size[k] = infos[2 * k];
+      mpi_conf->host_offset[k] = size;
+      counts[k] = infos[2 * k + 1];
+      displs[k] = size;
+      size += counts[k];
+    }
+    mpi_conf->host_names = (char *)malloc(size * sizeof(char));
+  }
+  MPI_Gatherv(nodename, info[1], MPI_CHAR, mpi_conf->host_names, counts,
+	      displs, MPI_CHAR, 0, leader_comm);
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    ranks = (int *)malloc(mpi_conf->nproc * sizeof(int));
+    for (k = 0, size = 0; k < nb; k++)
+    {
+      counts[k] = infos[2 * k];
+      displs[k] = size;
+      size += counts[k];
+    }
+  }
+  MPI_Gatherv(local_ranks, info[0], MPI_INT, ranks, counts, displs, MPI_INT,
+	      0, leader_comm);
+  MPI_Comm_free(&leader_comm);
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    mpi_conf->host_node = (int *)malloc(mpi_conf->nproc * sizeof(int));
+    mpi_conf->host_rank = (int *)malloc(mpi_conf->nproc * sizeof(int));
+    for (k = 0; k < nb; k++)
+      for (i = 0; i < counts[k]; i++)
+      {
+	mpi_conf->host_node[ranks[displs[k] + i]] = k;
+	mpi_conf->host_rank[ranks[displs[k] + i]] = i;
+      }
+  }
+  free(local_ranks);
+  free(ranks);
+  free(infos);
+  free(counts);
+  free(displs);
+}
+
 int hp2p_mpi_init(int *argc, char ***argv, hp2p_mpi_config *mpi_conf)
 {
+  char nodename[MPI_MAX_PROCESSOR_NAME] = "";
   int namelen = 0;
 
   mpi_conf->comm = MPI_COMM_WORLD;
@@ -44,7 +150,11 @@ int hp2p_mpi_init(int *argc, char ***argv, hp2p_mpi_config *mpi_conf)
 #endif
 
   mpi_conf->root = 0;
-  MPI_Get_processor_name(mpi_conf->localhost, &namelen);
+  mpi_conf->bindings = NULL;
+  mpi_conf->anonymize = 0;
+  hp2p_clock_init(&mpi_conf->clock);
+  MPI_Get_processor_name(nodename, &namelen);
+  strcpy(mpi_conf->localhost, nodename);
   if (mpi_conf->local_nproc > 1)
   {
     char tmpstr[64] = "";
@@ -52,35 +162,95 @@ int hp2p_mpi_init(int *argc, char ***argv, hp2p_mpi_config *mpi_conf)
     strncat(mpi_conf->localhost, tmpstr, 64);
   }
 
-  mpi_conf->hostlist =
-      malloc(mpi_conf->nproc * MPI_MAX_PROCESSOR_NAME * sizeof(char));
-  MPI_Allgather(mpi_conf->localhost, MPI_MAX_PROCESSOR_NAME, MPI_CHAR,
-		mpi_conf->hostlist, MPI_MAX_PROCESSOR_NAME, MPI_CHAR,
-		mpi_conf->comm);
+  hp2p_mpi_host_table(mpi_conf, nodename);
   return EXIT_SUCCESS;
 };
 
 int hp2p_mpi_get_hostname(hp2p_mpi_config *mpi_conf, int anonymize)
 {
-  char rank_str[MPI_MAX_PROCESSOR_NAME] = "";
+  // Names are formatted from the host table (see hp2p_mpi_get_host)
+  mpi_conf->anonymize = (anonymize == 1);
+  return EXIT_SUCCESS;
+};
 
-  sprintf(rank_str, "rank_%d", mpi_conf->rank);
-#if defined(_ENABLE_CUDA_) || defined(_ENABLE_ROCM_)
-  sprintf(rank_str, "%s:%d", mpi_conf->localhost, mpi_conf->local_rank);
+/**
+ * \fn     char *hp2p_mpi_get_host(hp2p_mpi_config *mpi_conf, int rank)
+ * \brief  Hostname of a rank: name of its node, followed by its local
+ *         rank if the node has several ranks
+ *
+ * The host table is only kept on the root: other ranks only know their
+ * own name. The name is formatted in one of HP2P_HOST_SLOTS static
+ * buffers, so that a few names can be used in the same call.
+ *
+ * \param  mpi_conf
+ * \param  rank
+ * \return hostname (not to free, overwritten by later calls)
+ **/
+char *hp2p_mpi_get_host(hp2p_mpi_config *mpi_conf, int rank)
+{
+  static char names[HP2P_HOST_SLOTS][HP2P_HOST_NAME];
+  static int slot = 0;
+  char *name = names[slot];
+  int node = 0;
+
+  slot = (slot + 1) % HP2P_HOST_SLOTS;
+  if (mpi_conf->anonymize)
+  {
+    sprintf(name, "rank_%d", rank);
+#if !defined(_ENABLE_CUDA_) && !defined(_ENABLE_ROCM_)
+    return name;
 #endif
+  }
+  if (mpi_conf->host_node == NULL)
+    strcpy(name, rank == mpi_conf->rank ? mpi_conf->localhost : "");
+  else
+  {
+    node = mpi_conf->host_node[rank];
+    strcpy(name, &mpi_conf->host_names[mpi_conf->host_offset[node]]);
+    if (mpi_conf->host_size[node] > 1)
+      sprintf(name + strlen(name), ":%d", mpi_conf->host_rank[rank]);
+  }
+  // Anonymized names of GPU runs: hostname and device
+  if (mpi_conf->anonymize && mpi_conf->host_node != NULL)
+    sprintf(name + strlen(name), ":%d", mpi_conf->host_rank[rank]);
+  return name;
+}
+
+/**
+ * \fn     char **hp2p_mpi_get_hosts(hp2p_mpi_config *mpi_conf)
+ * \brief  Hostnames of all the ranks (root)
+ *
+ * The array and the names are a single allocation.
+ *
+ * \param  mpi_conf
+ * \return hostname of each rank (free the array only)
+ **/
+char **hp2p_mpi_get_hosts(hp2p_mpi_config *mpi_conf)
+{
+  char **names = NULL;
+  char *pool = NULL;
+  size_t size = 0;
+  int i = 0;
 
-  if (anonymize == 1)
+  for (i = 0; i < mpi_conf->nproc; i++)
+    size += strlen(hp2p_mpi_get_host(mpi_conf, i)) + 1;
+  names = (char **)malloc(mpi_conf->nproc * sizeof(char *) + size);
+  pool = (char *)(names + mpi_conf->nproc);
+  for (i = 0; i < mpi_conf->nproc; i++)
   {
-    MPI_Allgather(rank_str, MPI_MAX_PROCESSOR_NAME, MPI_CHAR,
-		  mpi_conf->hostlist, MPI_MAX_PROCESSOR_NAME, MPI_CHAR,
-		  mpi_conf->comm);
+    names[i] = strcpy(pool, hp2p_mpi_get_host(mpi_conf, i));
+    pool += strlen(pool) + 1;
   }
-  return EXIT_SUCCESS;
-};
+  return names;
+}
 
 int hp2p_mpi_finalize(hp2p_mpi_config *mpi_conf)
 {
-  free(mpi_conf->hostlist);
+  free(mpi_conf->host_names);
+  free(mpi_conf->host_offset);
+  free(mpi_conf->host_size);
+  free(mpi_conf->host_node);
+  free(mpi_conf->host_rank);
   MPI_Finalize();
   return EXIT_SUCCESS;
 };
@@ -0,0 +1,225 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_reader.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Command line reader of the binary result files
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hp2p_binary.h"
+
+const char *hp2p_reader_section_name(uint32_t id)
+{
+  switch (id)
+  {
+  case HP2P_BINARY_HOSTNAMES:
+    return "hostnames";
+  case HP2P_BINARY_HOSTS:
+    return "hosts";
+  case HP2P_BINARY_BANDWIDTH:
+    return "bandwidth";
+  case HP2P_BINARY_TIME:
+    return "time";
+  case HP2P_BINARY_COUNT:
+    return "count";
+  case HP2P_BINARY_BISECTION:
+    return "bisection";
+  default:
+    return "unknown";
+  }
+}
+
+void hp2p_reader_display_help(char command[])
+{
+  printf("Usage: %s [-h] [-n] [-l] [-m bw|time|count] file.bin\n", command);
+  printf("Options:\n");
+  printf("   -n                 Do not verify the checksum\n");
+  printf("   -l                 List the sections of the file\n");
+  printf("   -m matrix          Print a matrix (bandwidth in MB/s, time in\n");
+  printf("                      s or number of communications)\n");
+  printf("\n");
+}
+
+/**
+ * \fn     void hp2p_reader_display_summary(const hp2p_binary *bin)
+ * \brief  Print the configuration and the bandwidth statistics of a run
+ *
+ * \param  bin
+ **/
+void hp2p_reader_display_summary(const hp2p_binary *bin)
+{
+  const hp2p_binary_header *h = bin->header;
+  double m = 1024.0 * 1024.0;
+  double bw = 0.0;
+  double sum = 0.0;
+  double min = 1.0e15;
+  double max = 0.0;
+  int i_min = 0;
+  int j_min = 0;
+  int i_max = 0;
+  int j_max = 0;
+  int count = 0;
+  int i = 0;
+  int j = 0;
+
+  printf(" Format version              : %u\n", h->version);
+  printf(" Number of processes         : %d\n", h->nproc);
+  printf(" Iterations done / requested : %d / %d\n", h->nb_iterations,
+	 h->nb_shuffle);
+  printf(" Iterations between snapshot : %d\n", h->snap_freq);
+  printf(" Message size                : %lld\n", (long long)h->msg_size);
+  printf(" Number of msg per comm      : %d\n", h->nb_msg);
+  printf(" Alignment for MPI buffer    : %d\n", h->align_size);
+  printf(" Build couple algorithm      : %d\n", h->build);
+  printf(" Seed                        : %d\n", h->seed);
+  printf(" Synchronization mode        : %d\n", h->sync_mode);
+  printf(" Duration                    : %0.2lf s\n",
+	 h->write_time - h->start_time);
+  printf("\n");
+
+  for (i = 0; i < h->nproc; i++)
+    for (j = 0; j < h->nproc; j++)
+    {
+      bw = hp2p_binary_get(bin, HP2P_BINARY_BANDWIDTH,
+			   (uint64_t)i * h->nproc + j);
+      if (bw <= 0.0)
+	continue;
+      sum += bw;
+      count++;
+      if (bw < min)
+      {
+	min = bw;
+	i_min = i;
+	j_min = j;
+      }
+      if (bw > max)
+      {
+	max = bw;
+	i_max = i;
+	j_max = j;
+      }
+    }
+  if (count == 0)
+  {
+    printf(" No communication\n");
+    return;
+  }
+  printf(" Min bandwidth            : %0.2lf MB/s (%s -> %s)\n", min / m,
+	 hp2p_binary_hostname(bin, i_min), hp2p_binary_hostname(bin, j_min));
+  printf(" Max bandwidth            : %0.2lf MB/s (%s -> %s)\n", max / m,
+	 hp2p_binary_hostname(bin, i_max), hp2p_binary_hostname(bin, j_max));
+  printf(" Avg bandwidth            : %0.2lf MB/s\n", sum / count / m);
+  printf(" Pairs measured           : %d\n", count);
+}
+
+int main(int argc, char *argv[])
+{
+  hp2p_binary bin;
+  const hp2p_binary_section *sec = NULL;
+  const char *matrix = NULL;
+  uint32_t id = 0;
+  uint32_t s = 0;
+  double scale = 1.0;
+  int check = 1;
+  int list = 0;
+  int err = 0;
+  int opt = 0;
+  int i = 0;
+  int j = 0;
+
+  while ((opt = getopt(argc, argv, "hnlm:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'h':
+      hp2p_reader_display_help(argv[0]);
+      return EXIT_SUCCESS;
+    case 'n':
+      check = 0;
+      break;
+    case 'l':
+      list = 1;
+      break;
+    case 'm':
+      matrix = optarg;
+      break;
+    default:
+      hp2p_reader_display_help(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind >= argc)
+  {
+    hp2p_reader_display_help(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  err = hp2p_binary_open(&bin, argv[optind], check);
+  if (err != HP2P_BINARY_OK)
+  {
+    fprintf(stderr, "%s: %s\n", argv[optind], hp2p_binary_error(err));
+    return EXIT_FAILURE;
+  }
+
+  if (matrix != NULL)
+  {
+    if (strcmp(matrix, "bw") == 0)
+    {
+      id = HP2P_BINARY_BANDWIDTH;
+      scale = 1024.0 * 1024.0;
+    }
+    else if (strcmp(matrix, "time") == 0)
+      id = HP2P_BINARY_TIME;
+    else if (strcmp(matrix, "count") == 0)
+      id = HP2P_BINARY_COUNT;
+    if (id == 0 || hp2p_binary_section_data(&bin, id, NULL, NULL) == NULL)
+    {
+      fprintf(stderr, "%s: no matrix %s\n", argv[optind], matrix);
+      hp2p_binary_close(&bin);
+      return EXIT_FAILURE;
+    }
+    for (i = 0; i < bin.header->nproc; i++)
+    {
+      printf("%s", hp2p_binary_hostname(&bin, i));
+      for (j = 0; j < bin.header->nproc; j++)
+	printf("\t%lg", hp2p_binary_get(&bin, id,
+					(uint64_t)i * bin.header->nproc + j) /
+			    scale);
+      printf("\n");
+    }
+  }
+  else if (list)
+  {
+    printf("Section\t\tType\tOffset\tCount\n");
+    for (s = 0; s < bin.header->nb_sections; s++)
+    {
+      sec = &bin.header->sections[s];
+      printf("%-10s\t%u\t%llu\t%llu\n", hp2p_reader_section_name(sec->id),
+	     sec->type, (unsigned long long)sec->offset,
+	     (unsigned long long)sec->count);
+    }
+  }
+  else
+    hp2p_reader_display_summary(&bin);
+
+  hp2p_binary_close(&bin);
+  return EXIT_SUCCESS;
+}
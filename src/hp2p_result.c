@@ -21,11 +21,194 @@
 
 #include "hp2p.h"
 
+/**
+ * \fn     void hp2p_result_stats_init(hp2p_stats *stats)
+ * \brief  Initialize empty partial statistics
+ *
+ * \param  stats
+ **/
+void hp2p_result_stats_init(hp2p_stats *stats)
+{
+  stats->count = 0.0;
+  stats->mean_time = 0.0;
+  stats->m2_time = 0.0;
+  stats->mean_bw = 0.0;
+  stats->m2_bw = 0.0;
+  stats->min_time = 1.0e15;
+  stats->max_time = 0.0;
+  stats->min_bw = 1.0e15;
+  stats->max_bw = 0.0;
+  stats->i_min_time = 0;
+  stats->j_min_time = 0;
+  stats->i_max_time = 0;
+  stats->j_max_time = 0;
+  stats->i_min_bw = 0;
+  stats->j_min_bw = 0;
+  stats->i_max_bw = 0;
+  stats->j_max_bw = 0;
+}
+
+/**
+ * \fn     int hp2p_result_stats_first(int i, int j, int k, int l)
+ * \brief  Tie-break of min/max locations: first in row-major order
+ **/
+int hp2p_result_stats_first(int i, int j, int k, int l)
+{
+  return (i < k) || (i == k && j < l);
+}
+
+/**
+ * \fn     void hp2p_result_stats_merge(hp2p_stats *a, hp2p_stats *b)
+ * \brief  Merge partial statistics a into b
+ *
+ * Moments are combined with the parallel formula of Chan et al., so that
+ * the result does not depend on the order of the reduction.
+ *
+ * \param  a
+ * \param  b (updated)
+ **/
+void hp2p_result_stats_merge(hp2p_stats *a, hp2p_stats *b)
+{
+  double n = 0.0;
+  double delta = 0.0;
+
+  if (a->count == 0.0)
+    return;
+  if (b->count == 0.0)
+  {
+    *b = *a;
+    return;
+  }
+  n = a->count + b->count;
+  delta = a->mean_time - b->mean_time;
+  b->m2_time += a->m2_time + delta * delta * a->count * b->count / n;
+  b->mean_time += delta * a->count / n;
+  delta = a->mean_bw - b->mean_bw;
+  b->m2_bw += a->m2_bw + delta * delta * a->count * b->count / n;
+  b->mean_bw += delta * a->count / n;
+  b->count = n;
+
+  if (a->min_time < b->min_time ||
+      (a->min_time == b->min_time &&
+       hp2p_result_stats_first(a->i_min_time, a->j_min_time, b->i_min_time,
+			       b->j_min_time)))
+  {
+    b->min_time = a->min_time;
+    b->i_min_time = a->i_min_time;
+    b->j_min_time = a->j_min_time;
+  }
+  if (a->max_time > b->max_time ||
+      (a->max_time == b->max_time &&
+       hp2p_result_stats_first(a->i_max_time, a->j_max_time, b->i_max_time,
+			       b->j_max_time)))
+  {
+    b->max_time = a->max_time;
+    b->i_max_time = a->i_max_time;
+    b->j_max_time = a->j_max_time;
+  }
+  if (a->min_bw < b->min_bw ||
+      (a->min_bw == b->min_bw &&
+       hp2p_result_stats_first(a->i_min_bw, a->j_min_bw, b->i_min_bw,
+			       b->j_min_bw)))
+  {
+    b->min_bw = a->min_bw;
+    b->i_min_bw = a->i_min_bw;
+    b->j_min_bw = a->j_min_bw;
+  }
+  if (a->max_bw > b->max_bw ||
+      (a->max_bw == b->max_bw &&
+       hp2p_result_stats_first(a->i_max_bw, a->j_max_bw, b->i_max_bw,
+			       b->j_max_bw)))
+  {
+    b->max_bw = a->max_bw;
+    b->i_max_bw = a->i_max_bw;
+    b->j_max_bw = a->j_max_bw;
+  }
+}
+
+/**
+ * \fn     void hp2p_result_stats_reduce(void *in, void *inout, int *len,
+ *                                       MPI_Datatype *type)
+ * \brief  User-defined MPI_Op merging hp2p_stats
+ **/
+void hp2p_result_stats_reduce(void *in, void *inout, int *len,
+			      MPI_Datatype *type)
+{
+  hp2p_stats *a = (hp2p_stats *)in;
+  hp2p_stats *b = (hp2p_stats *)inout;
+  int i = 0;
+
+  (void)type;
+  for (i = 0; i < *len; i++)
+    hp2p_result_stats_merge(&a[i], &b[i]);
+}
+
+/**
+ * \fn     void hp2p_result_stats_row(hp2p_result *result, hp2p_stats *stats)
+ * \brief  Derive averages and bandwidths of the local row and compute
+ *         its partial statistics in a single pass
+ *
+ * \param  result
+ * \param  stats (output)
+ **/
+void hp2p_result_stats_row(hp2p_result *result, hp2p_stats *stats)
+{
+  int rank = result->mpi_conf->rank;
+  double delta = 0.0;
+  double t = 0.0;
+  double bw = 0.0;
+  int j = 0;
+
+  hp2p_result_stats_init(stats);
+  for (j = 0; j < result->mpi_conf->nproc; j++)
+  {
+    result->l_avg_time[j] = 0.0;
+    result->l_bw[j] = 0.0;
+    if (result->l_time[j] > 0.0)
+    {
+      t = result->l_time[j] / result->l_count[j];
+      bw = result->msg_size / t;
+      result->l_avg_time[j] = t;
+      result->l_bw[j] = bw;
+      stats->count += 1.0;
+      delta = t - stats->mean_time;
+      stats->mean_time += delta / stats->count;
+      stats->m2_time += delta * (t - stats->mean_time);
+      delta = bw - stats->mean_bw;
+      stats->mean_bw += delta / stats->count;
+      stats->m2_bw += delta * (bw - stats->mean_bw);
+      if (t < stats->min_time)
+      {
+	stats->min_time = t;
+	stats->i_min_time = rank;
+	stats->j_min_time = j;
+      }
+      if (t > stats->max_time)
+      {
+	stats->max_time = t;
+	stats->i_max_time = rank;
+	stats->j_max_time = j;
+      }
+      if (bw < stats->min_bw)
+      {
+	stats->min_bw = bw;
+	stats->i_min_bw = rank;
+	stats->j_min_bw = j;
+      }
+      if (bw > stats->max_bw)
+      {
+	stats->max_bw = bw;
+	stats->i_max_bw = rank;
+	stats->j_max_bw = j;
+      }
+    }
+  }
+}
+
 void hp2p_result_alloc(hp2p_result *result, hp2p_mpi_config *mpi_conf,
 		       hp2p_config *conf)
 {
   int i = 0;
-  int j = 0;
   int nproc = 0;
   nproc = mpi_conf->nproc;
   result->mpi_conf = mpi_conf;
@@ -34,171 +217,296 @@ void hp2p_result_alloc(hp2p_result *result, hp2p_mpi_config *mpi_conf,
   result->nb_msg = conf->nb_msg;
   result->l_time = (double *)malloc(nproc * sizeof(double));
   result->l_count = (int *)malloc(nproc * sizeof(int));
-  result->g_count = (int *)malloc(nproc * nproc * sizeof(int));
-  result->g_time = (double *)malloc(nproc * nproc * sizeof(double));
-  result->g_bw = (double *)malloc(nproc * nproc * sizeof(double));
+  result->l_avg_time = (double *)malloc(nproc * sizeof(double));
+  result->l_bw = (double *)malloc(nproc * sizeof(double));
   for (i = 0; i < nproc; i++)
   {
     result->l_time[i] = 0.0;
     result->l_count[i] = 0;
-    for (j = 0; j < nproc; j++)
-      result->g_bw[i * nproc + j] = 0.0;
   }
-  result->l_bsbw = (double *)calloc(conf->nb_shuffle, sizeof(double));
-  result->g_bsbw = (double *)calloc(conf->nb_shuffle, sizeof(double));
+  // Matrices are only needed by the root for the html and bin outputs
+  result->g_count = NULL;
+  result->g_time = NULL;
+  result->g_avg_time = NULL;
+  result->g_bw = NULL;
+  result->gather = hp2p_util_has_format(conf, "html") ||
+		   hp2p_util_has_format(conf, "bin");
+  if (result->gather && mpi_conf->rank == mpi_conf->root)
+  {
+    result->g_count = (int *)calloc((size_t)nproc * nproc, sizeof(int));
+    result->g_time = (double *)calloc((size_t)nproc * nproc, sizeof(double));
+    result->g_avg_time =
+      (double *)calloc((size_t)nproc * nproc, sizeof(double));
+    result->g_bw = (double *)calloc((size_t)nproc * nproc, sizeof(double));
+  }
+  MPI_Type_contiguous(sizeof(hp2p_stats), MPI_BYTE, &result->stats_type);
+  MPI_Type_commit(&result->stats_type);
+  MPI_Op_create(hp2p_result_stats_reduce, 1, &result->stats_op);
+  // Series of iterations grow on demand up to series_size points
+  result->l_bsbw = NULL;
+  result->l_sync = NULL;
+  result->l_wait = NULL;
+  result->pending_size = 0;
+  result->reduced = 0;
+  result->current_iteration = 0;
+  hp2p_series_init(&result->g_bsbw, conf->series_size);
+  hp2p_series_init(&result->monitor_build_couples, conf->series_size);
+  hp2p_series_init(&result->monitor_heavyp2p, conf->series_size);
+  hp2p_series_init(&result->monitor_snapshot, conf->series_size);
+  hp2p_series_init(&result->g_sync, conf->series_size);
+  hp2p_series_init(&result->g_skew, conf->series_size);
 
-  result->monitor_build_couples =
-      (double *)calloc(conf->nb_shuffle, sizeof(double));
-  result->monitor_heavyp2p = (double *)calloc(conf->nb_shuffle, sizeof(double));
-  result->monitor_snapshot = (double *)calloc(conf->nb_shuffle, sizeof(double));
+  // Samples stamped in the global time base (pending, with -G)
+  result->l_start = NULL;
+  result->l_sample = NULL;
+  result->l_other = NULL;
+  result->timeline = NULL;
+  result->nb_timeline = 0;
+  result->timeline_dropped = 0;
+  result->max_cluster = 0;
+  result->avg_time = 0.0;
+  hp2p_anomaly_alloc(result);
+  hp2p_converge_alloc(result);
+  hp2p_robust_alloc(result);
+  hp2p_datatype_alloc(result);
+  hp2p_verify_alloc(result);
+  hp2p_sweep_alloc(result);
+  hp2p_metrics_alloc(result);
 }
 
 void hp2p_result_free(hp2p_result *result)
 {
   free(result->l_count);
   free(result->l_time);
+  free(result->l_avg_time);
+  free(result->l_bw);
   free(result->g_count);
   free(result->g_time);
+  free(result->g_avg_time);
   free(result->g_bw);
+  MPI_Type_free(&result->stats_type);
+  MPI_Op_free(&result->stats_op);
   free(result->l_bsbw);
-  free(result->g_bsbw);
-  free(result->monitor_build_couples);
-  free(result->monitor_heavyp2p);
-  free(result->monitor_snapshot);
+  free(result->l_sync);
+  free(result->l_wait);
+  hp2p_series_free(&result->g_bsbw);
+  hp2p_series_free(&result->monitor_build_couples);
+  hp2p_series_free(&result->monitor_heavyp2p);
+  hp2p_series_free(&result->monitor_snapshot);
+  hp2p_series_free(&result->g_sync);
+  hp2p_series_free(&result->g_skew);
+  free(result->l_start);
+  free(result->l_sample);
+  free(result->l_other);
+  free(result->timeline);
+  hp2p_anomaly_free(result);
+  hp2p_converge_free(result);
+  hp2p_robust_free(result);
+  hp2p_datatype_free(result);
+  hp2p_verify_free(result);
+  hp2p_sweep_free(result);
+  hp2p_metrics_free(result);
+  hp2p_result_free_html_assets();
 }
 
-void hp2p_result_update(hp2p_result *result)
+/**
+ * \fn     int hp2p_result_pending(hp2p_result *result)
+ * \brief  Slot of the current iteration in the buffers not reduced yet
+ *
+ * Buffers hold the iterations since the last hp2p_result_update and grow
+ * on demand, so their size is bounded by the snapshot frequency.
+ *
+ * \param  result
+ * \return index of current_iteration in l_bsbw, l_sync and l_wait (and
+ *         l_start, l_sample and l_other with -G)
+ **/
+int hp2p_result_pending(hp2p_result *result)
+{
+  int k = result->current_iteration - result->reduced - 1;
+  int size = result->pending_size;
+
+  if (k >= size)
+  {
+    size = (size == 0) ? 64 : size;
+    while (size <= k)
+      size *= 2;
+    result->l_bsbw = (double *)realloc(result->l_bsbw, size * sizeof(double));
+    result->l_sync = (double *)realloc(result->l_sync, size * sizeof(double));
+    result->l_wait = (double *)realloc(result->l_wait, size * sizeof(double));
+    if (result->conf->clock_freq > 0)
+    {
+      result->l_start =
+	  (double *)realloc(result->l_start, size * sizeof(double));
+      result->l_sample =
+	  (double *)realloc(result->l_sample, size * sizeof(double));
+      result->l_other = (int *)realloc(result->l_other, size * sizeof(int));
+    }
+    result->pending_size = size;
+  }
+  result->l_bsbw[k] = 0.0;
+  result->l_sync[k] = 0.0;
+  result->l_wait[k] = 0.0;
+  if (result->l_start != NULL)
+  {
+    result->l_start[k] = 0.0;
+    result->l_sample[k] = 0.0;
+    result->l_other[k] = -1;
+  }
+  return k;
+}
+
+/**
+ * \fn     void hp2p_result_update_sync(hp2p_result *result, int n)
+ * \brief  Reduce synchronization cost and start skew of new iterations
+ *
+ * The skew of an iteration is the spread (max - min) of the start times
+ * of the timed windows in the global time base if it is available, else
+ * of the time each rank waited before its timed window. Idle ranks are
+ * excluded. Max and -min are reduced together with a single MPI_MAX.
+ *
+ * \param  result
+ * \param  n number of iterations since the last reduction
+ **/
+void hp2p_result_update_sync(hp2p_result *result, int n)
 {
-  int nproc = 0;
-  int count = 0;
-  int msg_size = 0;
-  int nb_msg = 0;
   int i = 0;
-  int j = 0;
+  double *sync = NULL;
+  double *wait = NULL;
+  double *stamp = NULL;
 
-  nproc = result->mpi_conf->nproc;
-  msg_size = result->msg_size;
-  nb_msg = result->nb_msg;
-
-  MPI_Allgather(result->l_time, nproc, MPI_DOUBLE, result->g_time, nproc,
-		MPI_DOUBLE, result->mpi_conf->comm);
-  MPI_Allgather(result->l_count, nproc, MPI_INT, result->g_count, nproc,
-		MPI_INT, result->mpi_conf->comm);
-
-  MPI_Allreduce(result->l_bsbw, result->g_bsbw, result->current_iteration,
-		MPI_DOUBLE, MPI_SUM, result->mpi_conf->comm);
-
-  result->sum_time = 0.0;
-  result->min_time = 1.0e15;
-  result->max_time = 0.0;
-  result->sum_bw = 0.0;
-  result->min_bw = 1.0e15;
-  result->max_bw = 0.0;
-  result->i_min_time = 0;
-  result->j_min_time = 0;
-  result->i_min_bw = 0;
-  result->j_min_bw = 0;
-  result->i_max_time = 0;
-  result->j_max_time = 0;
-  result->i_max_bw = 0;
-  result->j_max_bw = 0;
+  stamp = result->l_wait;
+  if (result->l_start != NULL)
+    stamp = result->l_start;
+  sync = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+  MPI_Allreduce(result->l_sync, sync, n, MPI_DOUBLE, MPI_SUM,
+		result->mpi_conf->comm);
 
-  for (i = 0; i < nproc; i++)
-    for (j = 0; j < nproc; j++)
+  wait = (double *)malloc((n > 0 ? 2 * n : 1) * sizeof(double));
+  for (i = 0; i < n; i++)
+  {
+    if (result->l_wait[i] < 0.0)
     {
-      if (result->g_time[i * nproc + j] > 0.0)
-      {
-	result->g_time[i * nproc + j] =
-	    result->g_time[i * nproc + j] / result->g_count[i * nproc + j];
-	// bw
-	result->g_bw[i * nproc + j] = msg_size / result->g_time[i * nproc + j];
-	// sum
-	result->sum_time += result->g_time[i * nproc + j];
-	result->sum_bw += result->g_bw[i * nproc + j];
-	count++;
-	// min
-	if (result->g_time[i * nproc + j] < result->min_time)
-	{
-	  result->min_time = result->g_time[i * nproc + j];
-	  result->i_min_time = i;
-	  result->j_min_time = j;
-	}
-	if (result->g_bw[i * nproc + j] < result->min_bw)
-	{
-	  result->min_bw = result->g_bw[i * nproc + j];
-	  result->i_min_bw = i;
-	  result->j_min_bw = j;
-	}
-	// max
-	if (result->g_time[i * nproc + j] > result->max_time)
-	{
-	  result->max_time = result->g_time[i * nproc + j];
-	  result->i_max_time = i;
-	  result->j_max_time = j;
-	}
-	if (result->g_bw[i * nproc + j] > result->max_bw)
-	{
-	  result->max_bw = result->g_bw[i * nproc + j];
-	  result->i_max_bw = i;
-	  result->j_max_bw = j;
-	}
-      }
+      wait[2 * i] = -1.0e15;
+      wait[2 * i + 1] = -1.0e15;
     }
-  result->avg_time = result->sum_time / (double)count;
-  result->avg_bw = result->sum_bw / (double)count;
-  result->count_time = count;
-
-  // standard deviation
-  result->stdd_bw = 0.0;
-  result->stdd_time = 0.0;
-  for (i = 0; i < nproc; i++)
-    for (j = 0; j < nproc; j++)
+    else
     {
-      if (result->g_time[i * nproc + j] > 0.0)
-      {
-	result->stdd_time +=
-	    (result->g_time[i * nproc + j] - result->avg_time) *
-	    (result->g_time[i * nproc + j] - result->avg_time);
-	result->stdd_bw += (result->g_bw[i * nproc + j] - result->avg_bw) *
-			   (result->g_bw[i * nproc + j] - result->avg_bw);
-      }
+      wait[2 * i] = stamp[i];
+      wait[2 * i + 1] = -stamp[i];
     }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, wait, 2 * n, MPI_DOUBLE, MPI_MAX,
+		result->mpi_conf->comm);
+
+  for (i = 0; i < n; i++)
+  {
+    hp2p_series_push(&result->g_sync, sync[i] / result->mpi_conf->nproc);
+    if (wait[2 * i] > -1.0e15)
+      hp2p_series_push(&result->g_skew, wait[2 * i] + wait[2 * i + 1]);
+    else
+      hp2p_series_push(&result->g_skew, 0.0);
+  }
+  result->avg_sync = result->g_sync.avg;
+  result->max_sync = (result->g_sync.n > 0) ? result->g_sync.hi : 0.0;
+  result->avg_skew = result->g_skew.avg;
+  result->max_skew = (result->g_skew.n > 0) ? result->g_skew.hi : 0.0;
+  free(sync);
+  free(wait);
+}
+
+/**
+ * \fn     void hp2p_result_update(hp2p_result *result)
+ * \brief  Compute statistics of the run and gather matrices on the root
+ *
+ * Each rank computes the partial statistics of its own row (O(nproc)),
+ * which are combined with a user-defined reduction. Raw accumulated times
+ * (g_time), counts, averages (g_avg_time) and bandwidths are only gathered
+ * on the root, which writes the outputs, when an output format needs the
+ * matrices. Only the iterations since the previous call are reduced and
+ * appended to the series of iterations.
+ * This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_result_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_stats stats;
+  double *bsbw = NULL;
+  int nproc = 0;
+  int n = 0;
+  int i = 0;
+
+  nproc = mpi_conf->nproc;
+
+  hp2p_result_stats_row(result, &stats);
+  MPI_Allreduce(MPI_IN_PLACE, &stats, 1, result->stats_type, result->stats_op,
+		mpi_conf->comm);
 
-  if (nproc < 2)
+  if (result->gather)
+  {
+    MPI_Gather(result->l_time, nproc, MPI_DOUBLE, result->g_time, nproc,
+	       MPI_DOUBLE, mpi_conf->root, mpi_conf->comm);
+    MPI_Gather(result->l_count, nproc, MPI_INT, result->g_count, nproc,
+	       MPI_INT, mpi_conf->root, mpi_conf->comm);
+    MPI_Gather(result->l_avg_time, nproc, MPI_DOUBLE, result->g_avg_time,
+	       nproc, MPI_DOUBLE, mpi_conf->root, mpi_conf->comm);
+    MPI_Gather(result->l_bw, nproc, MPI_DOUBLE, result->g_bw, nproc,
+	       MPI_DOUBLE, mpi_conf->root, mpi_conf->comm);
+  }
+
+  n = result->current_iteration - result->reduced;
+  bsbw = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+  MPI_Allreduce(result->l_bsbw, bsbw, n, MPI_DOUBLE, MPI_SUM, mpi_conf->comm);
+  for (i = 0; i < n; i++)
+    hp2p_series_push(&result->g_bsbw, bsbw[i] / 2.0);
+  free(bsbw);
+
+  result->count_time = (int)stats.count;
+  result->sum_time = stats.mean_time * stats.count;
+  result->avg_time = stats.mean_time;
+  result->min_time = stats.min_time;
+  result->i_min_time = stats.i_min_time;
+  result->j_min_time = stats.j_min_time;
+  result->max_time = stats.max_time;
+  result->i_max_time = stats.i_max_time;
+  result->j_max_time = stats.j_max_time;
+  result->sum_bw = stats.mean_bw * stats.count;
+  result->avg_bw = stats.mean_bw;
+  result->min_bw = stats.min_bw;
+  result->i_min_bw = stats.i_min_bw;
+  result->j_min_bw = stats.j_min_bw;
+  result->max_bw = stats.max_bw;
+  result->i_max_bw = stats.i_max_bw;
+  result->j_max_bw = stats.j_max_bw;
+
+  // standard deviation
+  if (nproc < 2 || stats.count == 0.0)
   {
     result->stdd_bw = 0.0;
+    result->stdd_time = 0.0;
   }
   else
   {
-    result->stdd_bw = sqrt(result->stdd_bw / ((double)count));
-    result->stdd_time = sqrt(result->stdd_time / ((double)count));
+    result->stdd_bw = sqrt(stats.m2_bw / stats.count);
+    result->stdd_time = sqrt(stats.m2_time / stats.count);
   }
 
   // Bisection bandwidth
-  result->sum_bsbw = 0.0;
-  result->min_bsbw = 1.0e15;
-  result->max_bsbw = 0.0;
-  result->stdd_bsbw = 0.0;
-
-  for (i = 0; i < result->current_iteration; i++)
-  {
-    result->g_bsbw[i] = result->g_bsbw[i] / 2.0;
-    result->sum_bsbw += result->g_bsbw[i];
-    if (result->g_bsbw[i] > result->max_bsbw)
-      result->max_bsbw = result->g_bsbw[i];
-    if (result->g_bsbw[i] < result->min_bsbw)
-      result->min_bsbw = result->g_bsbw[i];
-  }
-  result->avg_bsbw = result->sum_bsbw / (result->current_iteration);
-  for (i = 0; i < result->current_iteration; i++)
-    result->stdd_bsbw += (result->g_bsbw[i] - result->avg_bsbw) *
-			 (result->g_bsbw[i] - result->avg_bsbw);
-
-  if (result->current_iteration < 1)
-    result->stdd_bsbw = 0.0;
-  else
-    result->stdd_bsbw =
-	sqrt(result->stdd_bsbw / ((double)result->current_iteration + 1));
+  result->sum_bsbw = result->g_bsbw.avg * result->g_bsbw.n;
+  result->avg_bsbw = result->g_bsbw.avg;
+  result->min_bsbw = (result->g_bsbw.n > 0) ? result->g_bsbw.lo : 1.0e15;
+  result->max_bsbw = (result->g_bsbw.n > 0) ? result->g_bsbw.hi : 0.0;
+  result->stdd_bsbw = hp2p_series_stdd(&result->g_bsbw);
+
+  hp2p_result_update_sync(result, n);
+  hp2p_timeline_update(result);
+  result->reduced = result->current_iteration;
+  hp2p_anomaly_gather(result);
+  hp2p_robust_update(result);
+  hp2p_verify_update(result);
+  hp2p_sweep_update(result);
+  hp2p_datatype_update(result);
 }
 
 void hp2p_result_display(hp2p_result *result)
@@ -231,9 +539,122 @@ void hp2p_result_display(hp2p_result *result)
   printf(" Avg bisection efficiency : %0.2lf %%\n",
 	 100.0 * result->avg_bsbw / (ncouples * result->avg_bw));
   printf("\n");
+  printf(" Buffer source            : %s\n",
+	 hp2p_buffer_source_name[result->conf->buffer_source]);
+  printf("\n");
+  printf(" Synchronization mode     : %s\n",
+	 result->conf->sync_mode == HP2P_SYNC_PAIR ? "pairwise" : "barrier");
+  printf(" Avg synchronization time : %0.2lf us\n", result->avg_sync * 1.e6);
+  printf(" Max synchronization time : %0.2lf us\n", result->max_sync * 1.e6);
+  printf(" Avg start skew           : %0.2lf us\n", result->avg_skew * 1.e6);
+  printf(" Max start skew           : %0.2lf us\n", result->max_skew * 1.e6);
+  printf("\n");
+  if (result->conf->clock_freq > 0)
+  {
+    printf(" Clock offset estimations : %d\n", result->mpi_conf->clock.nb_sync);
+    printf(" Slow communications      : %d\n",
+	   result->nb_timeline + result->timeline_dropped);
+    if (result->timeline_dropped > 0)
+      printf(" Not kept in the timeline : %d\n", result->timeline_dropped);
+    printf(" Max simultaneous slow    : %d\n", result->max_cluster);
+    printf("\n");
+  }
+  printf(" Anomalies                : %d\n", result->nb_anomaly);
+  if (hp2p_anomaly_logged(result->conf))
+    printf(" Anomalies not logged     : %d\n", result->nb_dropped_anomaly);
+  printf("\n");
+  if (result->conf->converge_width > 0.0)
+  {
+    printf(" Converged %s pairs     : %lld / %lld (%0.2lf %%)\n",
+	   result->conf->converge_level == HP2P_CONVERGE_NODE ? "node" : "rank",
+	   result->converged, result->converge_total,
+	   result->converge_total > 0
+	       ? 100.0 * result->converged / result->converge_total
+	       : 0.0);
+    printf(" Confidence interval      : %0.1lf %%, +/- %0.2lf %% of the mean\n",
+	   100.0 * result->conf->converge_confidence,
+	   100.0 * result->conf->converge_width);
+    if (result->converge_achieved > 0.0)
+      printf(" Half-width of %0.0lf %% pairs : <= %0.2lf %% of the mean\n",
+	     100.0 * result->conf->converge_fraction,
+	     100.0 * result->converge_achieved);
+    else
+      printf(" Half-width of %0.0lf %% pairs : not enough samples\n",
+	     100.0 * result->conf->converge_fraction);
+    printf("\n");
+  }
+  if (result->conf->robust_samples > 0)
+  {
+    printf(" Avg bandwidth (raw)      : %0.2lf MB/s\n", result->avg_bw / m);
+    printf(" Avg bandwidth (trimmed)  : %0.2lf MB/s\n",
+	   result->avg_bw_trim / m);
+    printf(" Avg bandwidth (MoM)      : %0.2lf MB/s\n", result->avg_bw_mom / m);
+    printf(" Avg bandwidth (best)     : %0.2lf MB/s\n",
+	   result->avg_bw_best / m);
+    printf(" Noisy pairs              : %d\n", result->noisy_pairs);
+    printf(" Slow pairs               : %d\n", result->slow_pairs);
+    printf("\n");
+  }
+  if (result->conf->nb_offsets > 0)
+    hp2p_result_display_sweep(result);
+  if (result->conf->datatype != HP2P_TYPE_CONTIGUOUS)
+  {
+    printf(" Datatype                 : %s\n",
+	   hp2p_datatype_name[result->conf->datatype]);
+    printf(" Avg datatype bandwidth   : %0.2lf MB/s\n",
+	   result->avg_type_bw / m);
+    printf(" Avg datatype/contiguous  : %0.2lf %%\n",
+	   100.0 * result->avg_type_ratio);
+    printf(" Min datatype/contiguous  : %0.2lf %% between %d and %d\n",
+	   100.0 * result->min_type_ratio, result->i_min_type,
+	   result->j_min_type);
+    printf("\n");
+  }
+  if (result->conf->verify)
+  {
+    printf(" Corrupted exchanges      : %lld\n", result->nb_corrupt);
+    printf(" Corrupted pairs          : %d\n", result->corrupt_pairs);
+    printf(" Corrupted words          : %lld\n", result->corrupt_words);
+    printf(" Avg verification time    : %0.2lf s\n", result->avg_verify_time);
+    printf(" Max verification time    : %0.2lf s\n", result->max_verify_time);
+    printf(" Verification overhead    : %0.2lf %%\n",
+	   100.0 * result->verify_overhead);
+    printf("\n");
+  }
   printf(" ===============\n\n");
 }
 
+/**
+ * \fn     void hp2p_result_display_sweep(hp2p_result *result)
+ * \brief  Display the bandwidth and the latency of each offset of the sweep
+ *         and the bandwidth relatively to the fastest offset
+ *
+ * \param  result
+ **/
+void hp2p_result_display_sweep(hp2p_result *result)
+{
+  double m = 1048576.0;
+  double fastest = 0.0;
+  char label[64];
+  int k = 0;
+
+  for (k = 0; k < result->conf->nb_offsets; k++)
+    if (hp2p_sweep_stat(result, k, HP2P_SWEEP_BW) > fastest)
+      fastest = hp2p_sweep_stat(result, k, HP2P_SWEEP_BW);
+  for (k = 0; k < result->conf->nb_offsets; k++)
+  {
+    sprintf(label, "Offset %d", result->conf->offsets[k]);
+    printf(" %-24s : %0.2lf MB/s, %0.2lf us (best %0.2lf us), %0.1lf %%\n",
+	   label, hp2p_sweep_stat(result, k, HP2P_SWEEP_BW) / m,
+	   hp2p_sweep_stat(result, k, HP2P_SWEEP_TIME) * 1.e6,
+	   hp2p_sweep_stat(result, k, HP2P_SWEEP_BEST) * 1.e6,
+	   fastest > 0.0
+	       ? 100.0 * hp2p_sweep_stat(result, k, HP2P_SWEEP_BW) / fastest
+	       : 0.0);
+  }
+  printf("\n");
+}
+
 void hp2p_result_display_time(hp2p_result *result)
 {
   int i = 0;
@@ -243,7 +664,7 @@ void hp2p_result_display_time(hp2p_result *result)
   for (i = 0; i < nproc; i++)
   {
     for (j = 0; j < nproc; j++)
-      printf("%lf\t", result->g_time[i * nproc + j]);
+      printf("%lf\t", result->g_avg_time[i * nproc + j]);
     printf("\n");
   }
 }
@@ -273,145 +694,498 @@ void hp2p_result_write_html_get_time(char *date, char *hour)
   sprintf(hour, "%d:%d:%d", ltm->tm_hour, ltm->tm_min, ltm->tm_sec);
 }
 
+void hp2p_result_write_binary_data(FILE *fp, hp2p_binary_header *header,
+				   const void *data, size_t size)
+{
+  fwrite(data, sizeof(char), size, fp);
+  header->checksum = hp2p_binary_checksum(header->checksum, data, size);
+  header->file_size += size;
+}
+
+/**
+ * \fn     void hp2p_result_write_binary_section(FILE *fp,
+ *                                               hp2p_binary_header *header,
+ *                                               uint32_t id, uint32_t type,
+ *                                               uint64_t count)
+ * \brief  Start a section at the next aligned offset
+ *
+ * \param  fp
+ * \param  header (file_size is the current offset)
+ * \param  id    HP2P_BINARY_<section>
+ * \param  type  HP2P_BINARY_<type>
+ * \param  count number of elements
+ **/
+void hp2p_result_write_binary_section(FILE *fp, hp2p_binary_header *header,
+				      uint32_t id, uint32_t type,
+				      uint64_t count)
+{
+  char pad[HP2P_BINARY_ALIGN];
+  hp2p_binary_section *sec = NULL;
+  size_t n = 0;
+
+  memset(pad, 0, HP2P_BINARY_ALIGN);
+  n = (HP2P_BINARY_ALIGN - header->file_size % HP2P_BINARY_ALIGN) %
+      HP2P_BINARY_ALIGN;
+  hp2p_result_write_binary_data(fp, header, pad, n);
+  sec = &header->sections[header->nb_sections++];
+  sec->id = id;
+  sec->type = type;
+  sec->offset = header->file_size;
+  sec->count = count;
+}
+
+/**
+ * \fn     void hp2p_result_write_binary_matrix(FILE *fp,
+ *                                              hp2p_binary_header *header,
+ *                                              uint32_t id, double *values,
+ *                                              uint64_t count, int precision)
+ * \brief  Write a section of doubles, converted to float if precision is 32
+ **/
+void hp2p_result_write_binary_matrix(FILE *fp, hp2p_binary_header *header,
+				     uint32_t id, double *values,
+				     uint64_t count, int precision)
+{
+  float buf[4096];
+  uint64_t i = 0;
+  uint64_t k = 0;
+  uint64_t nb = 0;
+
+  if (precision != 32)
+  {
+    hp2p_result_write_binary_section(fp, header, id, HP2P_BINARY_FLOAT64,
+				     count);
+    hp2p_result_write_binary_data(fp, header, values, count * sizeof(double));
+    return;
+  }
+  hp2p_result_write_binary_section(fp, header, id, HP2P_BINARY_FLOAT32,
+				   count);
+  for (i = 0; i < count; i += nb)
+  {
+    nb = (count - i < 4096) ? count - i : 4096;
+    for (k = 0; k < nb; k++)
+      buf[k] = (float)values[i + k];
+    hp2p_result_write_binary_data(fp, header, buf, nb * sizeof(float));
+  }
+}
+
+int hp2p_result_compare_hosts(const void *a, const void *b)
+{
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+/**
+ * \fn     void hp2p_result_write_binary_hosts(FILE *fp,
+ *                                             hp2p_binary_header *header,
+ *                                             hp2p_result result)
+ * \brief  Write the string table of the distinct hostnames and the offset
+ *         of the hostname of each rank in this table
+ **/
+void hp2p_result_write_binary_hosts(FILE *fp, hp2p_binary_header *header,
+				    hp2p_result result)
+{
+  char **hosts = hp2p_mpi_get_hosts(result.mpi_conf);
+  int nproc = result.mpi_conf->nproc;
+  const char **names = NULL;
+  const char **found = NULL;
+  const char *name = NULL;
+  int32_t *offsets = NULL;
+  int32_t size = 0;
+  int i = 0;
+  int k = 0;
+
+  // Sort the hostnames to find the distinct ones
+  names = (const char **)malloc(nproc * sizeof(char *));
+  offsets = (int32_t *)malloc(nproc * sizeof(int32_t));
+  for (i = 0; i < nproc; i++)
+    names[i] = hosts[i];
+  qsort(names, nproc, sizeof(char *), hp2p_result_compare_hosts);
+  for (i = 0, size = 0; i < nproc; i++)
+    if (i == 0 || strcmp(names[i], names[i - 1]) != 0)
+      size += strlen(names[i]) + 1;
+
+  hp2p_result_write_binary_section(fp, header, HP2P_BINARY_HOSTNAMES,
+				   HP2P_BINARY_CHAR, size);
+  for (i = 0, size = 0; i < nproc; i++)
+    if (i == 0 || strcmp(names[i], names[i - 1]) != 0)
+    {
+      hp2p_result_write_binary_data(fp, header, names[i],
+				    strlen(names[i]) + 1);
+      offsets[i] = size; // offsets follow the sorted names
+      size += strlen(names[i]) + 1;
+    }
+    else
+      offsets[i] = offsets[i - 1];
+
+  // Offset of each rank: binary search in the sorted names
+  hp2p_result_write_binary_section(fp, header, HP2P_BINARY_HOSTS,
+				   HP2P_BINARY_INT32, nproc);
+  for (i = 0; i < nproc; i++)
+  {
+    name = hosts[i];
+    found = (const char **)bsearch(&name, names, nproc, sizeof(char *),
+				   hp2p_result_compare_hosts);
+    k = found - names;
+    hp2p_result_write_binary_data(fp, header, &offsets[k], sizeof(int32_t));
+  }
+  free(hosts);
+  free(names);
+  free(offsets);
+}
+
+/**
+ * \fn     void hp2p_result_write_binary(hp2p_result result)
+ * \brief  Write <outname>.bin in the binary format version 3
+ *
+ * See hp2p_binary.h for the layout. The header is written last, once the
+ * offsets of the sections and the checksum are known.
+ *
+ * \param  result
+ **/
 void hp2p_result_write_binary(hp2p_result result)
 {
   FILE *fp = NULL;
   char *filename = NULL;
-  char date[1024];
-  char hour[1024];
-  int i = 0;
-  int j = 0;
+  hp2p_binary_header header;
+  hp2p_config *conf = result.conf;
   int nproc = 0;
-  char ch = '\0';
-  int pos = 0;
 
   nproc = result.mpi_conf->nproc;
-  hp2p_result_write_html_get_time(date, hour);
-  filename = (char *)malloc((strlen(result.conf->outname) + 16) * sizeof(char));
-  strcpy(filename, result.conf->outname);
+  filename = (char *)malloc((strlen(conf->outname) + 16) * sizeof(char));
+  strcpy(filename, conf->outname);
   strcat(filename, ".bin");
-  fp = fopen(filename, "wb");
-  /* file format is :
-   *  nb rank
-   *  hostlist[nbrank]
-   *  result[nbrank*nbrank]
-   */
+  fp = hp2p_writer_open(filename, "wb");
   if (fp != NULL)
   {
-    nproc = result.mpi_conf->nproc;
-    fwrite(&nproc, sizeof(int), 1, fp);
-    fwrite(result.mpi_conf->hostlist, sizeof(char),
-	   nproc * MPI_MAX_PROCESSOR_NAME, fp);
-    fwrite(result.g_bw, sizeof(double), nproc * nproc, fp);
-    fwrite(result.g_time, sizeof(double), nproc * nproc, fp);
-    fwrite(result.g_count, sizeof(int), nproc * nproc, fp);
-    fclose(fp);
+    memset(&header, 0, sizeof(hp2p_binary_header));
+    memcpy(header.magic, HP2P_BINARY_MAGIC, sizeof(HP2P_BINARY_MAGIC));
+    header.version = HP2P_BINARY_VERSION;
+    header.endian = HP2P_BINARY_ENDIAN;
+    header.header_size = sizeof(hp2p_binary_header);
+    header.nproc = nproc;
+    header.nb_shuffle = conf->nb_shuffle;
+    header.nb_iterations = result.current_iteration;
+    header.snap_freq = conf->snap_freq;
+    header.msg_size = conf->msg_size;
+    header.nb_msg = conf->nb_msg;
+    header.align_size = conf->align_size;
+    header.build = conf->build;
+    header.seed = conf->seed;
+    header.sync_mode = conf->sync_mode;
+    header.start_time = conf->__start_time;
+    header.write_time = hp2p_util_get_time();
+
+    // Placeholder, the checksum only covers the sections
+    fwrite(&header, sizeof(hp2p_binary_header), 1, fp);
+    header.file_size = sizeof(hp2p_binary_header);
+    header.checksum = HP2P_BINARY_CHECKSUM_INIT;
+
+    hp2p_result_write_binary_hosts(fp, &header, result);
+    hp2p_result_write_binary_matrix(fp, &header, HP2P_BINARY_BANDWIDTH,
+				    result.g_bw, (uint64_t)nproc * nproc,
+				    conf->binary_precision);
+    hp2p_result_write_binary_matrix(fp, &header, HP2P_BINARY_TIME,
+				    result.g_avg_time, (uint64_t)nproc * nproc,
+				    conf->binary_precision);
+    hp2p_result_write_binary_section(fp, &header, HP2P_BINARY_COUNT,
+				     HP2P_BINARY_INT32,
+				     (uint64_t)nproc * nproc);
+    hp2p_result_write_binary_data(fp, &header, result.g_count,
+				  (size_t)nproc * nproc * sizeof(int32_t));
+    hp2p_result_write_binary_section(fp, &header, HP2P_BINARY_BISECTION,
+				     HP2P_BINARY_FLOAT64, result.g_bsbw.count);
+    hp2p_result_write_binary_data(fp, &header, result.g_bsbw.mean,
+				  result.g_bsbw.count * sizeof(double));
+
+    fseek(fp, 0L, SEEK_SET);
+    fwrite(&header, sizeof(hp2p_binary_header), 1, fp);
+    hp2p_writer_close(fp);
   }
   free(filename);
-  hp2p_result_display_bw(&result);
 }
 
-void hp2p_result_write_html_css(FILE *fp)
+const char hp2p_result_html_css[] =
+    "  <style>\n"
+    "\n"
+    "    body {\n"
+    "        margin:0;\n"
+    "    }\n"
+    "\n"
+    "    .banner {\n"
+    "      overflow: hidden;\n"
+    "      background-color: #114073;\n"
+    "      margin: 0;\n"
+    "      height: 75px;\n"
+    "      margin-left: 0px;\n"
+    "      margin-right: 0px;\n"
+    "      width: 100%;\n"
+    "    }\n"
+    "    .banner > h2 {\n"
+    "      float: left;\n"
+    "      color: white;\n"
+    "      padding: 2px;\n"
+    "      font-size: 25px;\n"
+    "      margin-left: 8%;\n"
+    "      font-family: 'Open Sans', sans-serif;\n"
+    "    }\n"
+    "\n"
+    "    .stats-container {\n"
+    "      padding: 0;\n"
+    "      margin: 0;\n"
+    "      display: flex;\n"
+    "      flex-wrap: wrap;\n"
+    "      align-items: baseline;\n"
+    "      justify-content: center;\n"
+    "    }\n"
+    "     .stats-container > div {\n"
+    "      margin: 4px;\n"
+    "      padding: 2px;\n"
+    "      background-color: white;\n"
+    "      width: 800px;\n"
+    "      text-align: center;\n"
+    "      line-height: 20px;\n"
+    "      font-size: 15px;\n"
+    "      font-family: 'Open Sans', sans-serif;\n"
+    "    }\n"
+    "    .flex-container {\n"
+    "      padding: 0;\n"
+    "      margin: 0;\n"
+    "      display: flex;\n"
+    "      flex-wrap: wrap;\n"
+    "      align-items: baseline;\n"
+    "      justify-content: center;\n"
+    "    }\n"
+    "    .flex-container > div {\n"
+    "      margin: 2px;\n"
+    "      padding: 2px;\n"
+    "    }\n"
+    "</style>\n";
+
+// Pre-rendered head of the HTML pages (CSS and scripts), built once
+char *html_assets = NULL;
+size_t html_assets_size = 0;
+char html_assets_plotlyjs[MAXCHARFILE] = "";
+
+void hp2p_result_write_html_plotlyjs(FILE *fp, hp2p_result result)
 {
-  if (fp != NULL)
+  char *js = NULL;
+  size_t size = 0;
+
+  fprintf(fp, "<script type=\"text/javascript\">window.PlotlyConfig = "
+	      "{MathJaxConfig: 'local'};</script>\n");
+  if (strlen(result.conf->plotlyjs) > 0)
+    js = hp2p_writer_read_file(result.conf->plotlyjs, &size);
+  if (js != NULL)
   {
-    fprintf(fp, "  <style>\n");
-    fprintf(fp, "\n");
-    fprintf(fp, "    body {\n");
-    fprintf(fp, "        margin:0;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "\n");
-    fprintf(fp, "    .banner {\n");
-    fprintf(fp, "      overflow: hidden;\n");
-    fprintf(fp, "      background-color: #114073;\n");
-    fprintf(fp, "      margin: 0;\n");
-    fprintf(fp, "      height: 75px;\n");
-    fprintf(fp, "      margin-left: 0px;\n");
-    fprintf(fp, "      margin-right: 0px;\n");
-    fprintf(fp, "      width: 100%%;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "    .banner > h2 {\n");
-    fprintf(fp, "      float: left;\n");
-    fprintf(fp, "      color: white;\n");
-    fprintf(fp, "      padding: 2px;\n");
-    fprintf(fp, "      font-size: 25px;\n");
-    fprintf(fp, "      margin-left: 8%%;\n");
-    fprintf(fp, "      font-family: 'Open Sans', sans-serif;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "\n");
-    fprintf(fp, "    .stats-container {\n");
-    fprintf(fp, "      padding: 0;\n");
-    fprintf(fp, "      margin: 0;\n");
-    fprintf(fp, "      display: flex;\n");
-    fprintf(fp, "      flex-wrap: wrap;\n");
-    fprintf(fp, "      align-items: baseline;\n");
-    fprintf(fp, "      justify-content: center;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "     .stats-container > div {\n");
-    fprintf(fp, "      margin: 4px;\n");
-    fprintf(fp, "      padding: 2px;\n");
-    fprintf(fp, "      background-color: white;\n");
-    fprintf(fp, "      width: 800px;\n");
-    fprintf(fp, "      text-align: center;\n");
-    fprintf(fp, "      line-height: 20px;\n");
-    fprintf(fp, "      font-size: 15px;\n");
-    fprintf(fp, "      font-family: 'Open Sans', sans-serif;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "    .flex-container {\n");
-    fprintf(fp, "      padding: 0;\n");
-    fprintf(fp, "      margin: 0;\n");
-    fprintf(fp, "      display: flex;\n");
-    fprintf(fp, "      flex-wrap: wrap;\n");
-    fprintf(fp, "      align-items: baseline;\n");
-    fprintf(fp, "      justify-content: center;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "    .flex-container > div {\n");
-    fprintf(fp, "      margin: 2px;\n");
-    fprintf(fp, "      padding: 2px;\n");
-    fprintf(fp, "    }\n");
-    fprintf(fp, "</style>\n");
+    fprintf(fp, "<script type=\"text/javascript\">\n");
+    fwrite(js, sizeof(char), size, fp);
+    fprintf(fp, "\n</script>\n");
+    free(js);
   }
+  else
+    fprintf(fp,
+	    "<script "
+	    "src=\"https://cdn.plot.ly/plotly-%s.min.js\"></script>\n",
+	    PLOTLY_VERSION);
 }
 
-void hp2p_result_write_html_plotlyjs(FILE *fp, hp2p_result result)
+/**
+ * \fn     void hp2p_result_write_html_decoder(FILE *fp)
+ * \brief  Write the JavaScript functions decoding base64 arrays
+ *
+ * hp2p_decode returns a Float32Array or a Float64Array from a base64
+ * string of little-endian values, hp2p_rows splits a flat matrix into
+ * rows without copy.
+ *
+ * \param  fp
+ **/
+void hp2p_result_write_html_decoder(FILE *fp)
 {
-  FILE *fplotly = NULL;
-  char ch = '\0';
-  int pos = 0;
+  fprintf(fp, "<script type=\"text/javascript\">\n");
+  fprintf(fp, "function hp2p_decode(type, data) {\n");
+  fprintf(fp, "  var bin = atob(data);\n");
+  fprintf(fp, "  var size = (type == \"f32\") ? 4 : 8;\n");
+  fprintf(fp, "  var bytes = new Uint8Array(bin.length);\n");
+  fprintf(fp, "  for (var i = 0; i < bin.length; i++)\n");
+  fprintf(fp, "    bytes[i] = bin.charCodeAt(i);\n");
+  fprintf(fp, "  var le = new Uint8Array(new Uint16Array([1]).buffer)[0] == "
+	      "1;\n");
+  fprintf(fp, "  if (le)\n");
+  fprintf(fp, "    return (size == 4) ? new Float32Array(bytes.buffer) : new "
+	      "Float64Array(bytes.buffer);\n");
+  fprintf(fp, "  var view = new DataView(bytes.buffer);\n");
+  fprintf(fp, "  var out = (size == 4) ? new Float32Array(bin.length / 4) : "
+	      "new Float64Array(bin.length / 8);\n");
+  fprintf(fp, "  for (var i = 0; i < out.length; i++)\n");
+  fprintf(fp, "    out[i] = (size == 4) ? view.getFloat32(4 * i, true) : "
+	      "view.getFloat64(8 * i, true);\n");
+  fprintf(fp, "  return out;\n");
+  fprintf(fp, "}\n");
+  fprintf(fp, "function hp2p_rows(flat, ncols) {\n");
+  fprintf(fp, "  var rows = [];\n");
+  fprintf(fp, "  for (var i = 0; i < flat.length; i += ncols)\n");
+  fprintf(fp, "    rows.push(flat.subarray(i, i + ncols));\n");
+  fprintf(fp, "  return rows;\n");
+  fprintf(fp, "}\n");
+  fprintf(fp, "</script>\n");
+}
 
-  if (fp != NULL)
+/**
+ * \fn     void hp2p_result_write_html_assets(FILE *fp, hp2p_result result)
+ * \brief  Write the CSS, Plotly.js and the decoder of the HTML pages
+ *
+ * The block is rendered in memory on the first call, so that the
+ * Plotly.js file is read once per run and not for every page of every
+ * snapshot.
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_result_write_html_assets(FILE *fp, hp2p_result result)
+{
+  FILE *mem = NULL;
+
+  if (html_assets == NULL ||
+      strcmp(html_assets_plotlyjs, result.conf->plotlyjs) != 0)
+  {
+    hp2p_result_free_html_assets();
+    mem = open_memstream(&html_assets, &html_assets_size);
+    if (mem == NULL)
+      return;
+    fputs(hp2p_result_html_css, mem);
+    hp2p_result_write_html_plotlyjs(mem, result);
+    hp2p_result_write_html_decoder(mem);
+    fclose(mem);
+    strcpy(html_assets_plotlyjs, result.conf->plotlyjs);
+  }
+  fwrite(html_assets, sizeof(char), html_assets_size, fp);
+}
+
+void hp2p_result_free_html_assets()
+{
+  free(html_assets);
+  html_assets = NULL;
+  html_assets_size = 0;
+}
+
+const char hp2p_base64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * \fn     int hp2p_result_encode_base64(const unsigned char *in, int size,
+ *                                       char *out)
+ * \brief  Encode bytes in base64 (padded)
+ *
+ * \param  in
+ * \param  size number of bytes
+ * \param  out  buffer of at least 4 * ((size + 2) / 3) chars
+ * \return number of chars written
+ **/
+int hp2p_result_encode_base64(const unsigned char *in, int size, char *out)
+{
+  uint32_t v = 0;
+  int i = 0;
+  int n = 0;
+
+  for (i = 0; i + 2 < size; i += 3)
+  {
+    v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+    out[n++] = hp2p_base64[(v >> 18) & 63];
+    out[n++] = hp2p_base64[(v >> 12) & 63];
+    out[n++] = hp2p_base64[(v >> 6) & 63];
+    out[n++] = hp2p_base64[v & 63];
+  }
+  if (i < size)
+  {
+    v = (uint32_t)in[i] << 16;
+    if (i + 1 < size)
+      v |= (uint32_t)in[i + 1] << 8;
+    out[n++] = hp2p_base64[(v >> 18) & 63];
+    out[n++] = hp2p_base64[(v >> 12) & 63];
+    out[n++] = (i + 1 < size) ? hp2p_base64[(v >> 6) & 63] : '=';
+    out[n++] = '=';
+  }
+  return n;
+}
+
+/**
+ * \fn     void hp2p_result_write_html_array(FILE *fp, hp2p_result result,
+ *                                           const char *name, double *values,
+ *                                           size_t n, double scale, int type,
+ *                                           int scientific, int precision)
+ * \brief  Write a JavaScript variable holding values[i] / scale
+ *
+ * With the base64 encoding, values are converted to little-endian
+ * Float32 or Float64 and encoded by blocks, and the page decodes them
+ * with hp2p_decode. Otherwise an array literal is written.
+ *
+ * \param  fp
+ * \param  result
+ * \param  name  name of the variable
+ * \param  values
+ * \param  n     number of values
+ * \param  scale
+ * \param  type  HP2P_HTML_FLOAT32 or HP2P_HTML_FLOAT64
+ * \param  scientific notation of the values in the text encoding
+ * \param  precision  digits of the values in the text encoding
+ **/
+void hp2p_result_write_html_array(FILE *fp, hp2p_result result,
+				  const char *name, double *values, size_t n,
+				  double scale, int type, int scientific,
+				  int precision)
+{
+  // Blocks of 3072 values are a multiple of 3 bytes: no padding inside
+  unsigned char bytes[3072 * HP2P_HTML_FLOAT64];
+  char chars[4096 * HP2P_HTML_FLOAT64];
+  uint64_t u64 = 0;
+  uint32_t u32 = 0;
+  double d = 0.0;
+  float f = 0.0;
+  size_t nb = 0;
+  size_t i = 0;
+  size_t k = 0;
+  int b = 0;
+
+  if (result.conf->html_encoding != HP2P_HTML_BASE64)
+  {
+    fprintf(fp, "var %s = \n[", name);
+    for (i = 0; i < n; i++)
+    {
+      fputc(' ', fp);
+      hp2p_writer_double(fp, values[i] / scale, scientific, precision);
+      fputc(',', fp);
+    }
+    fprintf(fp, "    ]\n;\n");
+    return;
+  }
+
+  fprintf(fp, "var %s = \nhp2p_decode(\"%s\", \"", name,
+	  type == HP2P_HTML_FLOAT32 ? "f32" : "f64");
+  for (i = 0; i < n; i += 3072)
   {
-    fprintf(fp, "<script type=\"text/javascript\">window.PlotlyConfig = "
-		"{MathJaxConfig: 'local'};</script>\n");
-    if (strlen(result.conf->plotlyjs) > 0)
+    nb = (n - i < 3072) ? n - i : 3072;
+    for (k = 0, b = 0; k < nb; k++)
     {
-      fplotly = fopen(result.conf->plotlyjs, "r");
-      if (fplotly != NULL)
+      if (type == HP2P_HTML_FLOAT32)
       {
-	fprintf(fp, "<script type=\"text/javascript\">\n");
-	fseek(fplotly, 0L, SEEK_END); // file pointer at end of file
-	pos = ftell(fplotly);
-	fseek(fplotly, 0L, SEEK_SET); // file pointer set at start
-	while (pos--)
-	{
-	  ch = fgetc(fplotly); // copying file character by character
-	  fputc(ch, fp);
-	}
-	fprintf(fp, "\n</script>\n");
-	fclose(fplotly);
+	f = (float)(values[i + k] / scale);
+	memcpy(&u32, &f, sizeof(float));
+	bytes[b++] = u32 & 0xff;
+	bytes[b++] = (u32 >> 8) & 0xff;
+	bytes[b++] = (u32 >> 16) & 0xff;
+	bytes[b++] = (u32 >> 24) & 0xff;
       }
       else
-	fprintf(fp,
-		"<script "
-		"src=\"https://cdn.plot.ly/plotly-%s.min.js\"></script>\n",
-		PLOTLY_VERSION);
+      {
+	d = values[i + k] / scale;
+	memcpy(&u64, &d, sizeof(double));
+	for (u32 = 0; u32 < 8; u32++)
+	  bytes[b++] = (u64 >> (8 * u32)) & 0xff;
+      }
     }
-    else
-      fprintf(fp,
-	      "<script "
-	      "src=\"https://cdn.plot.ly/plotly-%s.min.js\"></script>\n",
-	      PLOTLY_VERSION);
+    fwrite(chars, sizeof(char), hp2p_result_encode_base64(bytes, b, chars),
+	   fp);
   }
+  fprintf(fp, "\")\n;\n");
 }
 
 void hp2p_result_write_html_header(FILE *fp, hp2p_result result)
@@ -427,10 +1201,9 @@ void hp2p_result_write_html_header(FILE *fp, hp2p_result result)
     fprintf(fp, "  <head>\n");
     fprintf(fp, "    <meta charset=\"utf-8\" />\n");
     fprintf(fp, "     <title>CEA-HPC - HP2P on %s - %s at %s</title>\n",
-	    &(result.mpi_conf->hostlist[0]), date, hour);
+	    hp2p_mpi_get_host(result.mpi_conf, 0), date, hour);
     fprintf(fp, "  </head>\n");
-    hp2p_result_write_html_css(fp);
-    hp2p_result_write_html_plotlyjs(fp, result);
+    hp2p_result_write_html_assets(fp, result);
     fprintf(fp, "<body style=\"background-color:rgb(220, 220, 220);\">\n");
     fflush(fp);
   }
@@ -461,6 +1234,111 @@ void hp2p_result_write_html_footer(FILE *fp)
   }
 }
 
+/**
+ * \fn     void hp2p_result_write_html_corrupt(FILE *fp, hp2p_result *result)
+ * \brief  Write the corruption counters and the pairs with corrupted data
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_result_write_html_corrupt(FILE *fp, hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  int nproc = mpi_conf->nproc;
+  int listed = 0;
+  int i = 0;
+
+  fprintf(fp,
+	  "Payload verification: %lld corrupted exchanges (%lld words) on %d "
+	  "pairs, overhead %0.2lf %%<br>\n",
+	  result->nb_corrupt, result->corrupt_words, result->corrupt_pairs,
+	  100.0 * result->verify_overhead);
+  if (result->g_corrupt == NULL)
+    return;
+  for (i = 0; i < nproc * nproc && listed < HP2P_CORRUPT_LIST; i++)
+  {
+    if (result->g_corrupt[i] == 0)
+      continue;
+    fprintf(fp,
+	    "&nbsp;&nbsp;%s received %d corrupted exchanges from %s<br>\n",
+	    hp2p_mpi_get_host(mpi_conf, i / nproc), result->g_corrupt[i],
+	    hp2p_mpi_get_host(mpi_conf, i % nproc));
+    listed++;
+  }
+  if (listed < result->corrupt_pairs)
+    fprintf(fp, "&nbsp;&nbsp;... %d more pairs<br>\n",
+	    result->corrupt_pairs - listed);
+}
+
+/**
+ * \fn     void hp2p_result_write_html_placement(FILE *fp, hp2p_result *result)
+ * \brief  Write the placement policy and a collapsed table of the CPU and
+ *         NUMA binding of each rank
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_result_write_html_placement(FILE *fp, hp2p_result *result)
+{
+  hp2p_binding *b = result->mpi_conf->bindings;
+  int numa_node = result->conf->numa_node;
+  int i = 0;
+
+  if (numa_node == HP2P_NUMA_NIC)
+    fprintf(fp, "Buffer placement: node of the network interface");
+  else if (numa_node == HP2P_NUMA_NONE)
+    fprintf(fp, "Buffer placement: first touch");
+  else
+    fprintf(fp, "Buffer placement: node %d", numa_node);
+  if (result->conf->hugepages > 0)
+    fprintf(fp, ", %d MB huge pages", result->conf->hugepages);
+  fprintf(fp, "<br>\n");
+  fprintf(fp, "Buffer source: %s<br>\n",
+	  hp2p_buffer_source_name[result->conf->buffer_source]);
+  if (b == NULL)
+    return;
+  fprintf(fp, "<details><summary>Rank placement</summary>\n");
+  fprintf(fp, "<table>\n<tr><th>Rank</th><th>Host</th><th>CPUs</th>"
+	      "<th>CPU node</th><th>Buffer node</th><th>Page</th></tr>\n");
+  for (i = 0; i < result->mpi_conf->nproc; i++)
+    fprintf(fp,
+	    "<tr><td>%d</td><td>%s</td><td>%s</td><td>%d</td><td>%d</td>"
+	    "<td>%d kB</td></tr>\n",
+	    i, hp2p_mpi_get_host(result->mpi_conf, i), b[i].cpus,
+	    b[i].cpu_node, b[i].buffer_node, b[i].page_kb);
+  fprintf(fp, "</table>\n</details>\n");
+}
+
+/**
+ * \fn     void hp2p_result_write_html_sweep(FILE *fp, hp2p_result *result)
+ * \brief  Write the statistics of each offset of the sweep
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_result_write_html_sweep(FILE *fp, hp2p_result *result)
+{
+  double m = 1024.0 * 1024.0;
+  int k = 0;
+
+  fprintf(fp, "<div>\n");
+  fprintf(fp, "<h2>Offset Sweep</h2>\n");
+  fprintf(fp, "<table>\n<tr><th>Offset</th><th>Samples</th>"
+	      "<th>Bandwidth (MB/s)</th><th>Latency (&#181;s)</th>"
+	      "<th>Best latency (&#181;s)</th></tr>\n");
+  for (k = 0; k < result->conf->nb_offsets; k++)
+    fprintf(fp,
+	    "<tr><td>%d</td><td>%.0lf</td><td>%0.2lf</td><td>%0.2lf</td>"
+	    "<td>%0.2lf</td></tr>\n",
+	    result->conf->offsets[k],
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_COUNT),
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_BW) / m,
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_TIME) * 1.e6,
+	    hp2p_sweep_stat(result, k, HP2P_SWEEP_BEST) * 1.e6);
+  fprintf(fp, "</table>\n");
+  fprintf(fp, "</div>\n");
+}
+
 void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result)
 {
   // Convert bytes to Mb
@@ -479,11 +1357,32 @@ void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result)
     fprintf(fp, "<h2>Details</h2>\n");
     fprintf(fp, "Number of iterations: %d / %d<br>\n", result.current_iteration,
 	    result.conf->nb_shuffle);
-    fprintf(fp, "Message size: %d bytes<br>\n", result.conf->msg_size);
+    fprintf(fp, "Message size: %lld bytes<br>\n", result.conf->msg_size);
     fprintf(fp, "Number of messages per communication: %d<br>\n",
 	    result.conf->nb_msg);
     fprintf(fp, "MPI buffer alignment: %d<br>\n", result.conf->align_size);
     fprintf(fp, "Algorithm: %s<br>\n", hp2p_algo[result.conf->build]);
+    if (result.conf->converge_width > 0.0)
+      fprintf(fp,
+	      "Converged %s pairs: %lld / %lld (&#177; %0.2lf %% at %0.1lf %% "
+	      "confidence)<br>\n",
+	      result.conf->converge_level == HP2P_CONVERGE_NODE ? "node"
+								 : "rank",
+	      result.converged, result.converge_total,
+	      100.0 * result.conf->converge_width,
+	      100.0 * result.conf->converge_confidence);
+    if (result.conf->datatype != HP2P_TYPE_CONTIGUOUS)
+      fprintf(fp,
+	      "Derived datatype: %s, %0.2lf MB/s on average (%0.2lf %% of "
+	      "contiguous, min %0.2lf %% between %s and %s)<br>\n",
+	      hp2p_datatype_name[result.conf->datatype],
+	      result.avg_type_bw / m, 100.0 * result.avg_type_ratio,
+	      100.0 * result.min_type_ratio,
+	      hp2p_mpi_get_host(result.mpi_conf, result.i_min_type),
+	      hp2p_mpi_get_host(result.mpi_conf, result.j_min_type));
+    if (result.conf->verify)
+      hp2p_result_write_html_corrupt(fp, &result);
+    hp2p_result_write_html_placement(fp, &result);
     fprintf(fp, "</div>\n");
     fprintf(fp, "</div>\n");
 
@@ -494,15 +1393,24 @@ void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result)
     fprintf(
 	fp, "Minimum Bandwidth: %0.2lf MB/s between %s and %s<br>\n",
 	result.min_bw / m,
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.i_min_bw],
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.j_min_bw]);
+	hp2p_mpi_get_host(result.mpi_conf, result.i_min_bw),
+	hp2p_mpi_get_host(result.mpi_conf, result.j_min_bw));
     fprintf(
 	fp, "Maximum Bandwidth: %0.2lf MB/s between %s and %s<br>\n",
 	result.max_bw / m,
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.i_max_bw],
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.j_max_bw]);
+	hp2p_mpi_get_host(result.mpi_conf, result.i_max_bw),
+	hp2p_mpi_get_host(result.mpi_conf, result.j_max_bw));
     fprintf(fp, "Average: %0.2lf MB/s<br>\n", result.avg_bw / m);
     fprintf(fp, "Standard deviation: %0.2lf MB/s<br>\n", result.stdd_bw / m);
+    if (result.conf->robust_samples > 0)
+    {
+      fprintf(fp, "Trimmed mean: %0.2lf MB/s<br>\n", result.avg_bw_trim / m);
+      fprintf(fp, "Median of means: %0.2lf MB/s<br>\n",
+	      result.avg_bw_mom / m);
+      fprintf(fp, "Best: %0.2lf MB/s<br>\n", result.avg_bw_best / m);
+      fprintf(fp, "Noisy pairs: %d, slow pairs: %d<br>\n", result.noisy_pairs,
+	      result.slow_pairs);
+    }
     fprintf(fp, "</div>\n");
 
     // Latency statistics
@@ -512,14 +1420,14 @@ void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result)
 	fp,
 	"Minimum Latency: %0.2lf <span>&#181;</span>s between %s and %s<br>\n",
 	result.min_time * 1.e6,
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.i_min_time],
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.j_min_time]);
+	hp2p_mpi_get_host(result.mpi_conf, result.i_min_time),
+	hp2p_mpi_get_host(result.mpi_conf, result.j_min_time));
     fprintf(
 	fp,
 	"Maximum Latency: %0.2lf <span>&#181;</span>s between %s and %s<br>\n",
 	result.max_time * 1.e6,
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.i_max_time],
-	&result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * result.j_max_time]);
+	hp2p_mpi_get_host(result.mpi_conf, result.i_max_time),
+	hp2p_mpi_get_host(result.mpi_conf, result.j_max_time));
     fprintf(fp, "Average: %0.2lf <span>&#181;</span>s<br>\n",
 	    result.avg_time * 1.e6);
     fprintf(fp, "Standard deviation: %0.2lf <span>&#181;</span>s<br>\n",
@@ -537,6 +1445,31 @@ void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result)
     fprintf(fp, "Standard deviation: %0.2lf MB/s<br>\n", result.stdd_bsbw / m);
     fprintf(fp, "</div>\n");
 
+    // Offset sweep
+    if (result.conf->nb_offsets > 0)
+      hp2p_result_write_html_sweep(fp, &result);
+
+    // Synchronization
+    fprintf(fp, "<div>\n");
+    fprintf(fp, "<h2>Synchronization Statistics</h2>\n");
+    fprintf(fp, "Mode: %s",
+	    result.conf->sync_mode == HP2P_SYNC_PAIR ? "pairwise handshake"
+						     : "global barriers");
+    if (result.conf->sync_mode == HP2P_SYNC_PAIR && result.conf->fence_freq > 0)
+      fprintf(fp, " (fence every %d iterations)", result.conf->fence_freq);
+    fprintf(fp, "<br>\n");
+    fprintf(fp,
+	    "Average synchronization time: %0.2lf <span>&#181;</span>s<br>\n",
+	    result.avg_sync * 1.e6);
+    fprintf(fp,
+	    "Maximum synchronization time: %0.2lf <span>&#181;</span>s<br>\n",
+	    result.max_sync * 1.e6);
+    fprintf(fp, "Average start skew: %0.2lf <span>&#181;</span>s<br>\n",
+	    result.avg_skew * 1.e6);
+    fprintf(fp, "Maximum start skew: %0.2lf <span>&#181;</span>s<br>\n",
+	    result.max_skew * 1.e6);
+    fprintf(fp, "</div>\n");
+
     fprintf(fp, "</div>\n");
   }
 }
@@ -544,10 +1477,74 @@ void hp2p_result_write_html_default_stats(FILE *fp, hp2p_result result)
 int plotly_id = 1;
 int plotly_uid = 1;
 
+/**
+ * \fn     void hp2p_result_write_html_distribution(FILE *fp,
+ *                                                  hp2p_result result)
+ * \brief  Write the distributions of the bandwidths computed by the writer
+ *
+ * Used when the bandwidth matrix is not embedded in the page: bw_avg
+ * holds the average bandwidth of each rank and bandwidth_hist_x/y the
+ * histogram of the bandwidths of the pairs.
+ *
+ * \param  fp
+ * \param  result
+ **/
+void hp2p_result_write_html_distribution(FILE *fp, hp2p_result result)
+{
+  double *avg = NULL;
+  double *x = NULL;
+  double *y = NULL;
+  double m = 1024.0 * 1024.0;
+  double width = 0.0;
+  double bw = 0.0;
+  int nproc = result.mpi_conf->nproc;
+  int nbins = 100;
+  int i = 0;
+  int j = 0;
+  int k = 0;
+
+  avg = (double *)calloc(nproc, sizeof(double));
+  x = (double *)malloc(nbins * sizeof(double));
+  y = (double *)calloc(nbins, sizeof(double));
+  width = (result.max_bw - result.min_bw) / nbins;
+  for (k = 0; k < nbins; k++)
+    x[k] = result.min_bw + (k + 0.5) * width;
+  for (i = 0; i < nproc; i++)
+  {
+    for (j = 0; j < nproc; j++)
+    {
+      bw = result.g_bw[(size_t)i * nproc + j];
+      avg[i] += bw;
+      if (bw <= 0.0)
+	continue;
+      k = (width > 0.0) ? (int)((bw - result.min_bw) / width) : 0;
+      if (k >= nbins)
+	k = nbins - 1;
+      if (k < 0)
+	k = 0;
+      y[k] += 1.0;
+    }
+    if (nproc > 1)
+      avg[i] /= nproc - 1;
+  }
+  hp2p_result_write_html_array(fp, result, "bw_avg", avg, nproc, m,
+			       HP2P_HTML_FLOAT32, 0, 2);
+  hp2p_result_write_html_array(fp, result, "bandwidth_hist_x", x, nbins, m,
+			       HP2P_HTML_FLOAT32, 0, 2);
+  hp2p_result_write_html_array(fp, result, "bandwidth_hist_y", y, nbins, 1.0,
+			       HP2P_HTML_FLOAT32, 0, 0);
+  free(avg);
+  free(x);
+  free(y);
+}
+
 void hp2p_result_write_html(hp2p_result result)
 {
   FILE *fp = NULL;
   char *filename = NULL;
+  int nproc = result.mpi_conf->nproc;
+  int tiled = hp2p_heatmap_levels(result) > 0;
+  const char *basename = NULL;
   int i = 0;
   int j = 0;
   double m = 1024.0 * 1024.0;
@@ -555,7 +1552,7 @@ void hp2p_result_write_html(hp2p_result result)
   filename = (char *)malloc((strlen(result.conf->outname) + 16) * sizeof(char));
   strcpy(filename, result.conf->outname);
   strcat(filename, ".html");
-  fp = fopen(filename, "w");
+  fp = hp2p_writer_open(filename, "w");
   if (fp != NULL)
   {
     hp2p_result_write_html_header(fp, result);
@@ -567,57 +1564,69 @@ void hp2p_result_write_html(hp2p_result result)
     fprintf(fp, "var hostlist = \n[");
     for (i = 0; i < result.mpi_conf->nproc; i++)
       fprintf(fp, "    \"%s\", ",
-	      &result.mpi_conf->hostlist[MPI_MAX_PROCESSOR_NAME * i]);
+	      hp2p_mpi_get_host(result.mpi_conf, i));
     fprintf(fp, "    ]\n;\n");
     fprintf(fp, "// hostlist end\n");
     fprintf(fp, "// msg_size start\n");
     fprintf(fp, "var msg_size = \n");
-    fprintf(fp, "    %d\n", result.conf->msg_size);
+    fprintf(fp, "    %lld\n", result.conf->msg_size);
     fprintf(fp, "    ;\n");
     fprintf(fp, "// msg_size end\n");
-    fprintf(fp, "// bandwidth start\n");
-    fprintf(fp, "var bandwidth = \n[");
-    for (i = 0; i < result.mpi_conf->nproc; i++)
+    if (tiled)
     {
-      fprintf(fp, "    [");
-      for (j = 0; j < result.mpi_conf->nproc; j++)
-	fprintf(fp, " %0.2lf,",
-		result.g_bw[i * result.mpi_conf->nproc + j] / m);
-      fprintf(fp, " ], ");
+      // Large runs: the matrix is only in the tiles of the heatmap
+      basename = strrchr(result.conf->outname, '/');
+      basename = (basename != NULL) ? basename + 1 : result.conf->outname;
+      fprintf(fp, "// tiles start\n");
+      fprintf(fp, "var heatmap_tile = \n");
+      fprintf(fp, "    %d\n", result.conf->heatmap_tile);
+      fprintf(fp, "    ;\n");
+      fprintf(fp, "var heatmap_path = \n");
+      fprintf(fp, "    \"%s-tiles/\"\n", basename);
+      fprintf(fp, "    ;\n");
+      fprintf(fp, "// tiles end\n");
+      hp2p_result_write_html_distribution(fp, result);
+      fprintf(fp, "</script>\n");
+    }
+    else
+    {
+      fprintf(fp, "// bandwidth start\n");
+      if (result.conf->html_encoding == HP2P_HTML_BASE64)
+      {
+	hp2p_result_write_html_array(fp, result, "bandwidth_flat",
+				     result.g_bw, (size_t)nproc * nproc, m,
+				     HP2P_HTML_FLOAT32, 0, 2);
+	fprintf(fp, "var bandwidth = hp2p_rows(bandwidth_flat, %d);\n",
+		nproc);
+      }
+      else
+      {
+	fprintf(fp, "var bandwidth = \n[");
+	for (i = 0; i < nproc; i++)
+	{
+	  fprintf(fp, "    [");
+	  for (j = 0; j < nproc; j++)
+	  {
+	    fputc(' ', fp);
+	    hp2p_writer_double(fp, result.g_bw[(size_t)i * nproc + j] / m, 0,
+			       2);
+	    fputc(',', fp);
+	  }
+	  fprintf(fp, " ], ");
+	}
+	fprintf(fp, "    ]\n;\n");
+	fprintf(fp, "var bandwidth_flat = [].concat(...bandwidth);\n");
+      }
+      fprintf(fp, "// bandwidth end\n");
+      fprintf(fp, "      var bw_avg = [];\n");
+      fprintf(fp, "      for (const bw_line of bandwidth) {\n");
+      fprintf(fp, "	var sum = bw_line.reduce((a, b) => a + b, 0);\n");
+      fprintf(fp, "	bw_avg.push(sum/(bw_line.length-1));}\n");
+      fprintf(fp, "</script>\n");
     }
-    fprintf(fp, "    ]\n;\n");
-    fprintf(fp, "// bandwidth end\n");
-    fprintf(fp, "      var bw_avg = [];\n");
-    fprintf(fp, "      for (const bw_line of bandwidth) {\n");
-    fprintf(fp, "	var sum = bw_line.reduce((a, b) => a + b, 0);\n");
-    fprintf(fp, "	bw_avg.push(sum/(bw_line.length-1));}\n");
-    fprintf(fp, "</script>\n");
 
     // Bandwidth heatmap
-    fprintf(fp, "<div class=flex-container >\n");
-    fprintf(fp,
-	    "<div><div id=\"%d\" style=\"height: "
-	    "800px; width: 80%%;\" class=\"plotly-graph-div\"></div>\n",
-	    plotly_id);
-    fprintf(fp, "  <script type=\"text/javascript\">\n");
-    fprintf(fp, "    window.PLOTLYENV=window.PLOTLYENV || {};\n");
-    fprintf(fp, "    window.PLOTLYENV.BASE_URL=\"https://plot.ly\";\n");
-    fprintf(fp, "    Plotly.newPlot(\"%d\",\n", plotly_id++);
-    fprintf(fp, "    [{\"uid\": \"%d\",\n", plotly_uid++);
-    fprintf(fp, "    \"colorscale\": \"Jet\",\n");
-    fprintf(fp, "    \"y\": hostlist,\n");
-    fprintf(fp, "    \"x\": hostlist,\n");
-    fprintf(fp, "    \"z\": bandwidth,\n");
-    fprintf(fp, "    \"type\": \"heatmap\"}],\n");
-    fprintf(
-	fp,
-	"    {\"height\": 800, \"width\": 800, \"autosize\": true, \"title\": "
-	"{\"text\": \"Bandwidth (MB/s)\"}, \"yaxis\": {\"autorange\": "
-	"\"reversed\"}}, {\"plotlyServerURL\": \"https://plot.ly\", "
-	"\"linkText\": \"Export to plot.ly\", \"showLink\": false}\n");
-    fprintf(fp, "    )\n");
-    fprintf(fp, "\n  </script>\n\n");
-    fprintf(fp, "</div>\n");
+    hp2p_heatmap_write_html(fp, result);
 
     // Distribution bandwidth
     fprintf(fp, "<div class=flex-container >\n");
@@ -631,10 +1640,19 @@ void hp2p_result_write_html(hp2p_result result)
     fprintf(fp, "    Plotly.newPlot(\"%d\",\n", plotly_id++);
     fprintf(fp, "    [{\"uid\": \"%d\",\n", plotly_uid++);
     fprintf(fp, "    \"colorscale\": \"Jet\",\n");
-    fprintf(fp,
-	    "    \"x\": [].concat(...bandwidth).filter(function(number){return "
-	    "number > 0.0;}),\n");
-    fprintf(fp, "    \"type\": \"histogram\"}],\n");
+    if (tiled)
+    {
+      fprintf(fp, "    \"x\": bandwidth_hist_x,\n");
+      fprintf(fp, "    \"y\": bandwidth_hist_y,\n");
+      fprintf(fp, "    \"type\": \"bar\"}],\n");
+    }
+    else
+    {
+      fprintf(fp,
+	      "    \"x\": bandwidth_flat.filter(function(number){return "
+	      "number > 0.0;}),\n");
+      fprintf(fp, "    \"type\": \"histogram\"}],\n");
+    }
     fprintf(
 	fp,
 	"    {\"height\": 800, \"width\": 800, \"autosize\": true, \"title\": "
@@ -676,22 +1694,69 @@ void hp2p_result_write_html(hp2p_result result)
     fprintf(fp, "</div>\n");
     fprintf(fp, "</div>\n");
     hp2p_result_write_html_footer(fp);
-    fclose(fp);
+    hp2p_writer_close(fp);
   }
   free(filename);
 }
 
+/**
+ * \fn     void hp2p_result_write_html_series(FILE *fp, hp2p_result result,
+ *                                           const char *name,
+ *                                           hp2p_series *series,
+ *                                           double scale, int type,
+ *                                           int scientific, int precision)
+ * \brief  Write the points of a series of iterations
+ *
+ * Writes <name> (mean of each point) and <name>_x (first iteration of each
+ * point). When old iterations have been merged, <name>_min and <name>_max
+ * are also written.
+ *
+ * \param  fp
+ * \param  result
+ * \param  name
+ * \param  series
+ * \param  scale, type, scientific, precision see hp2p_result_write_html_array
+ **/
+void hp2p_result_write_html_series(FILE *fp, hp2p_result result,
+				   const char *name, hp2p_series *series,
+				   double scale, int type, int scientific,
+				   int precision)
+{
+  char *var = NULL;
+  double *x = NULL;
+  int k = 0;
+
+  var = (char *)malloc((strlen(name) + 8) * sizeof(char));
+  hp2p_result_write_html_array(fp, result, name, series->mean, series->count,
+			       scale, type, scientific, precision);
+  x = (double *)malloc((series->count + 1) * sizeof(double));
+  for (k = 0; k < series->count; k++)
+    x[k] = hp2p_series_first(series, k);
+  sprintf(var, "%s_x", name);
+  hp2p_result_write_html_array(fp, result, var, x, series->count, 1.0,
+			       HP2P_HTML_FLOAT64, 0, 0);
+  if (series->width > 1)
+  {
+    sprintf(var, "%s_min", name);
+    hp2p_result_write_html_array(fp, result, var, series->min, series->count,
+				 scale, type, scientific, precision);
+    sprintf(var, "%s_max", name);
+    hp2p_result_write_html_array(fp, result, var, series->max, series->count,
+				 scale, type, scientific, precision);
+  }
+  free(x);
+  free(var);
+}
+
 void hp2p_result_write_monitoring_html(hp2p_result result)
 {
   FILE *fp = NULL;
   char *filename = NULL;
-  int i = 0;
-  int j = 0;
   double m = 1024.0 * 1024.0;
   filename = (char *)malloc((strlen(result.conf->outname) + 32) * sizeof(char));
   strcpy(filename, result.conf->outname);
   strcat(filename, "-monitoring.html");
-  fp = fopen(filename, "w");
+  fp = hp2p_writer_open(filename, "w");
   if (fp != NULL)
   {
     hp2p_result_write_html_header(fp, result);
@@ -701,41 +1766,36 @@ void hp2p_result_write_monitoring_html(hp2p_result result)
     fprintf(fp, "<script type=\"text/javascript\">\n");
     fprintf(fp, "// msg_size start\n");
     fprintf(fp, "var msg_size = \n");
-    fprintf(fp, "    %d\n", result.conf->msg_size);
+    fprintf(fp, "    %lld\n", result.conf->msg_size);
     fprintf(fp, "    ;\n");
     fprintf(fp, "// msg_size end\n");
     fprintf(fp, "// bisection bandwidth start\n");
-    fprintf(fp, "var bisection_bandwidth = \n[");
-    for (i = 0; i < result.current_iteration; i++)
-    {
-      fprintf(fp, " %0.2lf,", result.g_bsbw[i] / m);
-    }
-    fprintf(fp, "    ]\n;\n");
+    hp2p_result_write_html_series(fp, result, "bisection_bandwidth",
+				  &result.g_bsbw, m, HP2P_HTML_FLOAT32, 0, 2);
     fprintf(fp, "// bisection bandwidth end\n");
     fprintf(fp, "// build couples start\n");
-    fprintf(fp, "var monitor_build_couples = \n[");
-    for (i = 0; i < result.current_iteration; i++)
-    {
-      fprintf(fp, " %.3e,", result.monitor_build_couples[i]);
-    }
-    fprintf(fp, "    ]\n;\n");
+    hp2p_result_write_html_series(fp, result, "monitor_build_couples",
+				  &result.monitor_build_couples, 1.0,
+				  HP2P_HTML_FLOAT64, 1, 3);
     fprintf(fp, "// build couples end\n");
     fprintf(fp, "// heavyp2p start\n");
-    fprintf(fp, "var monitor_heavyp2p = \n[");
-    for (i = 0; i < result.current_iteration; i++)
-    {
-      fprintf(fp, " %.3e,", result.monitor_heavyp2p[i]);
-    }
-    fprintf(fp, "    ]\n;\n");
+    hp2p_result_write_html_series(fp, result, "monitor_heavyp2p",
+				  &result.monitor_heavyp2p, 1.0,
+				  HP2P_HTML_FLOAT64, 1, 3);
     fprintf(fp, "// heavyp2p end\n");
     fprintf(fp, "// snapshot start\n");
-    fprintf(fp, "var monitor_snapshot = \n[");
-    for (i = 0; i < result.current_iteration; i++)
-    {
-      fprintf(fp, " %.3e,", result.monitor_snapshot[i]);
-    }
-    fprintf(fp, "    ]\n;\n");
+    hp2p_result_write_html_series(fp, result, "monitor_snapshot",
+				  &result.monitor_snapshot, 1.0,
+				  HP2P_HTML_FLOAT64, 1, 3);
     fprintf(fp, "// snapshot end\n");
+    fprintf(fp, "// sync start\n");
+    hp2p_result_write_html_series(fp, result, "monitor_sync", &result.g_sync,
+				  1.0, HP2P_HTML_FLOAT64, 1, 3);
+    fprintf(fp, "// sync end\n");
+    fprintf(fp, "// skew start\n");
+    hp2p_result_write_html_series(fp, result, "monitor_skew", &result.g_skew,
+				  1.0, HP2P_HTML_FLOAT64, 1, 3);
+    fprintf(fp, "// skew end\n");
     fprintf(fp, "</script>\n");
     fprintf(fp, "\n");
 
@@ -753,20 +1813,37 @@ void hp2p_result_write_monitoring_html(hp2p_result result)
     fprintf(fp, "       \"name\": \"Comm\",\n");
     fprintf(fp, "       \"mode\": \"lines\",\n");
     fprintf(fp, "       \"marker\": { \"color\": \"green\" },\n");
+    fprintf(fp, "       \"x\": monitor_heavyp2p_x,\n");
     fprintf(fp, "       \"y\": monitor_heavyp2p,\n");
     fprintf(fp, "       \"type\": \"scatter\"},");
     fprintf(fp, "      {\"uid\": \"%d\",\n", plotly_uid++);
     fprintf(fp, "       \"name\": \"Draw\",\n");
     fprintf(fp, "       \"mode\": \"lines\",\n");
     fprintf(fp, "       \"marker\": { \"color\": \"blue\" },\n");
+    fprintf(fp, "       \"x\": monitor_build_couples_x,\n");
     fprintf(fp, "       \"y\": monitor_build_couples,\n");
     fprintf(fp, "       \"type\": \"scatter\"},");
     fprintf(fp, "      {\"uid\": \"%d\",\n", plotly_uid++);
     fprintf(fp, "       \"name\": \"Snapshot\",\n");
     fprintf(fp, "       \"mode\": \"lines\",\n");
     fprintf(fp, "       \"marker\": { \"color\": \"orange\" },\n");
+    fprintf(fp, "       \"x\": monitor_snapshot_x,\n");
     fprintf(fp, "       \"y\": monitor_snapshot,\n");
     fprintf(fp, "       \"type\": \"scatter\"},");
+    fprintf(fp, "      {\"uid\": \"%d\",\n", plotly_uid++);
+    fprintf(fp, "       \"name\": \"Sync (avg)\",\n");
+    fprintf(fp, "       \"mode\": \"lines\",\n");
+    fprintf(fp, "       \"marker\": { \"color\": \"purple\" },\n");
+    fprintf(fp, "       \"x\": monitor_sync_x,\n");
+    fprintf(fp, "       \"y\": monitor_sync,\n");
+    fprintf(fp, "       \"type\": \"scatter\"},");
+    fprintf(fp, "      {\"uid\": \"%d\",\n", plotly_uid++);
+    fprintf(fp, "       \"name\": \"Start skew\",\n");
+    fprintf(fp, "       \"mode\": \"lines\",\n");
+    fprintf(fp, "       \"marker\": { \"color\": \"gray\" },\n");
+    fprintf(fp, "       \"x\": monitor_skew_x,\n");
+    fprintf(fp, "       \"y\": monitor_skew,\n");
+    fprintf(fp, "       \"type\": \"scatter\"},");
     fprintf(fp, "\n    ],\n");
     fprintf(
 	fp,
@@ -795,8 +1872,29 @@ void hp2p_result_write_monitoring_html(hp2p_result result)
     fprintf(fp, "    \"name\": \"\",\n");
     fprintf(fp, "    \"mode\": \"markers\",\n");
     fprintf(fp, "    \"marker\": { \"color\": \"red\" },\n");
+    fprintf(fp, "    \"x\": bisection_bandwidth_x,\n");
     fprintf(fp, "    \"y\": bisection_bandwidth,\n");
-    fprintf(fp, "    \"type\": \"scatter\"}],\n");
+    fprintf(fp, "    \"type\": \"scatter\"}");
+    // Range of the merged iterations
+    if (result.g_bsbw.width > 1)
+    {
+      fprintf(fp, ",\n    {\"uid\": \"%d\",\n", plotly_uid++);
+      fprintf(fp, "    \"name\": \"min\",\n");
+      fprintf(fp, "    \"mode\": \"lines\",\n");
+      fprintf(fp, "    \"line\": { \"color\": \"gray\" },\n");
+      fprintf(fp, "    \"x\": bisection_bandwidth_x,\n");
+      fprintf(fp, "    \"y\": bisection_bandwidth_min,\n");
+      fprintf(fp, "    \"type\": \"scatter\"},\n");
+      fprintf(fp, "    {\"uid\": \"%d\",\n", plotly_uid++);
+      fprintf(fp, "    \"name\": \"max\",\n");
+      fprintf(fp, "    \"mode\": \"lines\",\n");
+      fprintf(fp, "    \"line\": { \"color\": \"gray\" },\n");
+      fprintf(fp, "    \"fill\": \"tonexty\",\n");
+      fprintf(fp, "    \"x\": bisection_bandwidth_x,\n");
+      fprintf(fp, "    \"y\": bisection_bandwidth_max,\n");
+      fprintf(fp, "    \"type\": \"scatter\"}");
+    }
+    fprintf(fp, "],\n");
     fprintf(
 	fp,
 	"    {\"height\": 800, \"width\": 800, \"autosize\": true, \"title\": "
@@ -839,18 +1937,19 @@ void hp2p_result_write_monitoring_html(hp2p_result result)
 
     fprintf(fp, "</div>\n");
     hp2p_result_write_html_footer(fp);
-    fclose(fp);
+    hp2p_writer_close(fp);
   }
   free(filename);
 }
 
 void hp2p_result_write(hp2p_result result)
 {
-  if (!strcmp(result.conf->output_mode, "bin"))
+  if (hp2p_util_has_format(result.conf, "bin"))
     hp2p_result_write_binary(result);
-  else
+  if (hp2p_util_has_format(result.conf, "html"))
   {
     hp2p_result_write_html(result);
     hp2p_result_write_monitoring_html(result);
+    hp2p_timeline_write_html(result);
   }
 }
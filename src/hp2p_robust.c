@@ -0,0 +1,236 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_robust.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Outlier-resistant estimators of the time of each pair: trimmed
+ *            mean, median of means and minimum over the iterations. Each
+ *            rank keeps at most robust_samples samples per other rank
+ *            (uniform reservoir sampling beyond), so the estimators are
+ *            exact until a pair has robust_samples samples. The minimum is
+ *            always exact.
+ */
+
+#include "hp2p.h"
+
+void hp2p_robust_alloc(hp2p_result *result)
+{
+  int nproc = result->mpi_conf->nproc;
+  int j = 0;
+
+  result->l_samples = NULL;
+  result->l_seen = NULL;
+  result->l_min = NULL;
+  result->l_trim = NULL;
+  result->l_mom = NULL;
+  result->robust_state = 2463534242u + result->mpi_conf->rank;
+  result->avg_bw_trim = 0.0;
+  result->avg_bw_mom = 0.0;
+  result->avg_bw_best = 0.0;
+  result->noisy_pairs = 0;
+  result->slow_pairs = 0;
+  if (result->conf->robust_samples <= 0)
+    return;
+  // Pages of the pairs never drawn are not touched
+  result->l_samples = (double *)calloc(
+      (size_t)nproc * result->conf->robust_samples, sizeof(double));
+  result->l_seen = (int *)calloc(nproc, sizeof(int));
+  result->l_min = (double *)malloc(nproc * sizeof(double));
+  result->l_trim = (double *)calloc(nproc, sizeof(double));
+  result->l_mom = (double *)calloc(nproc, sizeof(double));
+  for (j = 0; j < nproc; j++)
+    result->l_min[j] = 0.0;
+}
+
+void hp2p_robust_free(hp2p_result *result)
+{
+  free(result->l_samples);
+  free(result->l_seen);
+  free(result->l_min);
+  free(result->l_trim);
+  free(result->l_mom);
+}
+
+/**
+ * \fn     void hp2p_robust_add(hp2p_result *result, int other,
+ *                              double sample)
+ * \brief  Keep a sample of a pair
+ *
+ * A private xorshift generator is used so that the draws of the couples
+ * (rand on the root) do not depend on the sampling.
+ *
+ * \param  result
+ * \param  other  other rank of couple
+ * \param  sample time of communication
+ **/
+void hp2p_robust_add(hp2p_result *result, int other, double sample)
+{
+  int size = result->conf->robust_samples;
+  double *kept = NULL;
+  unsigned int x = 0;
+  unsigned int j = 0;
+  int n = 0;
+
+  if (size <= 0)
+    return;
+  kept = &result->l_samples[(size_t)other * size];
+  n = result->l_seen[other]++;
+  if (n == 0 || sample < result->l_min[other])
+    result->l_min[other] = sample;
+  if (n < size)
+  {
+    kept[n] = sample;
+    return;
+  }
+  x = result->robust_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  result->robust_state = x;
+  // Replace the drawn sample, if it is kept (uniform reservoir)
+  j = x % (unsigned int)(n + 1);
+  if (j < (unsigned int)size)
+    kept[j] = sample;
+}
+
+int hp2p_robust_compare(const void *a, const void *b)
+{
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * \fn     void hp2p_robust_estimate(hp2p_result *result, int other,
+ *                                   double *sorted, double *means)
+ * \brief  Trimmed mean and median of means of the samples of a pair
+ *
+ * \param  result
+ * \param  other  other rank of couple
+ * \param  sorted robust_samples doubles (work)
+ * \param  means  robust_groups doubles (work)
+ **/
+void hp2p_robust_estimate(hp2p_result *result, int other, double *sorted,
+			  double *means)
+{
+  hp2p_config *conf = result->conf;
+  double *kept = &result->l_samples[(size_t)other * conf->robust_samples];
+  double sum = 0.0;
+  int n = result->l_seen[other];
+  int groups = conf->robust_groups;
+  int first = 0;
+  int last = 0;
+  int g = 0;
+  int i = 0;
+
+  if (n > conf->robust_samples)
+    n = conf->robust_samples;
+  // Trimmed mean
+  memcpy(sorted, kept, n * sizeof(double));
+  qsort(sorted, n, sizeof(double), hp2p_robust_compare);
+  first = (int)(conf->robust_trim * n);
+  last = n - first;
+  if (last <= first)
+  {
+    first = (n - 1) / 2;
+    last = n / 2 + 1;
+  }
+  for (i = first, sum = 0.0; i < last; i++)
+    sum += sorted[i];
+  result->l_trim[other] = sum / (last - first);
+
+  // Median of the means of consecutive groups of samples
+  if (groups > n)
+    groups = n;
+  if (groups < 1)
+    groups = 1;
+  for (g = 0; g < groups; g++)
+  {
+    first = g * n / groups;
+    last = (g + 1) * n / groups;
+    for (i = first, sum = 0.0; i < last; i++)
+      sum += kept[i];
+    means[g] = sum / (last - first);
+  }
+  qsort(means, groups, sizeof(double), hp2p_robust_compare);
+  if (groups % 2)
+    result->l_mom[other] = means[groups / 2];
+  else
+    result->l_mom[other] = 0.5 * (means[groups / 2 - 1] + means[groups / 2]);
+}
+
+/**
+ * \fn     void hp2p_robust_update(hp2p_result *result)
+ * \brief  Estimate the time of each pair and reduce the averages
+ *
+ * A pair is noisy when its raw mean is more than robust_noise above its
+ * trimmed mean (transient outliers), and slow when its trimmed mean is
+ * more than robust_noise above the average trimmed mean of all pairs
+ * (persistently slow link). Must follow hp2p_result_stats_row.
+ * This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_robust_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_config *conf = result->conf;
+  double sums[6];
+  double *sorted = NULL;
+  double *means = NULL;
+  double avg_trim = 0.0;
+  int slow = 0;
+  int j = 0;
+
+  if (conf->robust_samples <= 0)
+    return;
+  sorted = (double *)malloc(conf->robust_samples * sizeof(double));
+  means = (double *)malloc(
+      (conf->robust_groups > 0 ? conf->robust_groups : 1) * sizeof(double));
+  memset(sums, 0, sizeof(sums));
+  for (j = 0; j < mpi_conf->nproc; j++)
+  {
+    if (j == mpi_conf->rank || result->l_seen[j] == 0)
+      continue;
+    hp2p_robust_estimate(result, j, sorted, means);
+    sums[0] += 1.0;
+    sums[1] += conf->msg_size / result->l_trim[j];
+    sums[2] += conf->msg_size / result->l_mom[j];
+    sums[3] += conf->msg_size / result->l_min[j];
+    sums[4] += result->l_trim[j];
+    if (result->l_avg_time[j] > (1.0 + conf->robust_noise) * result->l_trim[j])
+      sums[5] += 1.0;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, sums, 6, MPI_DOUBLE, MPI_SUM, mpi_conf->comm);
+  if (sums[0] > 0.0)
+  {
+    result->avg_bw_trim = sums[1] / sums[0];
+    result->avg_bw_mom = sums[2] / sums[0];
+    result->avg_bw_best = sums[3] / sums[0];
+    avg_trim = sums[4] / sums[0];
+  }
+  result->noisy_pairs = (int)sums[5];
+
+  for (j = 0; j < mpi_conf->nproc; j++)
+    if (j != mpi_conf->rank && result->l_seen[j] > 0 &&
+	result->l_trim[j] > (1.0 + conf->robust_noise) * avg_trim)
+      slow++;
+  MPI_Allreduce(&slow, &result->slow_pairs, 1, MPI_INT, MPI_SUM,
+		mpi_conf->comm);
+  free(sorted);
+  free(means);
+}
@@ -0,0 +1,330 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_series.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Series of iterations (bisection bandwidth, synchronization,
+ *            monitoring) in bounded memory. Buckets are allocated on demand
+ *            up to the capacity, then adjacent buckets are merged so that
+ *            old iterations are kept as min/mean/max of 2, 4, ... iterations.
+ */
+
+#include "hp2p.h"
+
+#define HP2P_SERIES_INIT_SIZE 256
+#define HP2P_SERIES_PACK_HEADER 7
+
+void hp2p_series_init(hp2p_series *series, int capacity)
+{
+  if (capacity < 2)
+    capacity = 2;
+  series->capacity = capacity + (capacity % 2);
+  series->size = 0;
+  series->count = 0;
+  series->width = 1;
+  series->n = 0;
+  series->min = NULL;
+  series->mean = NULL;
+  series->max = NULL;
+  series->avg = 0.0;
+  series->m2 = 0.0;
+  series->lo = 0.0;
+  series->hi = 0.0;
+}
+
+void hp2p_series_free(hp2p_series *series)
+{
+  free(series->min);
+  free(series->mean);
+  free(series->max);
+  series->min = NULL;
+  series->mean = NULL;
+  series->max = NULL;
+  series->size = 0;
+  series->count = 0;
+  series->n = 0;
+}
+
+/**
+ * \fn     void hp2p_series_reserve(hp2p_series *series, int count)
+ * \brief  Allocate at least count buckets
+ *
+ * \param  series
+ * \param  count
+ **/
+void hp2p_series_reserve(hp2p_series *series, int count)
+{
+  int size = series->size;
+
+  if (count <= size)
+    return;
+  if (size == 0)
+    size = HP2P_SERIES_INIT_SIZE;
+  while (size < count)
+    size *= 2;
+  series->min = (double *)realloc(series->min, size * sizeof(double));
+  series->mean = (double *)realloc(series->mean, size * sizeof(double));
+  series->max = (double *)realloc(series->max, size * sizeof(double));
+  series->size = size;
+}
+
+/**
+ * \fn     int hp2p_series_bucket_size(hp2p_series *series, int k)
+ * \brief  Number of values in a bucket (only the last one may be partial)
+ *
+ * \param  series
+ * \param  k index of the bucket
+ * \return number of values
+ **/
+int hp2p_series_bucket_size(hp2p_series *series, int k)
+{
+  if (k < series->count - 1)
+    return series->width;
+  return series->n - k * series->width;
+}
+
+/**
+ * \fn     void hp2p_series_merge(hp2p_series *series)
+ * \brief  Merge adjacent buckets and double the width
+ *
+ * \param  series
+ **/
+void hp2p_series_merge(hp2p_series *series)
+{
+  int a = 0;
+  int b = 0;
+  int k = 0;
+  int na = 0;
+  int nb = 0;
+
+  for (k = 0; 2 * k < series->count; k++)
+  {
+    a = 2 * k;
+    b = a + 1;
+    series->min[k] = series->min[a];
+    series->mean[k] = series->mean[a];
+    series->max[k] = series->max[a];
+    if (b == series->count)
+      continue;
+    na = hp2p_series_bucket_size(series, a);
+    nb = hp2p_series_bucket_size(series, b);
+    series->mean[k] =
+	(series->mean[a] * na + series->mean[b] * nb) / (double)(na + nb);
+    if (series->min[b] < series->min[k])
+      series->min[k] = series->min[b];
+    if (series->max[b] > series->max[k])
+      series->max[k] = series->max[b];
+  }
+  series->count = (series->count + 1) / 2;
+  series->width *= 2;
+}
+
+/**
+ * \fn     void hp2p_series_push(hp2p_series *series, double value)
+ * \brief  Append the value of the next iteration
+ *
+ * \param  series
+ * \param  value
+ **/
+void hp2p_series_push(hp2p_series *series, double value)
+{
+  double delta = 0.0;
+  int k = 0;
+  int nk = 0;
+
+  if (series->n == series->count * series->width)
+  {
+    // Last bucket is full
+    if (series->count == series->capacity)
+      hp2p_series_merge(series);
+    hp2p_series_reserve(series, series->count + 1);
+    k = series->count++;
+    series->min[k] = value;
+    series->mean[k] = value;
+    series->max[k] = value;
+  }
+  else
+  {
+    k = series->count - 1;
+    nk = series->n - k * series->width;
+    series->mean[k] += (value - series->mean[k]) / (nk + 1);
+    if (value < series->min[k])
+      series->min[k] = value;
+    if (value > series->max[k])
+      series->max[k] = value;
+  }
+
+  // Statistics of all the values (Welford)
+  if (series->n == 0 || value < series->lo)
+    series->lo = value;
+  if (series->n == 0 || value > series->hi)
+    series->hi = value;
+  series->n++;
+  delta = value - series->avg;
+  series->avg += delta / series->n;
+  series->m2 += delta * (value - series->avg);
+}
+
+/**
+ * \fn     int hp2p_series_first(hp2p_series *series, int k)
+ * \brief  First iteration of a bucket
+ *
+ * \param  series
+ * \param  k index of the bucket
+ * \return iteration (starting at 1)
+ **/
+int hp2p_series_first(hp2p_series *series, int k)
+{
+  return k * series->width + 1;
+}
+
+/**
+ * \fn     int hp2p_series_size(hp2p_series *series, int k)
+ * \brief  Number of iterations of a bucket
+ *
+ * \param  series
+ * \param  k index of the bucket
+ * \return number of iterations
+ **/
+int hp2p_series_size(hp2p_series *series, int k)
+{
+  return hp2p_series_bucket_size(series, k);
+}
+
+/**
+ * \fn     double hp2p_series_mean(hp2p_series *series, int first, int last)
+ * \brief  Mean of the iterations first to last
+ *
+ * Buckets partially covered are weighted by the number of their iterations
+ * in the range, so that series merged at different times can be compared.
+ *
+ * \param  series
+ * \param  first first iteration (starting at 1)
+ * \param  last  last iteration (included)
+ * \return mean, 0 if no iteration of the range is in the series
+ **/
+double hp2p_series_mean(hp2p_series *series, int first, int last)
+{
+  double sum = 0.0;
+  int weight = 0;
+  int lo = 0;
+  int hi = 0;
+  int k = 0;
+
+  for (k = (first - 1) / series->width;
+       k < series->count && k * series->width < last; k++)
+  {
+    lo = k * series->width + 1;
+    hi = lo + hp2p_series_bucket_size(series, k) - 1;
+    if (lo < first)
+      lo = first;
+    if (hi > last)
+      hi = last;
+    if (hi < lo)
+      continue;
+    sum += series->mean[k] * (hi - lo + 1);
+    weight += hi - lo + 1;
+  }
+  return (weight > 0) ? sum / weight : 0.0;
+}
+
+/**
+ * \fn     double hp2p_series_stdd(hp2p_series *series)
+ * \brief  Standard deviation of all the values
+ *
+ * \param  series
+ * \return standard deviation (divided by n + 1 as in previous versions)
+ **/
+double hp2p_series_stdd(hp2p_series *series)
+{
+  if (series->n < 1)
+    return 0.0;
+  return sqrt(series->m2 / ((double)series->n + 1));
+}
+
+/**
+ * \fn     int hp2p_series_packed_size(hp2p_series *series)
+ * \brief  Number of doubles written by hp2p_series_pack
+ *
+ * \param  series
+ * \return number of doubles
+ **/
+int hp2p_series_packed_size(hp2p_series *series)
+{
+  return HP2P_SERIES_PACK_HEADER + 3 * series->count;
+}
+
+/**
+ * \fn     void hp2p_series_pack(hp2p_series *series, double *buffer)
+ * \brief  Copy a series in a buffer of doubles
+ *
+ * The buffer holds count, width, n, avg, m2, lo, hi then the min, the
+ * mean and the max of the buckets.
+ *
+ * \param  series
+ * \param  buffer hp2p_series_packed_size doubles (output)
+ **/
+void hp2p_series_pack(hp2p_series *series, double *buffer)
+{
+  int count = series->count;
+
+  buffer[0] = count;
+  buffer[1] = series->width;
+  buffer[2] = series->n;
+  buffer[3] = series->avg;
+  buffer[4] = series->m2;
+  buffer[5] = series->lo;
+  buffer[6] = series->hi;
+  buffer += HP2P_SERIES_PACK_HEADER;
+  if (count > 0)
+  {
+    memcpy(buffer, series->min, count * sizeof(double));
+    memcpy(buffer + count, series->mean, count * sizeof(double));
+    memcpy(buffer + 2 * count, series->max, count * sizeof(double));
+  }
+}
+
+/**
+ * \fn     void hp2p_series_unpack(hp2p_series *series, const double *buffer)
+ * \brief  Restore a series written by hp2p_series_pack
+ *
+ * Buckets are merged if the series has a smaller capacity.
+ *
+ * \param  series initialized series
+ * \param  buffer
+ **/
+void hp2p_series_unpack(hp2p_series *series, const double *buffer)
+{
+  int count = (int)buffer[0];
+
+  hp2p_series_reserve(series, count);
+  series->count = count;
+  series->width = (int)buffer[1];
+  series->n = (int)buffer[2];
+  series->avg = buffer[3];
+  series->m2 = buffer[4];
+  series->lo = buffer[5];
+  series->hi = buffer[6];
+  buffer += HP2P_SERIES_PACK_HEADER;
+  if (count > 0)
+  {
+    memcpy(series->min, buffer, count * sizeof(double));
+    memcpy(series->mean, buffer + count, count * sizeof(double));
+    memcpy(series->max, buffer + 2 * count, count * sizeof(double));
+  }
+  while (series->count > series->capacity)
+    hp2p_series_merge(series);
+}
@@ -44,32 +44,35 @@ void init_signal_writer(hp2p_config conf)
   tokill = 0;
   towrite = 0;
 }
-void check_signal(hp2p_result result)
+void check_signal(hp2p_result *result)
 {
-  int rank = result.mpi_conf->rank;
-  int root = result.mpi_conf->root;
+  int rank = result->mpi_conf->rank;
+  int root = result->mpi_conf->root;
   MPI_Allreduce(MPI_IN_PLACE, &towrite, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
   if (towrite == 1)
   {
     MPI_Allreduce(MPI_IN_PLACE, &tokill, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
-    hp2p_result_update(&result);
+    hp2p_result_update(result);
     if (rank == root)
     {
-      hp2p_result_display(&result);
+      hp2p_result_display(result);
       printf("Writing result...\n");
-      hp2p_result_write(result);
+      hp2p_result_write(*result);
       fflush(stdout);
     }
+    if (result->conf->checkpoint)
+      hp2p_checkpoint_write(result);
     if (tokill != 0)
     {
+      hp2p_trace_write(result->conf, result->mpi_conf);
       if (rank == root)
 	printf("received signal %d exiting\n", tokill);
       exit(tokill);
     }
-    if (result.conf->alarm != 0)
+    if (result->conf->alarm != 0)
     {
       alarm(0);
-      alarm(result.conf->alarm);
+      alarm(result->conf->alarm);
     }
     towrite = 0;
   }
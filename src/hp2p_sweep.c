@@ -0,0 +1,115 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_sweep.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Statistics of the offset sweep. Iterations cycle through the
+ *            offsets of the buffers (see hp2p_buffer_offset), and the
+ *            samples of each offset are accumulated separately so that
+ *            the bandwidth and the latency can be compared per offset.
+ */
+
+#include "hp2p.h"
+
+void hp2p_sweep_alloc(hp2p_result *result)
+{
+  int nb = result->conf->nb_offsets;
+
+  result->l_offset = NULL;
+  result->g_offset = NULL;
+  if (nb == 0)
+    return;
+  result->l_offset = (double *)calloc(4 * nb, sizeof(double));
+  result->g_offset = (double *)calloc(4 * nb, sizeof(double));
+}
+
+void hp2p_sweep_free(hp2p_result *result)
+{
+  free(result->l_offset);
+  free(result->g_offset);
+}
+
+/**
+ * \fn     void hp2p_sweep_add(hp2p_result *result, int index, double sample)
+ * \brief  Account a sample for an offset
+ *
+ * \param  result
+ * \param  index  index of the offset (-1 without sweep)
+ * \param  sample time of communication
+ **/
+void hp2p_sweep_add(hp2p_result *result, int index, double sample)
+{
+  int nb = result->conf->nb_offsets;
+  double *stats = result->l_offset;
+
+  if (index < 0 || sample <= 0.0)
+    return;
+  if (stats[index] == 0.0 || sample < stats[3 * nb + index])
+    stats[3 * nb + index] = sample;
+  stats[index] += 1.0;
+  stats[nb + index] += sample;
+  stats[2 * nb + index] += result->conf->msg_size / sample;
+}
+
+/**
+ * \fn     void hp2p_sweep_update(hp2p_result *result)
+ * \brief  Reduce the samples of each offset
+ *
+ * This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_sweep_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  int nb = result->conf->nb_offsets;
+  double *best = NULL;
+  int k = 0;
+
+  if (nb == 0)
+    return;
+  MPI_Allreduce(result->l_offset, result->g_offset, 3 * nb, MPI_DOUBLE,
+		MPI_SUM, mpi_conf->comm);
+  best = (double *)malloc(nb * sizeof(double));
+  for (k = 0; k < nb; k++)
+    best[k] = (result->l_offset[k] > 0.0) ? result->l_offset[3 * nb + k]
+					  : 1.0e15;
+  MPI_Allreduce(best, &result->g_offset[3 * nb], nb, MPI_DOUBLE, MPI_MIN,
+		mpi_conf->comm);
+  free(best);
+}
+
+/**
+ * \fn     double hp2p_sweep_stat(hp2p_result *result, int index, int stat)
+ * \brief  Statistic of an offset after hp2p_sweep_update
+ *
+ * \param  result
+ * \param  index index of the offset
+ * \param  stat  HP2P_SWEEP_COUNT, HP2P_SWEEP_TIME, HP2P_SWEEP_BW or
+ *               HP2P_SWEEP_BEST
+ * \return value (0 if the offset has no sample)
+ **/
+double hp2p_sweep_stat(hp2p_result *result, int index, int stat)
+{
+  int nb = result->conf->nb_offsets;
+  double count = result->g_offset[index];
+
+  if (count == 0.0)
+    return 0.0;
+  if (stat == HP2P_SWEEP_COUNT || stat == HP2P_SWEEP_BEST)
+    return result->g_offset[stat * nb + index];
+  return result->g_offset[stat * nb + index] / count;
+}
@@ -0,0 +1,429 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_timeline.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Cluster-wide timeline of slow communications stamped in the
+ *            global time base
+ */
+
+#include "hp2p.h"
+
+extern int plotly_id;
+extern int plotly_uid;
+
+int hp2p_timeline_compare(const void *a, const void *b)
+{
+  const hp2p_event *ea = (const hp2p_event *)a;
+  const hp2p_event *eb = (const hp2p_event *)b;
+  if (ea->start < eb->start)
+    return -1;
+  if (ea->start > eb->start)
+    return 1;
+  return 0;
+}
+
+/**
+ * \fn     int hp2p_timeline_next_cluster(hp2p_result *result, int first)
+ * \brief  Find the end of a group of overlapping slow events
+ *
+ * Events are sorted by start time. A cluster is a set of events whose
+ * timed windows overlap transitively.
+ *
+ * \param  result
+ * \param  first index of the first event of the cluster
+ * \return index of the first event after the cluster
+ **/
+int hp2p_timeline_next_cluster(hp2p_result *result, int first)
+{
+  hp2p_event *ev = result->timeline;
+  double end = 0.0;
+  int i = 0;
+
+  end = ev[first].start + ev[first].time * result->nb_msg;
+  for (i = first + 1; i < result->nb_timeline && ev[i].start <= end; i++)
+  {
+    if (ev[i].start + ev[i].time * result->nb_msg > end)
+      end = ev[i].start + ev[i].time * result->nb_msg;
+  }
+  return i;
+}
+
+/**
+ * \fn     void hp2p_timeline_merge(hp2p_result *result, hp2p_event *fresh,
+ *                                 int nb)
+ * \brief  Merge sorted new events into the timeline (root)
+ *
+ * \param  result
+ * \param  fresh new events sorted by start time
+ * \param  nb    number of new events
+ **/
+void hp2p_timeline_merge(hp2p_result *result, hp2p_event *fresh, int nb)
+{
+  hp2p_event *old = result->timeline;
+  hp2p_event *merged = NULL;
+  int n = result->nb_timeline;
+  int i = 0;
+  int j = 0;
+  int k = 0;
+
+  merged = (hp2p_event *)malloc((n + nb + 1) * sizeof(hp2p_event));
+  while (i < n || j < nb)
+  {
+    if (j == nb || (i < n && hp2p_timeline_compare(&old[i], &fresh[j]) <= 0))
+      merged[k++] = old[i++];
+    else
+      merged[k++] = fresh[j++];
+  }
+  free(result->timeline);
+  result->timeline = merged;
+  result->nb_timeline = k;
+}
+
+/**
+ * \fn     double hp2p_timeline_select(double *v, int n, int k)
+ * \brief  k-th smallest value (quickselect, v is reordered)
+ *
+ * \param  v
+ * \param  n number of values
+ * \param  k rank of the value (0 = smallest)
+ * \return k-th smallest value
+ **/
+double hp2p_timeline_select(double *v, int n, int k)
+{
+  double pivot = 0.0;
+  double tmp = 0.0;
+  int lo = 0;
+  int hi = n - 1;
+  int i = 0;
+  int j = 0;
+
+  while (lo < hi)
+  {
+    pivot = v[(lo + hi) / 2];
+    for (i = lo, j = hi; i <= j;)
+    {
+      while (v[i] < pivot)
+	i++;
+      while (v[j] > pivot)
+	j--;
+      if (i <= j)
+      {
+	tmp = v[i];
+	v[i++] = v[j];
+	v[j--] = tmp;
+      }
+    }
+    if (k <= j)
+      hi = j;
+    else if (k >= i)
+      lo = i;
+    else
+      break;
+  }
+  return v[k];
+}
+
+/**
+ * \fn     void hp2p_timeline_keep_slowest(hp2p_result *result, int max)
+ * \brief  Keep the max events of the timeline with the largest slowdown,
+ *         in start time order (root)
+ *
+ * \param  result
+ * \param  max number of events kept
+ **/
+void hp2p_timeline_keep_slowest(hp2p_result *result, int max)
+{
+  hp2p_event *ev = result->timeline;
+  double *ratio = NULL;
+  double threshold = 0.0;
+  double r = 0.0;
+  int n = result->nb_timeline;
+  int ties = max;
+  int i = 0;
+  int k = 0;
+
+  if (n <= max)
+    return;
+  if (max <= 0)
+  {
+    result->timeline_dropped += n;
+    result->nb_timeline = 0;
+    return;
+  }
+  ratio = (double *)malloc(n * sizeof(double));
+  for (i = 0; i < n; i++)
+    ratio[i] = ev[i].time / ev[i].mean;
+  threshold = hp2p_timeline_select(ratio, n, n - max);
+  // Events above the threshold, then as many ties as needed
+  for (i = 0; i < n; i++)
+    if (ev[i].time / ev[i].mean > threshold)
+      ties--;
+  for (i = 0, k = 0; i < n; i++)
+  {
+    r = ev[i].time / ev[i].mean;
+    if (r > threshold || (r == threshold && ties-- > 0))
+      ev[k++] = ev[i];
+  }
+  free(ratio);
+  result->timeline_dropped += n - k;
+  result->nb_timeline = k;
+}
+
+/**
+ * \fn     void hp2p_timeline_update(hp2p_result *result)
+ * \brief  Gather the slow communications of the new iterations on the root
+ *
+ * A communication is slow when it is timeline_mult times slower than the
+ * mean time of its pair at the first snapshot which follows it. Only the
+ * lower rank of each pair reports it. Only the iterations since the last
+ * reduction are checked. Their events are sorted and merged into the
+ * timeline, which keeps the timeline_max_events slowest events (largest
+ * ratio to the pair mean), so that its size and the cost of an update
+ * do not grow with the length of the run.
+ * Must precede the update of result->reduced.
+ * This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_timeline_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  hp2p_event *events = NULL;
+  hp2p_event *fresh = NULL;
+  int *counts = NULL;
+  int *displs = NULL;
+  int nb_events = 0;
+  int other = 0;
+  int n = 0;
+  int i = 0;
+  int j = 0;
+  double mean = 0.0;
+
+  if (result->conf->clock_freq <= 0)
+    return;
+
+  n = result->current_iteration - result->reduced;
+  events = (hp2p_event *)malloc((n > 0 ? n : 1) * sizeof(hp2p_event));
+  for (i = 0; i < n; i++)
+  {
+    other = result->l_other[i];
+    if (other <= mpi_conf->rank || result->l_count[other] == 0)
+      continue;
+    mean = result->l_time[other] / result->l_count[other];
+    if (result->l_sample[i] > result->conf->timeline_mult * mean)
+    {
+      events[nb_events].start = result->l_start[i];
+      events[nb_events].time = result->l_sample[i];
+      events[nb_events].mean = mean;
+      events[nb_events].iteration = result->reduced + i + 1;
+      events[nb_events].rank = mpi_conf->rank;
+      events[nb_events].other = other;
+      nb_events++;
+    }
+  }
+
+  nb_events *= sizeof(hp2p_event);
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    counts = (int *)malloc(mpi_conf->nproc * sizeof(int));
+    displs = (int *)malloc(mpi_conf->nproc * sizeof(int));
+  }
+  MPI_Gather(&nb_events, 1, MPI_INT, counts, 1, MPI_INT, mpi_conf->root,
+	     mpi_conf->comm);
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    for (i = 0, j = 0; i < mpi_conf->nproc; i++)
+    {
+      displs[i] = j;
+      j += counts[i];
+    }
+    fresh = (hp2p_event *)malloc(j > 0 ? (size_t)j : sizeof(hp2p_event));
+    j /= sizeof(hp2p_event);
+  }
+  MPI_Gatherv(events, nb_events, MPI_BYTE, fresh, counts, displs, MPI_BYTE,
+	      mpi_conf->root, mpi_conf->comm);
+
+  if (mpi_conf->rank == mpi_conf->root)
+  {
+    qsort(fresh, j, sizeof(hp2p_event), hp2p_timeline_compare);
+    hp2p_timeline_merge(result, fresh, j);
+    hp2p_timeline_keep_slowest(result, result->conf->timeline_max_events);
+    free(fresh);
+    result->max_cluster = 0;
+    for (i = 0; i < result->nb_timeline; i = j)
+    {
+      j = hp2p_timeline_next_cluster(result, i);
+      if (j - i > result->max_cluster)
+	result->max_cluster = j - i;
+    }
+    free(counts);
+    free(displs);
+  }
+  free(events);
+}
+
+/**
+ * \fn     void hp2p_timeline_write_html(hp2p_result result)
+ * \brief  Write the time-aligned view of slow communications
+ *
+ * \param  result
+ **/
+void hp2p_timeline_write_html(hp2p_result result)
+{
+  FILE *fp = NULL;
+  char *filename = NULL;
+  hp2p_event *ev = result.timeline;
+  double *values = NULL;
+  double origin = 0.0;
+  int nb_shown = 0;
+  int i = 0;
+  int j = 0;
+  int k = 0;
+
+  if (result.conf->clock_freq <= 0)
+    return;
+
+  origin = result.conf->__start_time;
+  filename = (char *)malloc((strlen(result.conf->outname) + 32) * sizeof(char));
+  strcpy(filename, result.conf->outname);
+  strcat(filename, "-timeline.html");
+  fp = hp2p_writer_open(filename, "w");
+  if (fp != NULL)
+  {
+    hp2p_result_write_html_header(fp, result);
+    hp2p_result_write_html_default_stats(fp, result);
+
+    // Data
+    fprintf(fp, "<script type=\"text/javascript\">\n");
+    fprintf(fp, "// timeline start\n");
+    values = (double *)malloc((result.nb_timeline + 1) * sizeof(double));
+    for (i = 0; i < result.nb_timeline; i++)
+      values[i] = ev[i].start - origin;
+    hp2p_result_write_html_array(fp, result, "tl_time", values,
+				 result.nb_timeline, 1.0, HP2P_HTML_FLOAT64, 0, 6);
+    fprintf(fp, "var tl_pair = [");
+    for (i = 0; i < result.nb_timeline; i++)
+      fprintf(fp, " \"%s - %s\",",
+	      hp2p_mpi_get_host(result.mpi_conf, ev[i].rank),
+	      hp2p_mpi_get_host(result.mpi_conf, ev[i].other));
+    fprintf(fp, " ];\n");
+    for (i = 0; i < result.nb_timeline; i++)
+      values[i] = ev[i].time / ev[i].mean;
+    hp2p_result_write_html_array(fp, result, "tl_ratio", values,
+				 result.nb_timeline, 1.0, HP2P_HTML_FLOAT32, 0, 2);
+    free(values);
+    fprintf(fp, "var tl_iteration = [");
+    for (i = 0; i < result.nb_timeline; i++)
+      fprintf(fp, " \"iteration %d\",", ev[i].iteration);
+    fprintf(fp, " ];\n");
+    fprintf(fp, "// timeline end\n");
+    fprintf(fp, "</script>\n");
+
+    // Slow events over time
+    fprintf(fp, "<div class=flex-container >\n");
+    fprintf(fp,
+	    "<div><div id=\"%d\" style=\"height: 800px; width: 80%%;\" "
+	    "class=\"plotly-graph-div\"></div>\n",
+	    plotly_id);
+    fprintf(fp, "  <script type=\"text/javascript\">\n");
+    fprintf(fp, "    window.PLOTLYENV=window.PLOTLYENV || {};\n");
+    fprintf(fp, "    window.PLOTLYENV.BASE_URL=\"https://plot.ly\";\n");
+    fprintf(fp, "    Plotly.newPlot(\"%d\",\n", plotly_id++);
+    fprintf(fp, "    [{\"uid\": \"%d\",\n", plotly_uid++);
+    fprintf(fp, "    \"mode\": \"markers\",\n");
+    fprintf(fp, "    \"x\": tl_time,\n");
+    fprintf(fp, "    \"y\": tl_pair,\n");
+    fprintf(fp, "    \"text\": tl_iteration,\n");
+    fprintf(fp, "    \"marker\": {\"color\": tl_ratio, \"colorscale\": "
+		"\"Jet\", \"showscale\": true, \"colorbar\": {\"title\": "
+		"\"Slowdown\"}},\n");
+    fprintf(fp, "    \"type\": \"scatter\"}],\n");
+    fprintf(
+	fp,
+	"    {\"height\": 800, \"width\": 1600, \"autosize\": true, \"title\": "
+	"{\"text\": \"Slow communications (> %0.1lf x pair mean) in global "
+	"time\"}, \"yaxis\": {\"title\": \"Pair\"}, \"xaxis\": {\"title\": "
+	"\"Time since start (s)\"} }, {\"plotlyServerURL\": "
+	"\"https://plot.ly\", \"linkText\": \"Export to plot.ly\", "
+	"\"showLink\": false}\n",
+	result.conf->timeline_mult);
+    fprintf(fp, "    )\n");
+    fprintf(fp, "  </script>\n");
+    fprintf(fp, "</div>\n");
+    fprintf(fp, "\n");
+
+    // Number of slow events over time
+    fprintf(fp, "<div class=flex-container >\n");
+    fprintf(fp,
+	    "<div><div id=\"%d\" style=\"height: 800px; width: 80%%;\" "
+	    "class=\"plotly-graph-div\"></div>\n",
+	    plotly_id);
+    fprintf(fp, "  <script type=\"text/javascript\">\n");
+    fprintf(fp, "    window.PLOTLYENV=window.PLOTLYENV || {};\n");
+    fprintf(fp, "    window.PLOTLYENV.BASE_URL=\"https://plot.ly\";\n");
+    fprintf(fp, "    Plotly.newPlot(\"%d\",\n", plotly_id++);
+    fprintf(fp, "    [{\"uid\": \"%d\",\n", plotly_uid++);
+    fprintf(fp, "    \"x\": tl_time,\n");
+    fprintf(fp, "    \"nbinsx\": 200,\n");
+    fprintf(fp, "    \"type\": \"histogram\"}],\n");
+    fprintf(
+	fp,
+	"    {\"height\": 800, \"width\": 1600, \"autosize\": true, \"title\": "
+	"{\"text\": \"Number of slow communications over time\"}, \"yaxis\": "
+	"{\"title\": \"Number of pairs\"}, \"xaxis\": {\"title\": \"Time since "
+	"start (s)\"} }, {\"plotlyServerURL\": \"https://plot.ly\", "
+	"\"linkText\": \"Export to plot.ly\", \"showLink\": false}\n");
+    fprintf(fp, "    )\n");
+    fprintf(fp, "  </script>\n");
+    fprintf(fp, "</div>\n");
+    fprintf(fp, "\n");
+
+    // Simultaneous slow events
+    fprintf(fp, "<div class=stats-container>\n");
+    fprintf(fp, "<div>\n");
+    fprintf(fp, "<h2>Simultaneous slow communications</h2>\n");
+    fprintf(fp,
+	    "Slow communications: %d (%d slowest shown), largest group: "
+	    "%d<br>\n",
+	    result.nb_timeline + result.timeline_dropped, result.nb_timeline,
+	    result.max_cluster);
+    fprintf(fp, "<table style=\"margin: auto;\">\n");
+    fprintf(fp, "<tr><th>Time (s)</th><th>Pairs</th><th>Hosts</th></tr>\n");
+    for (i = 0; i < result.nb_timeline && nb_shown < 50; i = j)
+    {
+      j = hp2p_timeline_next_cluster(&result, i);
+      if (j - i < 2)
+	continue;
+      fprintf(fp, "<tr><td>%.6lf</td><td>%d</td><td>", ev[i].start - origin,
+	      j - i);
+      for (k = i; k < j; k++)
+	fprintf(fp, "%s - %s<br>",
+		hp2p_mpi_get_host(result.mpi_conf, ev[k].rank),
+		hp2p_mpi_get_host(result.mpi_conf, ev[k].other));
+      fprintf(fp, "</td></tr>\n");
+      nb_shown++;
+    }
+    fprintf(fp, "</table>\n");
+    fprintf(fp, "</div>\n");
+    fprintf(fp, "</div>\n");
+
+    fprintf(fp, "</div>\n");
+    hp2p_result_write_html_footer(fp);
+    hp2p_writer_close(fp);
+  }
+  free(filename);
+}
@@ -0,0 +1,250 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_trace.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Timeline export in Chrome trace JSON format (readable by
+ *            chrome://tracing and Perfetto). Events are buffered in memory
+ *            on each rank and merged by the root at the end of the run.
+ */
+
+#include "hp2p.h"
+
+const char *hp2p_trace_name[] = {"build",    "scatter", "sync wait",
+				 "warm-up",  "post",	"wait",
+				 "snapshot", "clock",	"recv done",
+				 "send done"};
+
+hp2p_trace_event *trace_events = NULL;
+hp2p_clock *trace_clock = NULL;
+int trace_enabled = 0;
+int trace_nb_events = 0;
+int trace_max_events = 0;
+int trace_dropped = 0;
+int trace_iteration = 0;
+
+/**
+ * \fn     void hp2p_trace_init(hp2p_config *conf, hp2p_mpi_config *mpi_conf)
+ * \brief  Allocate the trace buffer of the rank
+ *
+ * \param  conf
+ * \param  mpi_conf (its clock converts timestamps in the global time base)
+ **/
+void hp2p_trace_init(hp2p_config *conf, hp2p_mpi_config *mpi_conf)
+{
+  trace_enabled = conf->trace;
+  if (!trace_enabled)
+    return;
+  trace_clock = &mpi_conf->clock;
+  trace_max_events = conf->trace_max_events;
+  trace_nb_events = 0;
+  trace_dropped = 0;
+  trace_iteration = 0;
+  trace_events =
+      (hp2p_trace_event *)malloc(trace_max_events * sizeof(hp2p_trace_event));
+  if (trace_events == NULL)
+  {
+    fprintf(stderr, "Cannot allocate trace buffer... trace disabled\n");
+    trace_enabled = 0;
+  }
+}
+
+void hp2p_trace_set_iteration(int iteration) { trace_iteration = iteration; }
+
+int hp2p_trace_enabled() { return trace_enabled; }
+
+/**
+ * \fn     double hp2p_trace_begin()
+ * \brief  Start a span
+ *
+ * \return local time if the trace is enabled, else 0
+ **/
+double hp2p_trace_begin()
+{
+  if (!trace_enabled)
+    return 0.0;
+  return hp2p_util_get_time();
+}
+
+void hp2p_trace_record(int phase, double start, double duration, int arg)
+{
+  hp2p_trace_event *ev = NULL;
+
+  if (trace_nb_events >= trace_max_events)
+  {
+    trace_dropped++;
+    return;
+  }
+  ev = &trace_events[trace_nb_events++];
+  ev->start = hp2p_clock_global(trace_clock, start);
+  ev->duration = duration;
+  ev->phase = phase;
+  ev->iteration = trace_iteration;
+  ev->arg = arg;
+}
+
+/**
+ * \fn     void hp2p_trace_end(int phase, double start, int arg)
+ * \brief  End a span started with hp2p_trace_begin
+ *
+ * \param  phase HP2P_TRACE_*
+ * \param  start value returned by hp2p_trace_begin
+ * \param  arg message index or -1
+ **/
+void hp2p_trace_end(int phase, double start, int arg)
+{
+  if (!trace_enabled)
+    return;
+  hp2p_trace_record(phase, start, hp2p_util_get_time() - start, arg);
+}
+
+/**
+ * \fn     void hp2p_trace_instant(int phase, int arg)
+ * \brief  Record an instant event
+ *
+ * \param  phase HP2P_TRACE_*
+ * \param  arg message index or -1
+ **/
+void hp2p_trace_instant(int phase, int arg)
+{
+  if (!trace_enabled)
+    return;
+  hp2p_trace_record(phase, hp2p_util_get_time(), -1.0, arg);
+}
+
+void hp2p_trace_write_events(FILE *fp, hp2p_trace_event *ev, int nb, int rank,
+			     double origin)
+{
+  int i = 0;
+
+  for (i = 0; i < nb; i++)
+  {
+    if (ev[i].duration < 0.0)
+      fprintf(fp,
+	      ",\n{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": "
+	      "%.3lf, \"pid\": %d, \"tid\": 0, \"args\": {\"iteration\": %d, "
+	      "\"msg\": %d}}",
+	      hp2p_trace_name[ev[i].phase], (ev[i].start - origin) * 1.e6,
+	      rank, ev[i].iteration, ev[i].arg);
+    else
+      fprintf(fp,
+	      ",\n{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3lf, \"dur\": "
+	      "%.3lf, \"pid\": %d, \"tid\": 0, \"args\": {\"iteration\": %d, "
+	      "\"msg\": %d}}",
+	      hp2p_trace_name[ev[i].phase], (ev[i].start - origin) * 1.e6,
+	      ev[i].duration * 1.e6, rank, ev[i].iteration, ev[i].arg);
+  }
+}
+
+/**
+ * \fn     void hp2p_trace_write(hp2p_config *conf, hp2p_mpi_config *mpi_conf)
+ * \brief  Merge the trace buffers of all ranks into <outname>-trace.json
+ *
+ * The root receives the buffers one rank at a time and streams them to the
+ * file, so its memory does not depend on the number of ranks. Timestamps
+ * are relative to the start of the run on the root.
+ * This function is collective.
+ *
+ * \param  conf
+ * \param  mpi_conf
+ **/
+void hp2p_trace_write(hp2p_config *conf, hp2p_mpi_config *mpi_conf)
+{
+  FILE *fp = NULL;
+  char *filename = NULL;
+  hp2p_trace_event *buf = NULL;
+  MPI_Datatype event_type;
+  double origin = 0.0;
+  int nb = 0;
+  int dropped = 0;
+  int r = 0;
+
+  if (!trace_enabled)
+    return;
+
+  MPI_Reduce(&trace_dropped, &dropped, 1, MPI_INT, MPI_SUM, mpi_conf->root,
+	     mpi_conf->comm);
+  // Counts of events, not of bytes, so that they fit in an int
+  MPI_Type_contiguous(sizeof(hp2p_trace_event), MPI_BYTE, &event_type);
+  MPI_Type_commit(&event_type);
+  if (mpi_conf->rank != mpi_conf->root)
+  {
+    MPI_Send(&trace_nb_events, 1, MPI_INT, mpi_conf->root, HP2P_TAG_TRACE,
+	     mpi_conf->comm);
+    MPI_Send(trace_events, trace_nb_events, event_type, mpi_conf->root,
+	     HP2P_TAG_TRACE, mpi_conf->comm);
+  }
+  else
+  {
+    origin = conf->__start_time;
+    filename = (char *)malloc((strlen(conf->outname) + 32) * sizeof(char));
+    strcpy(filename, conf->outname);
+    strcat(filename, "-trace.json");
+    fp = hp2p_writer_open(filename, "w");
+    buf = (hp2p_trace_event *)malloc(trace_max_events *
+				     sizeof(hp2p_trace_event));
+    if (fp != NULL)
+    {
+      fprintf(fp, "{\"displayTimeUnit\": \"ns\",\n\"otherData\": "
+		  "{\"dropped_events\": %d},\n\"traceEvents\": [\n",
+	      dropped);
+      fprintf(fp,
+	      "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+	      "\"args\": {\"name\": ",
+	      mpi_conf->root);
+      hp2p_export_string(fp, hp2p_mpi_get_host(mpi_conf, mpi_conf->root));
+      fprintf(fp, "}}");
+      hp2p_trace_write_events(fp, trace_events, trace_nb_events,
+			      mpi_conf->root, origin);
+    }
+    for (r = 0; r < mpi_conf->nproc; r++)
+    {
+      if (r == mpi_conf->root)
+	continue;
+      MPI_Recv(&nb, 1, MPI_INT, r, HP2P_TAG_TRACE, mpi_conf->comm,
+	       MPI_STATUS_IGNORE);
+      MPI_Recv(buf, nb, event_type, r, HP2P_TAG_TRACE, mpi_conf->comm,
+	       MPI_STATUS_IGNORE);
+      if (fp != NULL)
+      {
+	fprintf(fp,
+		",\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+		"\"args\": {\"name\": ",
+		r);
+	hp2p_export_string(fp, hp2p_mpi_get_host(mpi_conf, r));
+	fprintf(fp, "}}");
+	hp2p_trace_write_events(fp, buf, nb, r, origin);
+      }
+    }
+    if (fp != NULL)
+    {
+      fprintf(fp, "\n]}\n");
+      hp2p_writer_close(fp);
+    }
+    if (dropped > 0)
+      printf(" Trace buffers were full: %d events dropped\n", dropped);
+    free(buf);
+    free(filename);
+  }
+  MPI_Type_free(&event_type);
+}
+
+void hp2p_trace_free()
+{
+  free(trace_events);
+  trace_events = NULL;
+  trace_enabled = 0;
+}
@@ -49,6 +49,40 @@ void hp2p_util_set_default_config(hp2p_config *conf)
   conf->anonymize = 0;
   conf->time_mult = -1.;
   conf->local_max_time = -1.;
+  conf->sync_mode = HP2P_SYNC_BARRIER;
+  conf->fence_freq = 0;
+  conf->clock_freq = 0;
+  conf->timeline_mult = 2.0;
+  conf->timeline_max_events = 1 << 16;
+  conf->trace = 0;
+  conf->trace_max_events = 1 << 20;
+  conf->anomaly_zscore = 0.0;
+  conf->anomaly_ewma = 0.0;
+  conf->anomaly_alpha = 0.1;
+  conf->anomaly_warmup = 10;
+  conf->html_encoding = HP2P_HTML_BASE64;
+  conf->binary_precision = 64;
+  conf->heatmap_tile = 512;
+  conf->series_size = 65536;
+  conf->checkpoint = 0;
+  conf->converge_width = 0.0;
+  conf->converge_fraction = 0.95;
+  conf->converge_confidence = 0.95;
+  conf->converge_level = HP2P_CONVERGE_PAIR;
+  conf->converge_freq = 100;
+  conf->converge_min = 5;
+  conf->warmup = 1;
+  conf->robust_samples = 0;
+  conf->robust_trim = 0.1;
+  conf->robust_groups = 5;
+  conf->robust_noise = 0.2;
+  conf->verify = 0;
+  conf->numa_node = HP2P_NUMA_NONE;
+  conf->hugepages = 0;
+  conf->buffer_source = HP2P_SOURCE_MEMALIGN;
+  conf->nb_offsets = 0;
+  conf->datatype = HP2P_TYPE_CONTIGUOUS;
+  strcpy(conf->restart, "");
   strcpy(conf->plotlyjs, "");
   strcpy(conf->output_mode, "html");
 }
@@ -82,12 +116,14 @@ void hp2p_util_free_config(hp2p_config *conf)
  **/
 void hp2p_util_display_config(hp2p_config conf)
 {
+  int i = 0;
+
   printf(" === Benchmark configuration ===\n");
   printf(" \n");
   printf(" Configuration file          : %s\n", conf.inname);
   printf(" Number of iterations        : %d\n", conf.nb_shuffle);
   printf(" Iterations between snapshot : %d\n", conf.snap_freq);
-  printf(" Message size                : %d\n", conf.msg_size);
+  printf(" Message size                : %lld\n", conf.msg_size);
   printf(" Number of msg per comm      : %d\n", conf.nb_msg);
   printf(" Alignment for MPI buffer    : %d\n", conf.align_size);
   printf(" Max time                    : %d\n", conf.max_time);
@@ -100,6 +136,60 @@ void hp2p_util_display_config(hp2p_config conf)
   printf(" output format               : %s\n", conf.output_mode);
   printf(" time_mult                   : %lf\n", conf.time_mult);
   printf(" max_communication_time      : %lf\n", conf.local_max_time);
+  printf(" Synchronization mode        : %s\n",
+	 conf.sync_mode == HP2P_SYNC_PAIR ? "pairwise" : "barrier");
+  printf(" Fence frequency             : %d\n", conf.fence_freq);
+  printf(" Clock estimation frequency  : %d\n", conf.clock_freq);
+  printf(" Timeline threshold          : %lf\n", conf.timeline_mult);
+  printf(" Timeline size (events)      : %d\n", conf.timeline_max_events);
+  printf(" Chrome trace                : %d\n", conf.trace);
+  printf(" Trace buffer (events/rank)  : %d\n", conf.trace_max_events);
+  printf(" Anomaly z-score             : %lf\n", conf.anomaly_zscore);
+  printf(" Anomaly EWMA deviation      : %lf\n", conf.anomaly_ewma);
+  printf(" Anomaly EWMA factor         : %lf\n", conf.anomaly_alpha);
+  printf(" Anomaly warm-up samples     : %d\n", conf.anomaly_warmup);
+  printf(" HTML data encoding          : %s\n",
+	 conf.html_encoding == HP2P_HTML_TEXT ? "text" : "base64");
+  printf(" Binary float precision      : %d\n", conf.binary_precision);
+  printf(" HTML heatmap tile size      : %d\n", conf.heatmap_tile);
+  printf(" Points per iteration series : %d\n", conf.series_size);
+  printf(" Checkpoint                  : %d\n", conf.checkpoint);
+  printf(" Convergence CI half-width   : %lf\n", conf.converge_width);
+  printf(" Convergence pair fraction   : %lf\n", conf.converge_fraction);
+  printf(" Convergence confidence      : %lf\n", conf.converge_confidence);
+  printf(" Convergence level           : %s\n",
+	 conf.converge_level == HP2P_CONVERGE_NODE ? "node" : "rank");
+  printf(" Convergence check frequency : %d\n", conf.converge_freq);
+  printf(" Convergence min samples     : %d\n", conf.converge_min);
+  printf(" Warm-up exchanges           : %d\n", conf.warmup);
+  printf(" Robust samples per pair     : %d\n", conf.robust_samples);
+  printf(" Robust trimmed fraction     : %lf\n", conf.robust_trim);
+  printf(" Robust median of means      : %d\n", conf.robust_groups);
+  printf(" Robust noise threshold      : %lf\n", conf.robust_noise);
+  printf(" Payload verification        : %d\n", conf.verify);
+  if (conf.numa_node == HP2P_NUMA_NIC)
+    printf(" NUMA node of the buffers    : nic\n");
+  else if (conf.numa_node == HP2P_NUMA_NONE)
+    printf(" NUMA node of the buffers    : first touch\n");
+  else
+    printf(" NUMA node of the buffers    : %d\n", conf.numa_node);
+  printf(" Huge pages of the buffers   : %d MB\n", conf.hugepages);
+  printf(" Source of the buffers       : %s\n",
+	 hp2p_buffer_source_name[conf.buffer_source]);
+  printf(" Offsets of the buffers      :");
+  for (i = 0; i < conf.nb_offsets; i++)
+    printf("%s%d", i ? "," : " ", conf.offsets[i]);
+  printf("%s\n", conf.nb_offsets ? "" : " none");
+  printf(" Datatype of the messages    : %s",
+	 hp2p_datatype_name[conf.datatype]);
+  if (conf.datatype == HP2P_TYPE_VECTOR)
+    printf(" (block %d, stride %d)", conf.type_block, conf.type_stride);
+  if (conf.datatype == HP2P_TYPE_SUBARRAY)
+    for (i = 0; i < conf.type_ndims; i++)
+      printf("%s%d/%d", i ? "x" : " ", conf.type_subsizes[i],
+	     conf.type_sizes[i]);
+  printf("\n");
+  printf(" Restart file                : %s\n", conf.restart);
 #ifdef _ENABLE_CUDA_
   printf(" CUDA support                : activated\n");
 #else
@@ -126,9 +216,19 @@ void hp2p_util_display_help(char command[])
   printf("       [-s msg_size] [-o output] [-a align] [-y]\n");
   printf("       [-p file] [-r seed] [-w bsbw] ");
   printf("       [-i conf_file]\n");
-  printf("       [-f bin|html] [-M max_comm_time] [-X mult_time]\n");
+  printf("       [-f bin|html|json|csv|jsonl|prom] [-M max_comm_time]\n");
+  printf("       [-X mult_time]\n");
+  printf("       [-S sync_mode] [-F fence_freq] [-G clock_freq]\n");
+  printf("       [-L timeline_mult] [-T trace] [-Z zscore]\n");
+  printf("       [-E base64|text] [-B 32|64] [-H tile]\n");
+  printf("       [-C checkpoint] [-R restart_file] [-I points]\n");
+  printf("       [-V ci_width] [-J fraction] [-W warmup] [-U samples]\n");
+  printf("       [-v verify] [-N numa_node] [-P hugepages] [-O offsets]\n");
+  printf("       [-D datatype] [-b source]\n");
   printf("Options:\n");
   printf("   -i conf_file       Configuration file\n");
+  printf("                      ([name] sections: scenarios run one\n");
+  printf("                      after the other)\n");
   printf("   -n nit             Number of iterations (default: 5000)\n");
   printf("   -k freq            Iterations between snapshot\n");
   printf("   -s msg_size        Message size (default: 1MB)\n");
@@ -151,8 +251,12 @@ void hp2p_util_display_help(char command[])
 	 "installed\n");
   printf("                      in your Python distribution\n");
   printf("   -o output          Output file\n");
-  printf("   -f format          Output format (binary format = bin, plotly\n");
-  printf("                      format = html) [default: html]\n");
+  printf("   -f format          Output formats, comma-separated (binary\n");
+  printf("                      format = bin, plotly format = html, JSON\n");
+  printf("                      summary = json, pairs and iterations in\n");
+  printf("                      CSV = csv or JSON lines = jsonl,\n");
+  printf("                      Prometheus metrics = prom)\n");
+  printf("                      [default: html]\n");
   printf("   -M max_comm_time   If set, print a warning each time a\n");
   printf("                      communication pair is slower than \n");
   printf("                      max_comm_time\n");
@@ -160,12 +264,233 @@ void hp2p_util_display_help(char command[])
   printf("                      communication pair is slower than \n");
   printf("                      mult_time * mean of previous\n");
   printf("                      communication times\n");
+  printf("   -S sync_mode       Synchronization around communications\n");
+  printf("                      (global barriers = 0 (default), pairwise\n");
+  printf("                       handshake between couples = 1)\n");
+  printf("   -F fence_freq      With -S 1, iterations between two global\n");
+  printf("                      MPI_Ibarrier fences (default: 0 = never)\n");
+  printf("   -G clock_freq      Estimate clock offsets with the root at\n");
+  printf("                      startup and every clock_freq iterations\n");
+  printf("                      to write a timeline of slow communications\n");
+  printf("                      in a global time base (default: 0 = off)\n");
+  printf("   -L timeline_mult   A communication is slow in the timeline if\n");
+  printf("                      it is timeline_mult times slower than the\n");
+  printf("                      mean of its pair (default: 2.0)\n");
+  printf("   -T trace           1 = write phases of all ranks in\n");
+  printf("                      <output>-trace.json (Chrome trace format\n");
+  printf("                      for chrome://tracing or Perfetto)\n");
+  printf("   -Z zscore          Enable the anomaly detector: a sample is\n");
+  printf("                      an anomaly if its z-score against the\n");
+  printf("                      running mean of its pair is above zscore,\n");
+  printf("                      and anomalies are logged in\n");
+  printf("                      <output>-anomalies.jsonl (default: 0 =\n");
+  printf("                      disabled)\n");
+  printf("   -E encoding        Encoding of the data in HTML outputs\n");
+  printf("                      (base64 typed arrays = base64, array\n");
+  printf("                       literals = text) [default: base64]\n");
+  printf("   -B precision       Precision of the matrices of the binary\n");
+  printf("                      format (32 or 64 bits) [default: 64]\n");
+  printf("   -H tile            Above tile x tile ranks, the HTML heatmap\n");
+  printf("                      is a pyramid of downsampled matrices with\n");
+  printf("                      full resolution tiles in <output>-tiles\n");
+  printf("                      (0 = never) [default: 512]\n");
+  printf("   -C checkpoint      1 = write the accumulated results in\n");
+  printf("                      <output>.ckpt at each snapshot [default: 0]\n");
+  printf("   -R restart_file    Resume the run saved in a checkpoint\n");
+  printf("   -I points          Max points of the series of iterations,\n");
+  printf("                      older iterations are merged beyond\n");
+  printf("                      [default: 65536]\n");
+  printf("   -V ci_width        Stop when the confidence interval of the\n");
+  printf("                      mean time of enough pairs is within\n");
+  printf("                      +/- ci_width (relative, e.g. 0.05)\n");
+  printf("                      (0 = disabled) [default: 0]\n");
+  printf("   -J fraction        Fraction of the pairs for -V\n");
+  printf("                      [default: 0.95]\n");
+  printf("   -W warmup          Untimed exchanges of a couple before its\n");
+  printf("                      timed messages [default: 1]\n");
+  printf("   -U samples         Samples kept per pair for the trimmed\n");
+  printf("                      mean, median of means and best time\n");
+  printf("                      (0 = disabled) [default: 0]\n");
+  printf("   -v verify          1 = fill the messages with a pattern of\n");
+  printf("                      the iteration and check the received\n");
+  printf("                      data outside the timed window [default: 0]\n");
+  printf("   -N numa_node       Bind the buffers to a NUMA node or to the\n");
+  printf("                      node of the network interface = nic\n");
+  printf("                      [default: first touch]\n");
+  printf("   -P hugepages       Map the buffers on huge pages (2M or 1G)\n");
+  printf("                      [default: 0 = base pages]\n");
+  printf("   -O offsets         Cycle the iterations through offsets of the\n");
+  printf("                      buffers from a page boundary, in bytes\n");
+  printf("                      (e.g. 0,8,64,4000) [default: no sweep]\n");
+  printf("   -D datatype        Also time the exchanges with a derived\n");
+  printf("                      datatype: vector:block:stride (ints) or\n");
+  printf("                      subarray:NXxNYxNZ:SXxSYxSZ\n");
+  printf("                      [default: contiguous only]\n");
+  printf("   -b source          Allocation of the buffers: memalign,\n");
+  printf("                      alloc_mem (MPI_Alloc_mem), window\n");
+  printf("                      (MPI_Win_allocate), shared (node window)\n");
+  printf("                      or mmap [default: memalign]\n");
   printf("\n");
 }
+/**
+ * \fn     void hp2p_util_set_key(hp2p_config *conf, const char *key,
+ *                              char *value)
+ * \brief  Set a parameter of the configuration from a key of a
+ *         configuration file
+ *
+ * \param  conf
+ * \param  key
+ * \param  value
+ * \return void
+ **/
+void hp2p_util_set_key(hp2p_config *conf, const char *key, char *value)
+{
+  if (strcmp(key, "nb_shuffle") == 0)
+    conf->nb_shuffle = atoi(value);
+  if (strcmp(key, "snap_freq") == 0)
+    conf->snap_freq = atoi(value);
+  if (strcmp(key, "msg_size") == 0)
+    conf->msg_size = atoll(value);
+  if (strcmp(key, "nb_msg") == 0)
+    conf->nb_msg = atoi(value);
+  if (strcmp(key, "align") == 0)
+    conf->align_size = atoi(value);
+  if (strcmp(key, "alarm") == 0)
+    conf->alarm = atoi(value);
+  if (strcmp(key, "outname") == 0)
+    strcpy(conf->outname, value);
+  if (strcmp(key, "build") == 0)
+  {
+    conf->build = atoi(value);
+    free(conf->buildname);
+    conf->buildname = hp2p_algo_get_name(conf->build);
+  }
+  if (strcmp(key, "seed") == 0)
+    conf->seed = atoi(value);
+  if (strcmp(key, "max_time") == 0)
+    conf->max_time = atoi(value);
+  if (strcmp(key, "anonymize") == 0)
+    conf->anonymize = atoi(value);
+  if (strcmp(key, "plotlyjs") == 0)
+    strcpy(conf->plotlyjs, value);
+  if (strcmp(key, "output_format") == 0)
+    strncpy(conf->output_mode, value, sizeof(conf->output_mode) - 1);
+  if (strcmp(key, "max_communication_time") == 0)
+    conf->local_max_time = strtod(value, NULL);
+  if (strcmp(key, "time_mult") == 0)
+    conf->time_mult = strtod(value, NULL);
+  if (strcmp(key, "sync_mode") == 0)
+    conf->sync_mode = atoi(value);
+  if (strcmp(key, "fence_freq") == 0)
+    conf->fence_freq = atoi(value);
+  if (strcmp(key, "clock_freq") == 0)
+    conf->clock_freq = atoi(value);
+  if (strcmp(key, "timeline_mult") == 0)
+    conf->timeline_mult = strtod(value, NULL);
+  if (strcmp(key, "timeline_max_events") == 0)
+    conf->timeline_max_events = atoi(value);
+  if (strcmp(key, "trace") == 0)
+    conf->trace = atoi(value);
+  if (strcmp(key, "trace_max_events") == 0)
+    conf->trace_max_events = atoi(value);
+  if (strcmp(key, "anomaly_zscore") == 0)
+    conf->anomaly_zscore = strtod(value, NULL);
+  if (strcmp(key, "anomaly_ewma") == 0)
+    conf->anomaly_ewma = strtod(value, NULL);
+  if (strcmp(key, "anomaly_alpha") == 0)
+    conf->anomaly_alpha = strtod(value, NULL);
+  if (strcmp(key, "anomaly_warmup") == 0)
+    conf->anomaly_warmup = atoi(value);
+  if (strcmp(key, "html_encoding") == 0)
+    conf->html_encoding =
+	strcmp(value, "text") ? HP2P_HTML_BASE64 : HP2P_HTML_TEXT;
+  if (strcmp(key, "binary_precision") == 0)
+    conf->binary_precision = atoi(value);
+  if (strcmp(key, "heatmap_tile") == 0)
+    conf->heatmap_tile = atoi(value);
+  if (strcmp(key, "series_size") == 0)
+    conf->series_size = atoi(value);
+  if (strcmp(key, "converge_width") == 0)
+    conf->converge_width = strtod(value, NULL);
+  if (strcmp(key, "converge_fraction") == 0)
+    conf->converge_fraction = strtod(value, NULL);
+  if (strcmp(key, "converge_confidence") == 0)
+    conf->converge_confidence = strtod(value, NULL);
+  if (strcmp(key, "converge_level") == 0)
+    conf->converge_level =
+	strcmp(value, "node") ? HP2P_CONVERGE_PAIR : HP2P_CONVERGE_NODE;
+  if (strcmp(key, "converge_freq") == 0)
+    conf->converge_freq = atoi(value);
+  if (strcmp(key, "converge_min") == 0)
+    conf->converge_min = atoi(value);
+  if (strcmp(key, "warmup") == 0)
+    conf->warmup = atoi(value);
+  if (strcmp(key, "robust_samples") == 0)
+    conf->robust_samples = atoi(value);
+  if (strcmp(key, "robust_trim") == 0)
+    conf->robust_trim = strtod(value, NULL);
+  if (strcmp(key, "robust_groups") == 0)
+    conf->robust_groups = atoi(value);
+  if (strcmp(key, "robust_noise") == 0)
+    conf->robust_noise = strtod(value, NULL);
+  if (strcmp(key, "verify") == 0)
+    conf->verify = atoi(value);
+  if (strcmp(key, "numa_node") == 0)
+    conf->numa_node = hp2p_buffer_parse_node(value);
+  if (strcmp(key, "hugepages") == 0)
+    conf->hugepages = hp2p_buffer_parse_pages(value);
+  if (strcmp(key, "offsets") == 0)
+    hp2p_buffer_parse_offsets(conf, value);
+  if (strcmp(key, "datatype") == 0)
+    hp2p_datatype_parse(conf, value);
+  if (strcmp(key, "buffer_source") == 0)
+    conf->buffer_source = hp2p_buffer_parse_source(value);
+  if (strcmp(key, "checkpoint") == 0)
+    conf->checkpoint = atoi(value);
+  if (strcmp(key, "restart") == 0)
+    strncpy(conf->restart, value, MAXCHARFILE - 1);
+}
+/**
+ * \fn     int hp2p_util_is_section(const char *line, char *name)
+ * \brief  Check if a line of a configuration file starts a section
+ *         "[name]" of a campaign (see hp2p_campaign)
+ *
+ * \param  line
+ * \param  name   name of the section (HP2P_SCENARIO_NAME chars) or NULL
+ * \return 1 if the line starts a section, 0 otherwise
+ **/
+int hp2p_util_is_section(const char *line, char *name)
+{
+  const char *end = NULL;
+  int len = 0;
+  int i = 0;
+
+  line += strspn(line, " \t");
+  if (line[0] != '[')
+    return 0;
+  end = strchr(line, ']');
+  if (end == NULL)
+    return 0;
+  if (name == NULL)
+    return 1;
+  len = end - line - 1;
+  if (len > HP2P_SCENARIO_NAME - 1)
+    len = HP2P_SCENARIO_NAME - 1;
+  // The name is part of the output filenames
+  for (i = 0; i < len; i++)
+    name[i] = (isalnum(line[1 + i]) || strchr("-_.", line[1 + i]) != NULL)
+		  ? line[1 + i]
+		  : '_';
+  name[len] = '\0';
+  return 1;
+}
 /**
  * \fn     void read_configfile(char *fname, config *conf)
  * \brief  Read benchmark configuration from a configuration file
  *
+ * Only the keys before the first section are read: the sections are the
+ * scenarios of a campaign (see hp2p_campaign_read).
+ *
  * \param  conf
  * \return void
  **/
@@ -181,6 +506,7 @@ void hp2p_util_read_configfile(hp2p_config *conf)
   if (fp == NULL)
   {
     fprintf(stderr, "Cannot open %s ... exit\n", conf->inname);
+    return;
   }
 
   buffer = (char *)malloc(max_len * sizeof(char));
@@ -191,51 +517,14 @@ void hp2p_util_read_configfile(hp2p_config *conf)
   {
     // Remove trailing newline
     buffer[strcspn(buffer, "\n")] = 0;
-    if (buffer[0] != '#')
-    {
-      // Remove trailing newline
-      buffer[strcspn(buffer, "\n")] = 0;
-      if (buffer[0] != '#')
-      {
-	sscanf(buffer, "%s = %s", key, value);
-	if (strcmp(key, "nb_shuffle") == 0)
-	  conf->nb_shuffle = atoi(value);
-	if (strcmp(key, "snap_freq") == 0)
-	  conf->snap_freq = atoi(value);
-	if (strcmp(key, "msg_size") == 0)
-	  conf->msg_size = atoi(value);
-	if (strcmp(key, "nb_msg") == 0)
-	  conf->nb_msg = atoi(value);
-	if (strcmp(key, "align") == 0)
-	  conf->align_size = atoi(value);
-	if (strcmp(key, "alarm") == 0)
-	  conf->alarm = atoi(value);
-	if (strcmp(key, "outname") == 0)
-	  strcpy(conf->outname, value);
-	if (strcmp(key, "build") == 0)
-	{
-	  conf->build = atoi(value);
-	  free(conf->buildname);
-	  conf->buildname = hp2p_algo_get_name(conf->build);
-	}
-	if (strcmp(key, "seed") == 0)
-	  conf->seed = atoi(value);
-	if (strcmp(key, "max_time") == 0)
-	  conf->max_time = atoi(value);
-	if (strcmp(key, "anonymize") == 0)
-	  conf->anonymize = atoi(value);
-	if (strcmp(key, "plotlyjs") == 0)
-	  strcpy(conf->plotlyjs, value);
-	if (strcmp(key, "output_format") == 0)
-	  strcpy(conf->output_mode, value);
-	if (strcmp(key, "max_communication_time") == 0)
-	  conf->local_max_time = strtod(value, NULL);
-	if (strcmp(key, "time_mult") == 0)
-	  conf->time_mult = strtod(value, NULL);
-      }
-    }
+    if (hp2p_util_is_section(buffer, NULL))
+      break;
+    if (buffer[0] != '#' && sscanf(buffer, "%s = %s", key, value) == 2)
+      hp2p_util_set_key(conf, key, value);
   }
   free(buffer);
+  free(key);
+  free(value);
 
   fclose(fp);
 }
@@ -257,7 +546,7 @@ void hp2p_util_read_commandline(int argc, char *argv[], hp2p_config *conf)
   hp2p_util_set_default_config(conf);
 
   // Parsing command line
-  while ((opt = getopt(argc, argv, "hn:k:m:s:o:i:c:r:t:a:y:p:f:M:X:A:")) != -1)
+  while ((opt = getopt(argc, argv, "hn:k:m:s:o:i:c:r:t:a:y:p:f:M:X:A:S:F:G:L:T:Z:E:B:H:C:R:I:V:J:W:U:v:N:P:O:D:b:")) != -1)
   {
     switch (opt)
     {
@@ -278,7 +567,7 @@ void hp2p_util_read_commandline(int argc, char *argv[], hp2p_config *conf)
       conf->align_size = atoi(optarg);
       break;
     case 's':
-      conf->msg_size = atoi(optarg);
+      conf->msg_size = atoll(optarg);
       break;
     case 'o':
       strcpy(conf->outname, optarg);
@@ -307,15 +596,84 @@ void hp2p_util_read_commandline(int argc, char *argv[], hp2p_config *conf)
       strcpy(conf->plotlyjs, optarg);
       break;
     case 'f':
-      strcpy(conf->output_mode, optarg);
+      strncpy(conf->output_mode, optarg, sizeof(conf->output_mode) - 1);
+      break;
     case 'M':
       conf->local_max_time = strtod(optarg, NULL);
       break;
     case 'X':
       conf->time_mult = strtod(optarg, NULL);
+      break;
     case 'A':
       conf->alarm = atoi(optarg);
       break;
+    case 'S':
+      conf->sync_mode = atoi(optarg);
+      break;
+    case 'F':
+      conf->fence_freq = atoi(optarg);
+      break;
+    case 'G':
+      conf->clock_freq = atoi(optarg);
+      break;
+    case 'L':
+      conf->timeline_mult = strtod(optarg, NULL);
+      break;
+    case 'T':
+      conf->trace = atoi(optarg);
+      break;
+    case 'Z':
+      conf->anomaly_zscore = strtod(optarg, NULL);
+      break;
+    case 'E':
+      conf->html_encoding =
+	  strcmp(optarg, "text") ? HP2P_HTML_BASE64 : HP2P_HTML_TEXT;
+      break;
+    case 'B':
+      conf->binary_precision = atoi(optarg);
+      break;
+    case 'H':
+      conf->heatmap_tile = atoi(optarg);
+      break;
+    case 'C':
+      conf->checkpoint = atoi(optarg);
+      break;
+    case 'R':
+      strncpy(conf->restart, optarg, MAXCHARFILE - 1);
+      break;
+    case 'I':
+      conf->series_size = atoi(optarg);
+      break;
+    case 'V':
+      conf->converge_width = strtod(optarg, NULL);
+      break;
+    case 'J':
+      conf->converge_fraction = strtod(optarg, NULL);
+      break;
+    case 'W':
+      conf->warmup = atoi(optarg);
+      break;
+    case 'U':
+      conf->robust_samples = atoi(optarg);
+      break;
+    case 'v':
+      conf->verify = atoi(optarg);
+      break;
+    case 'N':
+      conf->numa_node = hp2p_buffer_parse_node(optarg);
+      break;
+    case 'P':
+      conf->hugepages = hp2p_buffer_parse_pages(optarg);
+      break;
+    case 'O':
+      hp2p_buffer_parse_offsets(conf, optarg);
+      break;
+    case 'D':
+      hp2p_datatype_parse(conf, optarg);
+      break;
+    case 'b':
+      conf->buffer_source = hp2p_buffer_parse_source(optarg);
+      break;
     default:
       break;
     }
@@ -339,6 +697,29 @@ double hp2p_util_get_time()
   gettimeofday(&t, 0);
   return t.tv_sec + 0.000001 * t.tv_usec;
 }
+/**
+ * \fn     int hp2p_util_has_format(hp2p_config *conf, const char *format)
+ * \brief  Check if a format is in the list of output formats
+ *
+ * \param  conf
+ * \param  format
+ * \return 1 if output_mode contains format, else 0
+ **/
+int hp2p_util_has_format(hp2p_config *conf, const char *format)
+{
+  const char *p = conf->output_mode;
+  size_t len = strlen(format);
+
+  while (p != NULL && *p != '\0')
+  {
+    if (strncmp(p, format, len) == 0 && (p[len] == ',' || p[len] == '\0'))
+      return 1;
+    p = strchr(p, ',');
+    if (p != NULL)
+      p++;
+  }
+  return 0;
+}
 /**
  * \fn     void hp2p_init_tremain(config conf)
  * \brief  init time stamp at the beginning
@@ -0,0 +1,177 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_verify.c
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Payload verification. Each sender fills its buffer with a
+ *            pattern derived from the seed, the iteration and its rank, so
+ *            that the receiver can check the received buffer (including
+ *            stale data of a previous iteration) without any exchange.
+ *            Fill and check run outside the timed window.
+ */
+
+#include "hp2p.h"
+
+#define HP2P_VERIFY_STRIDE 0x9E3779B1u
+#define HP2P_VERIFY_LANES 8
+
+/**
+ * \fn     uint32_t hp2p_verify_key(int seed, int iteration, int sender)
+ * \brief  Key of the pattern of a message
+ *
+ * \param  seed      seed of the run
+ * \param  iteration current iteration
+ * \param  sender    rank of the sender
+ * \return key
+ **/
+uint32_t hp2p_verify_key(int seed, int iteration, int sender)
+{
+  uint32_t x = (uint32_t)seed * 0x85EBCA6Bu;
+
+  x ^= (uint32_t)iteration * 0xC2B2AE35u;
+  x ^= (uint32_t)sender * 0x27D4EB2Fu;
+  // Finalizer of MurmurHash3
+  x ^= x >> 16;
+  x *= 0x85EBCA6Bu;
+  x ^= x >> 13;
+  x *= 0xC2B2AE35u;
+  x ^= x >> 16;
+  return x;
+}
+
+/**
+ * \fn     void hp2p_verify_fill(int *buf, size_t n, uint32_t key)
+ * \brief  Write the pattern of a message
+ *
+ * \param  buf message
+ * \param  n   number of words
+ * \param  key key of the message
+ **/
+void hp2p_verify_fill(int *buf, size_t n, uint32_t key)
+{
+  uint32_t *word = (uint32_t *)buf;
+  size_t j = 0;
+
+  for (j = 0; j < n; j++)
+    word[j] = key ^ ((uint32_t)j * HP2P_VERIFY_STRIDE);
+}
+
+/**
+ * \fn     long long hp2p_verify_check(const int *buf, size_t n,
+ *                                    uint32_t key)
+ * \brief  Number of corrupted words of a received message
+ *
+ * The fast path only ORs the differences with the pattern in blocks of
+ * HP2P_VERIFY_LANES words: the loop has no branch and no data-dependent
+ * exit, so the compiler vectorizes it. Words are only counted when a
+ * difference is found.
+ *
+ * \param  buf message
+ * \param  n   number of words
+ * \param  key key of the message
+ * \return number of words which differ from the pattern
+ **/
+long long hp2p_verify_check(const int *buf, size_t n, uint32_t key)
+{
+  const uint32_t *word = (const uint32_t *)buf;
+  uint32_t lane[HP2P_VERIFY_LANES];
+  uint32_t diff = 0;
+  long long bad = 0;
+  size_t j = 0;
+  int l = 0;
+
+  // Fixed-width blocks are vectorized at -O2
+  for (l = 0; l < HP2P_VERIFY_LANES; l++)
+    lane[l] = 0;
+  for (j = 0; j + HP2P_VERIFY_LANES <= n; j += HP2P_VERIFY_LANES)
+    for (l = 0; l < HP2P_VERIFY_LANES; l++)
+      lane[l] |=
+	  word[j + l] ^ (key ^ ((uint32_t)(j + l) * HP2P_VERIFY_STRIDE));
+  for (l = 0; l < HP2P_VERIFY_LANES; l++)
+    diff |= lane[l];
+  for (; j < n; j++)
+    diff |= word[j] ^ (key ^ ((uint32_t)j * HP2P_VERIFY_STRIDE));
+  if (diff == 0)
+    return 0;
+  for (j = 0; j < n; j++)
+    bad += (word[j] != (key ^ ((uint32_t)j * HP2P_VERIFY_STRIDE)));
+  return bad;
+}
+
+void hp2p_verify_alloc(hp2p_result *result)
+{
+  int nproc = result->mpi_conf->nproc;
+
+  result->l_corrupt = (int *)calloc(nproc, sizeof(int));
+  result->g_corrupt = NULL;
+  if (result->gather && result->mpi_conf->rank == result->mpi_conf->root)
+    result->g_corrupt = (int *)calloc(nproc * nproc, sizeof(int));
+  result->l_corrupt_words = 0;
+  result->l_verify_time = 0.0;
+  result->nb_corrupt = 0;
+  result->corrupt_pairs = 0;
+  result->corrupt_words = 0;
+  result->avg_verify_time = 0.0;
+  result->max_verify_time = 0.0;
+  result->verify_overhead = 0.0;
+}
+
+void hp2p_verify_free(hp2p_result *result)
+{
+  free(result->l_corrupt);
+  free(result->g_corrupt);
+}
+
+/**
+ * \fn     void hp2p_verify_update(hp2p_result *result)
+ * \brief  Reduce the corruption counters and the verification time
+ *
+ * The overhead is the verification time relative to the timed
+ * communication time of all ranks.
+ * This function is collective.
+ *
+ * \param  result
+ **/
+void hp2p_verify_update(hp2p_result *result)
+{
+  hp2p_mpi_config *mpi_conf = result->mpi_conf;
+  double sums[5];
+  int j = 0;
+
+  if (!result->conf->verify)
+    return;
+  memset(sums, 0, sizeof(sums));
+  for (j = 0; j < mpi_conf->nproc; j++)
+  {
+    sums[0] += result->l_corrupt[j];
+    if (result->l_corrupt[j] > 0)
+      sums[1] += 1.0;
+    sums[3] += result->l_time[j] * result->conf->nb_msg;
+  }
+  sums[2] = (double)result->l_corrupt_words;
+  sums[4] = result->l_verify_time;
+  MPI_Allreduce(MPI_IN_PLACE, sums, 5, MPI_DOUBLE, MPI_SUM, mpi_conf->comm);
+  MPI_Allreduce(&result->l_verify_time, &result->max_verify_time, 1,
+		MPI_DOUBLE, MPI_MAX, mpi_conf->comm);
+  result->nb_corrupt = (long long)sums[0];
+  result->corrupt_pairs = (int)sums[1];
+  result->corrupt_words = (long long)sums[2];
+  result->avg_verify_time = sums[4] / mpi_conf->nproc;
+  result->verify_overhead = sums[3] > 0.0 ? sums[4] / sums[3] : 0.0;
+  if (result->gather)
+    MPI_Gather(result->l_corrupt, mpi_conf->nproc, MPI_INT, result->g_corrupt,
+	       mpi_conf->nproc, MPI_INT, mpi_conf->root, mpi_conf->comm);
+}
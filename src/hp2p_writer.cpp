@@ -0,0 +1,142 @@
+// Copyright (C) 2010-2024 CEA/DAM
+// Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+//
+// This file is part of HP2P.
+//
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use,
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info".
+
+/**
+ * \file      hp2p_writer.cpp
+ * \author    Laurent Nguyen <laurent.nguyen@cea.fr>
+ * \version   4.0
+ * \date      June 21 2023
+ * \brief     HP2P Benchmark
+ *
+ * \details   Output layer of the reports: files with large write buffers,
+ *            number formatting without printf and bulk reads of assets
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#define HP2P_WRITER_BUFFER (1 << 20)
+
+// Buffers of the files opened with hp2p_writer_open
+std::map<FILE *, char *> hp2p_writer_buffers;
+
+extern "C"
+{
+  /**
+   * \fn     FILE *hp2p_writer_open(const char *filename, const char *mode)
+   * \brief  Open a file with a large write buffer
+   *
+   * \param  filename
+   * \param  mode fopen mode
+   * \return file or NULL, to close with hp2p_writer_close
+   **/
+  FILE *hp2p_writer_open(const char *filename, const char *mode)
+  {
+    FILE *fp = NULL;
+    char *buf = NULL;
+
+    fp = fopen(filename, mode);
+    if (fp == NULL)
+      return NULL;
+    buf = (char *)malloc(HP2P_WRITER_BUFFER);
+    if (buf != NULL && setvbuf(fp, buf, _IOFBF, HP2P_WRITER_BUFFER) == 0)
+      hp2p_writer_buffers[fp] = buf;
+    else
+      free(buf);
+    return fp;
+  }
+
+  int hp2p_writer_close(FILE *fp)
+  {
+    std::map<FILE *, char *>::iterator it;
+    int ret = 0;
+
+    // The buffer is released once the file is flushed
+    it = hp2p_writer_buffers.find(fp);
+    ret = fclose(fp);
+    if (it != hp2p_writer_buffers.end())
+    {
+      free(it->second);
+      hp2p_writer_buffers.erase(it);
+    }
+    return ret;
+  }
+
+  /**
+   * \fn     void hp2p_writer_double(FILE *fp, double value, int scientific,
+   *                                int precision)
+   * \brief  Write a number as printf "%.*lf" or "%.*e" would
+   *
+   * \param  fp
+   * \param  value
+   * \param  scientific 0 = fixed notation, 1 = scientific notation
+   * \param  precision number of digits after the decimal point
+   **/
+  void hp2p_writer_double(FILE *fp, double value, int scientific,
+			  int precision)
+  {
+    char str[512];
+    int n = 0;
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::to_chars_result res;
+    res = std::to_chars(str, str + sizeof(str), value,
+			scientific ? std::chars_format::scientific
+				   : std::chars_format::fixed,
+			precision);
+    if (res.ec == std::errc())
+      n = res.ptr - str;
+    else
+      n = snprintf(str, sizeof(str), scientific ? "%.*e" : "%.*lf",
+		   precision, value);
+#else
+    n = snprintf(str, sizeof(str), scientific ? "%.*e" : "%.*lf", precision,
+		 value);
+#endif
+    fwrite(str, sizeof(char), n, fp);
+  }
+
+  /**
+   * \fn     char *hp2p_writer_read_file(const char *filename, size_t *size)
+   * \brief  Read a whole file with a single read
+   *
+   * \param  filename
+   * \param  size size of the file (output)
+   * \return content of the file (to free) or NULL
+   **/
+  char *hp2p_writer_read_file(const char *filename, size_t *size)
+  {
+    FILE *fp = NULL;
+    char *data = NULL;
+    long pos = 0;
+
+    *size = 0;
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+      return NULL;
+    fseek(fp, 0L, SEEK_END);
+    pos = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+    if (pos >= 0)
+      data = (char *)malloc(pos + 1);
+    if (data != NULL)
+      *size = fread(data, sizeof(char), pos, fp);
+    fclose(fp);
+    return data;
+  }
+}
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Copyright (C) 2010-2024 CEA/DAM
+# Copyright (C) 2010-2024 Laurent Nguyen <laurent.nguyen@cea.fr>
+#
+# This file is part of HP2P.
+#
+# This software is governed by the CeCILL-C license under French law and
+# abiding by the rules of distribution of free software.  You can  use,
+# modify and/ or redistribute the software under the terms of the CeCILL-C
+# license as circulated by CEA, CNRS and INRIA at the following URL
+# "http://www.cecill.info".
+
+"""Tests of the compare command of hp2p_html_parser.py
+
+data/run4.bin and data/run4.html are the binary and HTML outputs of the
+same run of 4 ranks (-f html,bin).
+"""
+
+import importlib.util
+import math
+import os
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SPEC = importlib.util.spec_from_file_location(
+    "hp2p_html_parser",
+    os.path.join(HERE, "..", "src", "hp2p_html_parser.py"))
+PARSER = importlib.util.module_from_spec(SPEC)
+SPEC.loader.exec_module(PARSER)
+
+
+class TestCompare(unittest.TestCase):
+
+    def compare(self, reference, filename):
+        data_a = PARSER.read_file(os.path.join(HERE, "data", reference))
+        data_b = PARSER.read_file(os.path.join(HERE, "data", filename))
+        return PARSER.compare_runs(data_a, data_b, 10, 3.0, 5.0, 1000)
+
+    def check_same_run(self, result):
+        self.assertEqual(result["pairs"], 12)
+        self.assertAlmostEqual(math.expm1(result["mean"]) * 100.0, 0.0,
+                               places=3)
+        self.assertEqual(result["regressions"], 0)
+        self.assertEqual(result["improvements"], 0)
+
+    def test_binary_html(self):
+        self.check_same_run(self.compare("run4.bin", "run4.html"))
+
+    def test_html_binary(self):
+        self.check_same_run(self.compare("run4.html", "run4.bin"))
+
+
+if __name__ == "__main__":
+    unittest.main()